@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include "avgen.h"
+
+/// per-program generator state, xorshift keeps programs reproducible
+/// across platforms where rand() is not
+typedef struct {
+  FILE* out;
+  const avgen_params* params;
+  unsigned long long rng;
+  unsigned int func;   ///< index of the function being written
+  unsigned int locals; ///< locals declared so far in it
+  unsigned int stmts;  ///< statements written so far, paces the comments
+} avgen;
+
+static unsigned long long next_rand(avgen* g) {
+  g->rng ^= g->rng << 13;
+  g->rng ^= g->rng >> 7;
+  g->rng ^= g->rng << 17;
+  return g->rng;
+}
+
+static unsigned int pick(avgen* g, unsigned int n) {
+  return (unsigned int)(next_rand(g) % n);
+}
+
+avgen_params avgen_defaults(void) {
+  avgen_params p = { .funcs = 100, .depth = 4, .locals = 4, .comments = 10, .seed = 1 };
+  return p;
+}
+
+static void write_leaf(avgen* g) {
+  unsigned int choices = 3 + (g->locals > 0);
+  switch (pick(g, choices)) {
+    case 0:  fprintf(g->out, "a"); break;
+    case 1:  fprintf(g->out, "b"); break;
+    case 2:  fprintf(g->out, "%u", pick(g, 1000)); break;
+    default: fprintf(g->out, "l%u", pick(g, g->locals)); break;
+  }
+}
+
+static void write_expr(avgen* g, unsigned int depth) {
+  if (depth == 0) {
+    // calls only go to earlier functions so the program has no recursion
+    if (g->func > 0 && pick(g, 8) == 0) {
+      fprintf(g->out, "call f%u(", pick(g, g->func));
+      write_leaf(g);
+      fprintf(g->out, ", ");
+      write_leaf(g);
+      fprintf(g->out, ")");
+      return;
+    }
+    write_leaf(g);
+    return;
+  }
+  static const char ops[] = { '+', '-', '*' };
+  fprintf(g->out, "(");
+  write_expr(g, depth - 1);
+  fprintf(g->out, " %c ", ops[pick(g, 3)]);
+  write_expr(g, pick(g, depth));
+  fprintf(g->out, ")");
+}
+
+/// emits comments so that on average params->comments of every 100
+/// statements are preceded by one
+static void maybe_comment(avgen* g, const char* indent) {
+  g->stmts++;
+  if (pick(g, 100) < g->params->comments) {
+    fprintf(g->out, "%s// comment %u, only here to give the tokenizer something to skip\n", indent, g->stmts);
+  }
+}
+
+static void write_func(avgen* g) {
+  const avgen_params* p = g->params;
+  g->locals = 0;
+  maybe_comment(g, "");
+  fprintf(g->out, "fn QWORD f%u (QWORD a, QWORD b) {\n", g->func);
+  for (unsigned int i = 0; i < p->locals; i++) {
+    maybe_comment(g, "  ");
+    fprintf(g->out, "  let QWORD l%u = ", i);
+    write_expr(g, p->depth);
+    fprintf(g->out, ";\n");
+    g->locals++;
+  }
+  maybe_comment(g, "  ");
+  fprintf(g->out, "  if (");
+  write_expr(g, p->depth / 2);
+  fprintf(g->out, " > b) {\n    a = ");
+  write_expr(g, p->depth);
+  fprintf(g->out, ";\n  }\n");
+  maybe_comment(g, "  ");
+  fprintf(g->out, "  return ");
+  write_expr(g, p->depth);
+  fprintf(g->out, ";\n}\n\n");
+}
+
+void avgen_write(FILE* out, const avgen_params* params) {
+  avgen g = { .out = out, .params = params, .rng = params->seed * 2654435761ULL + 1 };
+  for (g.func = 0; g.func < params->funcs; g.func++) {
+    write_func(&g);
+  }
+  fprintf(out, "fn DWORD main () {\n");
+  // later functions fan out into calls to earlier ones, so only the first
+  // one is cheap enough to run
+  if (params->funcs > 0) {
+    fprintf(out, "  let QWORD r = call f0(1, 2);\n");
+  }
+  fprintf(out, "  return 0;\n}\n");
+}
@@ -0,0 +1,24 @@
+#ifndef BENCH_AVGEN_H
+#define BENCH_AVGEN_H
+#include <stdio.h>
+
+/// shape of a synthetic A program
+typedef struct {
+  unsigned int funcs;    ///< functions besides main
+  unsigned int depth;    ///< depth of every generated expression tree
+  unsigned int locals;   ///< let declarations per function
+  unsigned int comments; ///< comment lines per 100 statements
+  unsigned long seed;    ///< the same seed always gives the same program
+} avgen_params;
+
+/// the defaults gen_av uses when no option overrides them
+avgen_params avgen_defaults(void);
+
+/// writes a valid program: functions take two QWORD parameters, declare
+/// their locals from expressions over earlier values and calls to earlier
+/// functions, branch once and return an expression. main calls the first one
+/// @param out the stream to write to
+/// @param params the program shape
+void avgen_write(FILE* out, const avgen_params* params);
+
+#endif
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "avgen.h"
+#include "tokenizer/tokenizer.h"
+#include "parser/parser.h"
+#include "assembler/assembler.h"
+#include "utils/stats.h"
+
+/// one program shape and the best time each phase took on it
+typedef struct {
+  const char* name;
+  avgen_params params;
+  size_t bytes;
+  unsigned long long nodes;
+  unsigned long long insns;
+  double tokenize_s;
+  double parse_s;
+  double codegen_s;
+} bench_case;
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double best(double current, double sample) {
+  return current == 0 || sample < current ? sample : current;
+}
+
+/// compiles the case's program reps times, keeping the fastest run of each
+/// phase since the slower ones only measure noise
+static void run_case(bench_case* c, unsigned int reps) {
+  char* src = NULL;
+  size_t len = 0;
+  FILE* mem = open_memstream(&src, &len);
+  avgen_write(mem, &c->params);
+  fclose(mem);
+  c->bytes = len;
+
+  for (unsigned int r = 0; r < reps; r++) {
+    FILE* in = fmemopen(src, len, "r");
+    double t0 = now_s();
+    ArrayList* tokens = tokenize(in, len);
+    double t1 = now_s();
+    fclose(in);
+
+    unsigned long long nodes = stat_get(STAT_NODE_ALLOCS);
+    Node* program = parse_program(tokens);
+    double t2 = now_s();
+    c->nodes = stat_get(STAT_NODE_ALLOCS) - nodes;
+
+    FILE* out = fopen("/dev/null", "w");
+    asm_ctx* ctx = asm_init_file(out);
+    ctx->opts = asm_default_opts(1);
+    unsigned long long insns = stat_get(STAT_INSNS);
+    double t3 = now_s();
+    gen_program(ctx, program);
+    fflush(out);
+    double t4 = now_s();
+    c->insns = stat_get(STAT_INSNS) - insns;
+    asm_free(ctx);
+
+    c->tokenize_s = best(c->tokenize_s, t1 - t0);
+    c->parse_s = best(c->parse_s, t2 - t1);
+    c->codegen_s = best(c->codegen_s, t4 - t3);
+    free_node(program);
+    destroy_list(tokens);
+  }
+  free(src);
+}
+
+int main(int argc, char* argv[]) {
+  unsigned int reps = 5;
+  bool json = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else {
+      fprintf(stderr, "usage: %s [--reps <n>] [--json]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (reps == 0) { reps = 1; }
+  stats_enabled = true;
+
+  bench_case cases[] = {
+    { .name = "small",    .params = { .funcs = 100,  .depth = 4, .locals = 4,  .comments = 10, .seed = 1 } },
+    { .name = "medium",   .params = { .funcs = 1000, .depth = 4, .locals = 4,  .comments = 10, .seed = 2 } },
+    { .name = "large",    .params = { .funcs = 5000, .depth = 4, .locals = 4,  .comments = 10, .seed = 3 } },
+    { .name = "deep",     .params = { .funcs = 500,  .depth = 8, .locals = 4,  .comments = 10, .seed = 4 } },
+    { .name = "wide",     .params = { .funcs = 500,  .depth = 3, .locals = 32, .comments = 10, .seed = 5 } },
+    { .name = "comments", .params = { .funcs = 1000, .depth = 3, .locals = 4,  .comments = 90, .seed = 6 } },
+  };
+  size_t count = sizeof(cases) / sizeof(cases[0]);
+
+  if (!json) {
+    printf("%-9s %6s %5s %6s %9s %10s %12s %12s %12s\n", "case", "funcs", "depth", "locals",
+           "KiB", "nodes", "lex MB/s", "parse Mn/s", "emit Mi/s");
+  }
+  for (size_t i = 0; i < count; i++) {
+    bench_case* c = &cases[i];
+    run_case(c, reps);
+    double lex_mbs = c->bytes / c->tokenize_s / 1e6;
+    double parse_nps = c->nodes / c->parse_s;
+    double emit_ips = c->insns / c->codegen_s;
+    if (json) {
+      printf("{\"case\":\"%s\",\"funcs\":%u,\"depth\":%u,\"locals\":%u,\"comments\":%u,"
+             "\"bytes\":%zu,\"nodes\":%llu,\"insns\":%llu,\"tokenize_s\":%.6f,\"parse_s\":%.6f,"
+             "\"codegen_s\":%.6f,\"lex_mb_per_s\":%.2f,\"nodes_per_s\":%.0f,\"insns_per_s\":%.0f}\n",
+             c->name, c->params.funcs, c->params.depth, c->params.locals, c->params.comments,
+             c->bytes, c->nodes, c->insns, c->tokenize_s, c->parse_s, c->codegen_s,
+             lex_mbs, parse_nps, emit_ips);
+    } else {
+      printf("%-9s %6u %5u %6u %9.1f %10llu %12.2f %12.2f %12.2f\n", c->name, c->params.funcs,
+             c->params.depth, c->params.locals, c->bytes / 1024.0, c->nodes, lex_mbs,
+             parse_nps / 1e6, emit_ips / 1e6);
+    }
+    fflush(stdout);
+  }
+  return EXIT_SUCCESS;
+}
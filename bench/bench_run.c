@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef BENCH_KERNEL_DIR
+#define BENCH_KERNEL_DIR "bench/kernels"
+#endif
+
+/// kernels live in the kernel directory as <name>.av with an equivalent
+/// <name>.c; both return 0 from main when they computed the right answer
+static const char* kernels[] = { "fib", "arith", "calls", "loop", "vector" };
+
+typedef enum { LANG_A, LANG_C } lang_t;
+
+/// one way of building a kernel
+typedef struct {
+  const char* name;
+  lang_t lang;
+  const char* opt;
+} variant_t;
+
+static const variant_t variants[] = {
+  { "A -O0", LANG_A, "-O0" },
+  { "A -O2", LANG_A, "-O2" },
+  { "C -O0", LANG_C, "-O0" },
+  { "C -O2", LANG_C, "-O2" },
+};
+
+#define VARIANT_COUNT (sizeof(variants) / sizeof(variants[0]))
+
+/// best run of one kernel built one way, counters are 0 when unavailable
+typedef struct {
+  bool ok;
+  double wall_s;
+  double user_s;
+  uint64_t cycles;
+  uint64_t insns;
+} run_result;
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/// runs argv to completion with its output discarded
+/// @return true when it exited with status 0
+static bool run_quiet(char* const argv[]) {
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) { return false; }
+  if (pid == 0) {
+    freopen("/dev/null", "w", stdout);
+    freopen("/dev/null", "w", stderr);
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  int status;
+  if (waitpid(pid, &status, 0) < 0) { return false; }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/// opens a user space counter on pid which starts counting when pid execs
+/// @return the counter fd, -1 when the kernel does not allow it
+static int open_counter(pid_t pid, uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.enable_on_exec = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+static uint64_t read_counter(int fd) {
+  uint64_t value = 0;
+  if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value)) { return 0; }
+  return value;
+}
+
+/// runs a built kernel once, the child waits on a pipe until the counters
+/// are attached so they cover exactly the exec'd program
+static run_result run_once(const char* exe) {
+  run_result res = { 0 };
+  int gate[2];
+  if (pipe(gate) < 0) { return res; }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid < 0) { return res; }
+  if (pid == 0) {
+    char c;
+    close(gate[1]);
+    if (read(gate[0], &c, 1) != 1) { _exit(127); }
+    execl(exe, exe, (char*)NULL);
+    _exit(127);
+  }
+  close(gate[0]);
+  int cycles_fd = open_counter(pid, PERF_COUNT_HW_CPU_CYCLES);
+  int insns_fd = open_counter(pid, PERF_COUNT_HW_INSTRUCTIONS);
+  double start = now_s();
+  if (write(gate[1], "x", 1) != 1) { /* the child exits on EOF */ }
+  close(gate[1]);
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) < 0) { return res; }
+  res.wall_s = now_s() - start;
+  res.user_s = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6;
+  res.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  res.cycles = read_counter(cycles_fd);
+  res.insns = read_counter(insns_fd);
+  if (cycles_fd >= 0) { close(cycles_fd); }
+  if (insns_fd >= 0) { close(insns_fd); }
+  return res;
+}
+
+/// copies a file, used to keep the driver's .s and .o out of the source tree
+static bool copy_file(const char* from, const char* to) {
+  FILE* in = fopen(from, "rb");
+  if (!in) { return false; }
+  FILE* out = fopen(to, "wb");
+  if (!out) {
+    fclose(in);
+    return false;
+  }
+  char buf[8192];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) { fwrite(buf, 1, n, out); }
+  fclose(in);
+  return fclose(out) == 0;
+}
+
+/// builds one kernel variant inside dir
+/// @return false when the compiler rejected it
+static bool build(const char* compiler, const char* kernel_dir, const char* dir,
+                  const char* kernel, const variant_t* v, const char* exe) {
+  const char* ext = v->lang == LANG_A ? "av" : "c";
+  char orig[PATH_MAX];
+  char src[PATH_MAX];
+  snprintf(orig, sizeof(orig), "%s/%s.%s", kernel_dir, kernel, ext);
+  snprintf(src, sizeof(src), "%s/%s.%s", dir, kernel, ext);
+  if (!copy_file(orig, src)) { return false; }
+  if (v->lang == LANG_A) {
+    char* argv[] = { (char*)compiler, (char*)v->opt, src, "-o", (char*)exe, NULL };
+    return run_quiet(argv);
+  }
+  char* argv[] = { "cc", (char*)v->opt, src, "-o", (char*)exe, NULL };
+  return run_quiet(argv);
+}
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+    "usage: %s [--compiler <path>] [--kernels <dir>] [--reps <n>] [--json]\n"
+    "  builds every kernel with the A compiler and with cc at -O0 and -O2,\n"
+    "  runs each build and reports its fastest run\n"
+    "  --compiler: the ACompiler binary (default ./ACompiler)\n"
+    "  --kernels:  directory holding <kernel>.av and <kernel>.c (default %s)\n"
+    "  --reps:     runs per build (default 5)\n"
+    "  --json:     one JSON object per build instead of a table\n",
+    prog, BENCH_KERNEL_DIR);
+}
+
+int main(int argc, char* argv[]) {
+  const char* compiler = "./ACompiler";
+  const char* kernel_dir = BENCH_KERNEL_DIR;
+  unsigned int reps = 5;
+  bool json = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--compiler") == 0 && i + 1 < argc) {
+      compiler = argv[++i];
+    } else if (strcmp(argv[i], "--kernels") == 0 && i + 1 < argc) {
+      kernel_dir = argv[++i];
+    } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+      reps = (unsigned int)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--json") == 0) {
+      json = true;
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (reps == 0) { reps = 1; }
+
+  char dir[] = "/tmp/acompiler-bench-XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    fprintf(stderr, "bench_run: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  bool counters = false;
+  bool failed = false;
+  if (!json) {
+    printf("%-7s %-6s %10s %10s %14s %14s %6s %8s\n", "kernel", "build", "wall ms", "user ms",
+           "cycles", "insns", "IPC", "vs C-O2");
+  }
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    run_result best[VARIANT_COUNT] = { 0 };
+    for (size_t v = 0; v < VARIANT_COUNT; v++) {
+      char exe[PATH_MAX];
+      snprintf(exe, sizeof(exe), "%s/%s-%zu", dir, kernels[k], v);
+      if (!build(compiler, kernel_dir, dir, kernels[k], &variants[v], exe)) {
+        fprintf(stderr, "bench_run: %s did not build with %s\n", kernels[k], variants[v].name);
+        failed = true;
+        continue;
+      }
+      for (unsigned int r = 0; r < reps; r++) {
+        run_result res = run_once(exe);
+        if (!res.ok) {
+          fprintf(stderr, "bench_run: %s built with %s gave the wrong answer\n", kernels[k],
+                  variants[v].name);
+          failed = true;
+          best[v].ok = false;
+          break;
+        }
+        if (!best[v].ok || res.wall_s < best[v].wall_s) { best[v] = res; }
+      }
+      unlink(exe);
+      counters |= best[v].cycles != 0;
+    }
+
+    // C at -O2 is the yardstick every other build is measured against
+    double base = best[VARIANT_COUNT - 1].ok ? best[VARIANT_COUNT - 1].wall_s : 0;
+    for (size_t v = 0; v < VARIANT_COUNT; v++) {
+      const run_result* b = &best[v];
+      if (!b->ok) { continue; }
+      double ratio = base > 0 ? b->wall_s / base : 0;
+      double ipc = b->cycles ? (double)b->insns / b->cycles : 0;
+      if (json) {
+        printf("{\"kernel\":\"%s\",\"build\":\"%s\",\"wall_s\":%.6f,\"user_s\":%.6f,"
+               "\"cycles\":%llu,\"insns\":%llu,\"vs_c_o2\":%.3f}\n",
+               kernels[k], variants[v].name, b->wall_s, b->user_s,
+               (unsigned long long)b->cycles, (unsigned long long)b->insns, ratio);
+      } else {
+        printf("%-7s %-6s %10.2f %10.2f %14llu %14llu %6.2f %7.2fx\n", kernels[k],
+               variants[v].name, b->wall_s * 1e3, b->user_s * 1e3,
+               (unsigned long long)b->cycles, (unsigned long long)b->insns, ipc, ratio);
+      }
+    }
+    fflush(stdout);
+  }
+  if (!counters) {
+    fprintf(stderr, "bench_run: hardware counters unavailable, cycles and insns are 0 "
+                    "(see /proc/sys/kernel/perf_event_paranoid)\n");
+  }
+  // the driver leaves <kernel>.s and <kernel>.o next to the copied source
+  for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+    const char* exts[] = { "av", "c", "s", "o" };
+    for (size_t e = 0; e < sizeof(exts) / sizeof(exts[0]); e++) {
+      char path[PATH_MAX];
+      snprintf(path, sizeof(path), "%s/%s.%s", dir, kernels[k], exts[e]);
+      unlink(path);
+    }
+  }
+  rmdir(dir);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
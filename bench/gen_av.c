@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "avgen.h"
+
+static void usage(const char* prog) {
+  fprintf(stderr,
+    "usage: %s [--funcs <n>] [--depth <n>] [--locals <n>] [--comments <n>] [--seed <n>]\n"
+    "  writes a synthetic A program to stdout\n"
+    "  --funcs:    functions besides main (default 100)\n"
+    "  --depth:    depth of every expression tree (default 4)\n"
+    "  --locals:   let declarations per function (default 4)\n"
+    "  --comments: comment lines per 100 statements (default 10)\n"
+    "  --seed:     the same seed always gives the same program (default 1)\n",
+    prog);
+}
+
+int main(int argc, char* argv[]) {
+  avgen_params params = avgen_defaults();
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    char* end;
+    unsigned long value = strtoul(argv[i + 1], &end, 10);
+    if (*end != '\0') {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    if (strcmp(argv[i], "--funcs") == 0) {
+      params.funcs = (unsigned int)value;
+    } else if (strcmp(argv[i], "--depth") == 0) {
+      params.depth = (unsigned int)value;
+    } else if (strcmp(argv[i], "--locals") == 0) {
+      params.locals = (unsigned int)value;
+    } else if (strcmp(argv[i], "--comments") == 0) {
+      params.comments = (unsigned int)value;
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      params.seed = value;
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    i++;
+  }
+  avgen_write(stdout, &params);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#include <stdint.h>
+
+static uint64_t mix(uint64_t x, uint64_t y) {
+  uint64_t a = x * 31 + y;
+  uint64_t b = (a * a - x) * 7 + (y * 3 - a);
+  uint64_t c = (b - a * 5) * (x + 11) + b * 13;
+  uint64_t d = (c + a) * (b - 3) - c * 17;
+  uint64_t e = (d * 5 + c) * (a + 2) - d;
+  uint64_t f = (e - b) * (c + 9) + e * 23;
+  uint64_t g = (f + d) * (e - 1) - f * 29;
+  return g * 3 + f - e + d - c + b - a;
+}
+
+static uint64_t sum(uint64_t lo, uint64_t hi) {
+  if (hi - lo <= 1) {
+    return mix(lo, lo * 3 + 1);
+  }
+  uint64_t mid = lo + (hi - lo) / 2;
+  return sum(lo, mid) + sum(mid, hi);
+}
+
+int main(void) {
+  uint64_t r = sum(0, 2000000);
+  return r != 3452584066258996992;
+}
@@ -0,0 +1,442 @@
+.text
+.globl mix
+mix:
+    .cfi_startproc
+    subq $72, %rsp
+    .cfi_def_cfa_offset 80
+.Lmix.1:
+    movq %rdi, 64(%rsp)
+    movq %rsi, 56(%rsp)
+    movq 64(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $31, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 64(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 48(%rsp)
+    movq 48(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 72(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $7, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 64(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 64(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 40(%rsp)
+    movq 40(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $5, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 72(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $11, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 48(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $13, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 32(%rsp)
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 48(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 40(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $17, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, 24(%rsp)
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $5, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 40(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $2, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 48(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 40(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $9, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $23, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 8(%rsp)
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $29, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, 0(%rsp)
+    movq 0(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 16(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 40(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 48(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    jmp .Lmix.0
+.Lmix.0:
+    addq $72, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl sum
+sum:
+    .cfi_startproc
+    subq $40, %rsp
+    .cfi_def_cfa_offset 48
+.Lsum.1:
+    movq %rdi, 32(%rsp)
+    movq %rsi, 24(%rsp)
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 40(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setle %al
+    movzbq %al, %rax
+    cmpq $0, %rax
+    je .Lsum.2
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, %rsi
+    movq 32(%rsp), %rdi
+    .cfi_remember_state
+    addq $40, %rsp
+    .cfi_def_cfa_offset 8
+    jmp mix
+    .cfi_restore_state
+    jmp .Lsum.3
+.Lsum.2:
+.Lsum.3:
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 48(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $2, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cqto
+    idivq %rcx
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 16(%rsp)
+    movq 32(%rsp), %rdi
+    movq 16(%rsp), %rsi
+    call sum
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    subq $8, %rsp
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rdi
+    movq 40(%rsp), %rsi
+    call sum
+    addq $8, %rsp
+    .cfi_adjust_cfa_offset -8
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    jmp .Lsum.0
+.Lsum.0:
+    addq $40, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl main
+main:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lmain.1:
+    movq $0, %rdi
+    movq $2000000, %rsi
+    call sum
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3452584066258996992, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setne %al
+    movzbq %al, %rax
+    movslq %eax, %rax
+    jmp .Lmain.0
+.Lmain.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
@@ -0,0 +1,123 @@
+.text
+.globl ack
+ack:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lack.1:
+    movq %rdi, 16(%rsp)
+    movq %rsi, 8(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $0, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    sete %al
+    movzbq %al, %rax
+    cmpq $0, %rax
+    je .Lack.2
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    jmp .Lack.0
+    jmp .Lack.3
+.Lack.2:
+.Lack.3:
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $0, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    sete %al
+    movzbq %al, %rax
+    cmpq $0, %rax
+    je .Lack.4
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rdi
+    movq $1, %rsi
+    jmp .Lack.1
+    jmp .Lack.5
+.Lack.4:
+.Lack.5:
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    subq $8, %rsp
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rsi
+    movq 32(%rsp), %rdi
+    call ack
+    addq $8, %rsp
+    .cfi_adjust_cfa_offset -8
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    popq %rsi
+    .cfi_adjust_cfa_offset -8
+    popq %rdi
+    .cfi_adjust_cfa_offset -8
+    jmp .Lack.1
+.Lack.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl main
+main:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lmain.1:
+    movq $3, %rdi
+    movq $9, %rsi
+    call ack
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $4093, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setne %al
+    movzbq %al, %rax
+    movslq %eax, %rax
+    jmp .Lmain.0
+.Lmain.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
@@ -0,0 +1,13 @@
+#include <stdint.h>
+
+static int64_t fib(int64_t n) {
+  if (n <= 1) {
+    return n;
+  }
+  return fib(n - 1) + fib(n - 2);
+}
+
+int main(void) {
+  int64_t r = fib(35);
+  return r != 9227465;
+}
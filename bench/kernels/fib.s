@@ -0,0 +1,87 @@
+.text
+.globl fib
+fib:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lfib.1:
+    movq %rdi, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setle %al
+    movzbq %al, %rax
+    cmpq $0, %rax
+    je .Lfib.2
+    movq 16(%rsp), %rax
+    jmp .Lfib.0
+    jmp .Lfib.3
+.Lfib.2:
+.Lfib.3:
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rdi
+    call fib
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    subq $8, %rsp
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $2, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, %rdi
+    call fib
+    addq $8, %rsp
+    .cfi_adjust_cfa_offset -8
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    jmp .Lfib.0
+.Lfib.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl main
+main:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lmain.1:
+    movq $35, %rdi
+    call fib
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $9227465, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setne %al
+    movzbq %al, %rax
+    movslq %eax, %rax
+    jmp .Lmain.0
+.Lmain.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
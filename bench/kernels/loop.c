@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+static uint64_t kernel(uint64_t n, uint64_t k) {
+  uint64_t acc = 0;
+  for (uint64_t i = 0; i < n; i = i + 1) {
+    for (uint64_t j = 0; j < 1000; j = j + 1) {
+      acc = acc + i * j + (k * 7 - 3);
+    }
+  }
+  return acc;
+}
+
+int main(void) {
+  uint64_t r = kernel(20000, 5);
+  return r != 99895645000000;
+}
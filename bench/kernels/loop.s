@@ -0,0 +1,116 @@
+.text
+.globl kernel
+kernel:
+    .cfi_startproc
+    subq $56, %rsp
+    .cfi_def_cfa_offset 64
+.Lkernel.1:
+    movq %rdi, 48(%rsp)
+    movq %rsi, 40(%rsp)
+    movq $0, %rax
+    movq %rax, 32(%rsp)
+    movq $0, %rax
+    movq %rax, 24(%rsp)
+    movq 40(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $7, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $3, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    movq %rax, 16(%rsp)
+    jmp .Lkernel.3
+.Lkernel.2:
+    movq $0, %rax
+    movq %rax, 8(%rsp)
+    movq 16(%rsp), %rax
+    movq %rax, 0(%rsp)
+    jmp .Lkernel.5
+.Lkernel.4:
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 32(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 8(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq %rax, 32(%rsp)
+    incq 8(%rsp)
+.Lkernel.5:
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1000, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.4
+    incq 24(%rsp)
+.Lkernel.3:
+    movq 24(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 56(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.2
+    movq 32(%rsp), %rax
+    jmp .Lkernel.0
+.Lkernel.0:
+    addq $56, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl main
+main:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lmain.1:
+    movq $20000, %rdi
+    movq $5, %rsi
+    call kernel
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $99895645000000, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setne %al
+    movzbq %al, %rax
+    movslq %eax, %rax
+    jmp .Lmain.0
+.Lmain.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
@@ -0,0 +1,28 @@
+#include <stdint.h>
+
+static int32_t a[4096];
+static int32_t b[4096];
+static int32_t c[4096];
+
+static uint64_t kernel(uint64_t reps) {
+  for (uint64_t i = 0; i < 4096; i = i + 1) {
+    a[i] = i;
+    b[i] = 3 * i + 1;
+  }
+  for (uint64_t r = 0; r < reps; r = r + 1) {
+    for (uint64_t i = 0; i < 4096; i = i + 1) {
+      c[i] = a[i] + b[i];
+      a[i] = c[i] - b[i] + 1;
+    }
+  }
+  uint64_t s = 0;
+  for (uint64_t i = 0; i < 4096; i = i + 1) {
+    s = s + c[i];
+  }
+  return s;
+}
+
+int main(void) {
+  uint64_t r = kernel(20000);
+  return r != 115466240;
+}
@@ -0,0 +1,205 @@
+.data
+.balign 4
+a:
+    .zero 16384
+.balign 4
+b:
+    .zero 16384
+.balign 4
+c:
+    .zero 16384
+.text
+.globl kernel
+kernel:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lkernel.1:
+    movq %rdi, 16(%rsp)
+    movq $0, %rax
+    movq %rax, 8(%rsp)
+    jmp .Lkernel.3
+.Lkernel.2:
+    movq 8(%rsp), %rax
+    movq 8(%rsp), %rcx
+    leaq a(%rip), %rdx
+    movl %eax, (%rdx,%rcx,4)
+    movq $3, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 16(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    imulq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq 8(%rsp), %rcx
+    leaq b(%rip), %rdx
+    movl %eax, (%rdx,%rcx,4)
+    incq 8(%rsp)
+.Lkernel.3:
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $4096, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.2
+    movq $0, %rax
+    movq %rax, 8(%rsp)
+    jmp .Lkernel.5
+.Lkernel.4:
+    movq $0, %rax
+    movq %rax, 0(%rsp)
+    movq $1, %rax
+    movd %eax, %xmm8
+    pshufd $0, %xmm8, %xmm8
+    movq $4096, %rax
+    movq %rax, %r8
+    movq 0(%rsp), %rcx
+    jmp .Lkernel.7
+.Lkernel.6:
+    leaq a(%rip), %rdx
+    movdqu (%rdx,%rcx,4), %xmm0
+    leaq b(%rip), %rdx
+    movdqu (%rdx,%rcx,4), %xmm1
+    paddd %xmm1, %xmm0
+    leaq c(%rip), %rdx
+    movdqu %xmm0, (%rdx,%rcx,4)
+    leaq c(%rip), %rdx
+    movdqu (%rdx,%rcx,4), %xmm0
+    leaq b(%rip), %rdx
+    movdqu (%rdx,%rcx,4), %xmm1
+    psubd %xmm1, %xmm0
+    paddd %xmm8, %xmm0
+    leaq a(%rip), %rdx
+    movdqu %xmm0, (%rdx,%rcx,4)
+    addq $4, %rcx
+.Lkernel.7:
+    leaq 4(%rcx), %rdx
+    cmpq %r8, %rdx
+    jle .Lkernel.6
+    movq %rcx, 0(%rsp)
+    jmp .Lkernel.9
+.Lkernel.8:
+    movq 0(%rsp), %rcx
+    leaq a(%rip), %rdx
+    movslq (%rdx,%rcx,4), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 8(%rsp), %rcx
+    leaq b(%rip), %rdx
+    movslq (%rdx,%rcx,4), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq 0(%rsp), %rcx
+    leaq c(%rip), %rdx
+    movl %eax, (%rdx,%rcx,4)
+    movq 0(%rsp), %rcx
+    leaq c(%rip), %rdx
+    movslq (%rdx,%rcx,4), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 8(%rsp), %rcx
+    leaq b(%rip), %rdx
+    movslq (%rdx,%rcx,4), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    subq %rcx, %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $1, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    addq %rcx, %rax
+    movq 0(%rsp), %rcx
+    leaq a(%rip), %rdx
+    movl %eax, (%rdx,%rcx,4)
+    incq 0(%rsp)
+.Lkernel.9:
+    movq 0(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $4096, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.8
+    incq 8(%rsp)
+.Lkernel.5:
+    movq 8(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq 24(%rsp), %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.4
+    movq $0, %rax
+    movq %rax, 8(%rsp)
+    movq $0, %rax
+    movq %rax, 0(%rsp)
+    jmp .Lkernel.11
+.Lkernel.10:
+    movq 0(%rsp), %rcx
+    leaq c(%rip), %rdx
+    movslq (%rdx,%rcx,4), %rax
+    addq %rax, 8(%rsp)
+    incq 0(%rsp)
+.Lkernel.11:
+    movq 0(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $4096, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    jl .Lkernel.10
+    movq 8(%rsp), %rax
+    jmp .Lkernel.0
+.Lkernel.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
+.globl main
+main:
+    .cfi_startproc
+    subq $24, %rsp
+    .cfi_def_cfa_offset 32
+.Lmain.1:
+    movq $20000, %rdi
+    call kernel
+    movq %rax, 16(%rsp)
+    movq 16(%rsp), %rax
+    pushq %rax
+    .cfi_adjust_cfa_offset 8
+    movq $115466240, %rax
+    movq %rax, %rcx
+    popq %rax
+    .cfi_adjust_cfa_offset -8
+    cmpq %rcx, %rax
+    setne %al
+    movzbq %al, %rax
+    movslq %eax, %rax
+    jmp .Lmain.0
+.Lmain.0:
+    addq $24, %rsp
+    .cfi_def_cfa_offset 8
+    ret
+    .cfi_endproc
@@ -6,6 +6,7 @@
 #include "parser/parser.h"
 #include "utils/hashtable.h"
 #include "utils/stack.h"
+#include "utils/cache.h"
 #include "assembler/emitter.h"
 
 typedef struct {
@@ -20,15 +21,54 @@ typedef struct {
   long base_offset;
 } scope_t;
 
+/// the vector instruction set loops may be vectorized for
+typedef enum {
+  ISA_SSE2,  ///< x86-64, every x86-64 cpu
+  ISA_SSE42, ///< x86-64-v2, adds 64 bit packed compares
+  ISA_AVX2,  ///< x86-64-v3, 256 bit integer vectors
+} target_isa;
+
+/// code generation options, usually derived from the -O level
+typedef struct {
+  unsigned int opt_level;
+  bool omit_frame_pointer; ///< address locals off %rsp and drop %rbp
+  bool optimize_sibling_calls; ///< turn calls in tail position into jumps
+  bool whole_program; ///< only main is exported, other functions stay local
+  bool bounds_check;  ///< trap on array indexes outside the declared length
+  bool vectorize;     ///< run element-wise array loops several elements at a time
+  target_isa isa;     ///< the newest instructions generated code may use
+  unsigned int jobs;  ///< functions generated in parallel, 0 for one per cpu
+  compile_cache* fragments; ///< per-function assembly reused across runs, NULL for none
+  uint64_t fragment_salt;   ///< mixed into every fragment key, e.g. the compiler build
+} asm_opts;
+
 typedef struct {
   emitter* emitter;
   Stack* scope_stk;
   long cur_offset;
   unsigned int label_count;
+  const char* label_prefix; ///< name of the current function, labels are .L<prefix>.<n>
   unsigned int push_depth;
   const char* epilogue_label;
+  const char* entry_label; ///< target for self tail calls, NULL when unused
+  Node* cur_func;          ///< the function decl being generated
+  bool frame_escapes;      ///< a slot's address is taken, so the frame must outlive every call
+  asm_opts opts;
+  bool use_rbp;     ///< current function keeps a frame pointer
+  long frame_size;  ///< bytes subtracted from %rsp when use_rbp is false
+  unsigned int stack_align; ///< %rsp is realigned to this for vector slots, 0 when not
+  bool uses_ymm;    ///< 256 bit registers were written, vzeroupper before calls and returns
+  unsigned int funcs_reused; ///< functions spliced in from opts.fragments
+  const char* trap_label;  ///< the current function's bounds check failure, NULL until used
+  ArrayList* proven;       ///< index nodes a loop preheader already bounds checked
+  unsigned int loops_vectorized;
 } asm_ctx;
 
+/// returns the default code generation options for an optimization level
+/// @param opt_level the optimization level (0 - 3)
+/// @return the options enabled at that level
+asm_opts asm_default_opts(unsigned int opt_level);
+
 /// initalizes an asm_ctx that emits to the given file path
 /// @param output_file the path to the assembly output file
 /// @return the initalized asm_ctx
@@ -52,6 +92,13 @@ void asm_free_keep_file(asm_ctx* ctx);
 /// @param program the AST program node
 void gen_program(asm_ctx* ctx, Node* program);
 
+/// writes generated assembly as JSON lines, one object per line of text
+/// tagged with its kind (insn, label or directive) and the function or
+/// global it belongs to
+/// @param out the stream to write to
+/// @param text the assembly to read, from its current position
+void dump_asm_json(FILE* out, FILE* text);
+
 /// emits assembly for a single function decleration
 /// @param ctx the asm_ctx to emit through
 /// @param node the function decl node
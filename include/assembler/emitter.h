@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include "parser/parser.h"
 
 typedef enum {
@@ -21,14 +22,32 @@ typedef enum {
   REG_R12,
   REG_R13,
   REG_R14,
-  REG_R15
+  REG_R15,
+  REG_XMM0, ///< vector registers, XMM at SZ_128 and YMM at SZ_256
+  REG_XMM1,
+  REG_XMM2,
+  REG_XMM3,
+  REG_XMM4,
+  REG_XMM5,
+  REG_XMM6,
+  REG_XMM7,
+  REG_XMM8,
+  REG_XMM9,
+  REG_XMM10,
+  REG_XMM11,
+  REG_XMM12,
+  REG_XMM13,
+  REG_XMM14,
+  REG_XMM15
 } regid;
 
 typedef enum {
   SZ_8,  ///< BYTE
   SZ_16, ///< WORD
   SZ_32, ///< DWORD
-  SZ_64  ///< QWORD
+  SZ_64, ///< QWORD
+  SZ_128, ///< V128, an XMM register
+  SZ_256  ///< V256, a YMM register
 } regsize;
 
 typedef enum {
@@ -46,6 +65,9 @@ typedef struct {
 typedef struct {
   reg_t base;
   long disp;
+  bool has_index; ///< disp(base,index,scale) instead of disp(base)
+  regid index;
+  unsigned int scale; ///< 1, 2, 4 or 8
 } mem_t;
 
 typedef struct {
@@ -76,11 +98,26 @@ operand_t* mk_immutable(long long imm);
 
 /// makes a memory operand
 /// @param id the register id of the memory operand
-/// @param size the size of the memorys register
+/// @param size the width of the memory access
 /// @param disp the displacement of the register operand
 /// @return the newly created memory operand
 operand_t* mk_mem(regid id, regsize size, long disp);
 
+/// makes a scaled index memory operand, disp(base,index,scale)
+/// @param base the register holding the base address
+/// @param index the register holding the element index
+/// @param scale the element size the index is multiplied by (1, 2, 4 or 8)
+/// @param size the width of the memory access
+/// @param disp the displacement added to the address
+/// @return the newly created memory operand
+operand_t* mk_mem_index(regid base, regid index, unsigned int scale, regsize size, long disp);
+
+/// the AT&T name of a register at a size, e.g. %eax or %ymm3
+/// @param size the size of the register, SZ_128 or SZ_256 for vector registers
+/// @param id the register id
+/// @return the register name
+const char* reg_to_str(regsize size, regid id);
+
 /// creates a label operand
 /// @param label the label
 /// @return the newly created label operand
@@ -120,6 +157,27 @@ void emit_globl(emitter* emitter, const char* name);
 /// @param dest the destination operand to mov to
 void emit_mov(emitter* emitter, operand_t* src, operand_t* dest);
 
+/// emits a zero extending mov instruction (movzbq, movzwl, ...)
+/// @param emitter the emitter to emit from
+/// @param src the narrower source operand, BYTE or WORD sized
+/// @param dest the wider destination register
+void emit_movzx(emitter* emitter, operand_t* src, operand_t* dest);
+
+/// emits a sign extending mov instruction (movsbq, movslq, ...)
+/// @param emitter the emitter to emit from
+/// @param src the narrower source operand
+/// @param dest the wider destination register
+void emit_movsx(emitter* emitter, operand_t* src, operand_t* dest);
+
+/// emits a whole vector move (movdqa, movdqu, vmovdqa, ...) between vector
+/// registers and memory
+/// @param emitter the emitter to emit from
+/// @param src the source operand, SZ_128 or SZ_256
+/// @param dest the destination operand, the same size as src
+/// @param aligned a memory operand is known to be aligned to the vector size
+/// @param vex use the AVX encoding, always the case for SZ_256
+void emit_vmov(emitter* emitter, operand_t* src, operand_t* dest, bool aligned, bool vex);
+
 /// emits a push instruction
 /// @param emitter the emitter to emit from
 /// @param op the operand to push to the stack
@@ -164,6 +222,47 @@ void emit_imul(emitter* emitter, operand_t* src, operand_t* dest);
 /// @param dividend the dividend of the divide instruction
 void emit_idiv(emitter* emitter, operand_t* divisor, operand_t* dividend);
 
+/// emits a bitwise and instruction
+/// @param emitter the emitter to emit from
+/// @param src the source operand to and with
+/// @param dest the destination operand to and into
+void emit_and(emitter* emitter, operand_t* src, operand_t* dest);
+
+/// emits a bitwise or instruction
+/// @param emitter the emitter to emit from
+/// @param src the source operand to or with
+/// @param dest the destination operand to or into
+void emit_or(emitter* emitter, operand_t* src, operand_t* dest);
+
+/// emits a bitwise xor instruction
+/// @param emitter the emitter to emit from
+/// @param src the source operand to xor with
+/// @param dest the destination operand to xor into
+void emit_xor(emitter* emitter, operand_t* src, operand_t* dest);
+
+/// emits a bitwise not instruction
+/// @param emitter the emitter to emit from
+/// @param op the operand to invert
+void emit_not(emitter* emitter, operand_t* op);
+
+/// emits a left shift instruction
+/// @param emitter the emitter to emit from
+/// @param count the shift count, an immediate or %cl
+/// @param dest the operand to shift, which also gives the size
+void emit_shl(emitter* emitter, operand_t* count, operand_t* dest);
+
+/// emits an arithmetic right shift instruction, which copies the sign bit in
+/// @param emitter the emitter to emit from
+/// @param count the shift count, an immediate or %cl
+/// @param dest the operand to shift, which also gives the size
+void emit_sar(emitter* emitter, operand_t* count, operand_t* dest);
+
+/// emits a logical right shift instruction, which shifts zeros in
+/// @param emitter the emitter to emit from
+/// @param count the shift count, an immediate or %cl
+/// @param dest the operand to shift, which also gives the size
+void emit_shr(emitter* emitter, operand_t* count, operand_t* dest);
+
 /// emits a jump instruction
 /// @param emitter the emitter to emit from
 /// @param jump_t the jump condition
@@ -0,0 +1,28 @@
+#ifndef OPTIMIZER_ANALYSIS_H
+#define OPTIMIZER_ANALYSIS_H
+#include <stdbool.h>
+#include "parser/parser.h"
+#include "utils/arraylist.h"
+
+/// checks if evaluating an expression can have no observable side effects
+/// @param node the expression to check
+/// @return true if the expression has no calls, assignments or increments
+bool expr_is_pure(Node* node);
+
+/// checks if control can never fall through the end of a statement
+/// @param node the statement to check
+/// @return true if every path through the statement returns
+bool stmt_always_returns(Node* node);
+
+/// evaluates an expression built only from number literals
+/// @param node the expression to evaluate
+/// @param out where the value is written on success
+/// @return true if the expression is a compile time constant
+bool const_eval(Node* node, long long* out);
+
+/// appends the name of every function called anywhere inside a node
+/// @param node the node to walk
+/// @param out list the callee names are added to (names are not copied)
+void collect_callees(Node* node, ArrayList* out);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef OPTIMIZER_DCE_H
+#define OPTIMIZER_DCE_H
+#include <stdbool.h>
+#include "parser/parser.h"
+
+/// dead code elimination options, usually derived from the -O level
+typedef struct {
+  bool enabled;
+  bool whole_program; ///< only main is exported, so unreferenced functions can be dropped
+  bool bounds_check;  ///< array indexes trap when out of range, so reading one is kept
+} dce_opts;
+
+/// returns the default dead code elimination options for an optimization level
+/// @param opt_level the optimization level (0 - 3)
+/// @return the options enabled at that level
+dce_opts dce_default_opts(unsigned int opt_level);
+
+/// removes code that can never run or whose result is never used: statements
+/// after a return, branches of constant if conditions, locals that are never
+/// read and, in whole program mode, functions that are never called
+/// @param program the AST program node, rewritten in place
+/// @param opts the dead code elimination options
+/// @return the number of statements and functions removed
+unsigned int dce_program(Node* program, const dce_opts* opts);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef OPTIMIZER_INLINER_H
+#define OPTIMIZER_INLINER_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "parser/parser.h"
+
+/// inliner tuning, usually derived from the -O level
+typedef struct {
+  bool enabled;
+  unsigned int max_size;  ///< largest callee body (in AST nodes) that is inlined
+  unsigned int max_depth; ///< how many levels of nested inlining are allowed
+  FILE* report;           ///< where decisions are written, NULL for no report
+} inline_opts;
+
+/// returns the default inliner options for an optimization level
+/// @param opt_level the optimization level (0 - 3)
+/// @return the options enabled at that level
+inline_opts inline_default_opts(unsigned int opt_level);
+
+/// substitutes the bodies of small non-recursive functions at their call
+/// sites. only functions whose body is a single return of an expression are
+/// candidates, so the result stays a plain expression tree
+/// @param program the AST program node, rewritten in place
+/// @param opts the inliner options
+/// @return the number of call sites that were inlined
+unsigned int inline_program(Node* program, const inline_opts* opts);
+
+#endif
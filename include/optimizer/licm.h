@@ -0,0 +1,25 @@
+#ifndef OPTIMIZER_LICM_H
+#define OPTIMIZER_LICM_H
+#include <stdbool.h>
+#include "parser/parser.h"
+
+/// loop invariant code motion options, usually derived from the -O level
+typedef struct {
+  bool enabled;
+} licm_opts;
+
+/// returns the default loop invariant code motion options for an optimization level
+/// @param opt_level the optimization level (0 - 3)
+/// @return the options enabled at that level
+licm_opts licm_default_opts(unsigned int opt_level);
+
+/// computes expressions whose operands no iteration of a loop can change once,
+/// before the loop, into a new QWORD local that the loop reads instead. only
+/// expressions that can not trap are moved, so a loop that never runs stays
+/// safe to hoist out of
+/// @param program the AST program node, rewritten in place
+/// @param opts the loop invariant code motion options
+/// @return the number of expressions hoisted
+unsigned int licm_program(Node* program, const licm_opts* opts);
+
+#endif
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "utils/arraylist.h"
 #include "tokenizer/tokens.h"
 
@@ -13,6 +14,8 @@ typedef enum {
   LIT_WORD,
   LIT_DWORD,
   LIT_QWORD,
+  LIT_V128, ///< 16 bytes, held in an XMM register
+  LIT_V256, ///< 32 bytes, held in a YMM register
 } lit_t;
 
 /// Variable address types
@@ -31,6 +34,8 @@ typedef enum {
   U_NEG,         ///< -
   U_NOT,         ///< !
   U_ADDR,        ///< &
+  U_DEREF,       ///< [ ], a load or store through an address
+  U_BIT_NOT,     ///< ~
 } unary_expr_t;
 
 /// binary expr types
@@ -45,6 +50,12 @@ typedef enum {
   B_NOT_EQUAL,   ///< !=
   B_GEQ,         ///< >=
   B_LEQ,         ///< <=
+  B_AND,         ///< &
+  B_OR,          ///< |
+  B_XOR,         ///< ^
+  B_SHL,         ///< <<
+  B_SAR,         ///< >>, keeps the sign
+  B_SHR,         ///< >>>, shifts in zeros
 } binary_expr_t;
 
 /// types of AST nodes
@@ -56,6 +67,7 @@ typedef enum {
   // statments
   AST_BLOCK,
   AST_IF,
+  AST_WHILE,
   AST_RETURN,
   AST_COMMENT,
   // expressions
@@ -110,6 +122,14 @@ typedef struct {
   Node* else_branch;
 } if_stmt;
 
+/// while and for loops, a for loop is parsed as a block holding its
+/// initializer followed by the loop
+typedef struct {
+  Node* cond;
+  Node* body;
+  Node* step; ///< runs after the body on every iteration, NULL for while loops
+} while_stmt;
+
 typedef struct {
   char* comment;
 } comment_stmt;
@@ -196,6 +216,7 @@ struct Node {
     // statments
     block_stmt blockStmt;
     if_stmt ifStmt;
+    while_stmt whileStmt;
     // expressions
     identifier_expr identifierExpr;
     literal_expr literalExpr;
@@ -283,6 +304,15 @@ Node* mk_binary_expr(binary_expr_t op, Node* expr_left, Node* expr_right);
 /// @return the newly created unary operator
 Node* mk_unary_expr(unary_expr_t op, Node* expr);
 
+/// makes target = target op value, the meaning of op=, ++ and --. the
+/// target may not have side effects, so reading and writing it agree
+/// @param op_token the operator token, for errors
+/// @param target the expression to update, which must be assignable
+/// @param op the operator to apply
+/// @param value the right operand of op
+/// @return the newly created assign expression
+Node* mk_update(Token* op_token, Node* target, binary_expr_t op, Node* value);
+
 /// creates a new literal expression, with either a num_value or str val
 /// @param num_value the number value of the literal expression
 /// @param str_value the string value of the literal expression
@@ -374,16 +404,42 @@ Node* parse_factor(Parser* parser);
 /// @return the parsed node
 Node* parse_term(Parser* parser);
 
+/// parses a shift expression (<<, >> or >>>)
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_shift(Parser* parser);
+
 /// parses a comparison expression (>, <)
 /// @param parser the parser to parse from
 /// @return the parsed node
 Node* parse_compare(Parser* parser);
 
+/// parses a bitwise and (&) of equality expressions
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_bit_and(Parser* parser);
+
+/// parses a bitwise xor (^) of bitwise ands
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_bit_xor(Parser* parser);
+
+/// parses a bitwise or (|) of bitwise xors
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_bit_or(Parser* parser);
+
 /// parses a binary expression
 /// @param parser the parser to parse from
 /// @return the parsed node
 Node* parse_binary_expr(Parser* parser);
 
+/// parses an expression statement or for loop step, which unlike other
+/// expressions can end in a postfix ++ or --
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_update_expr(Parser* parser);
+
 /// parses a cast expression
 /// @param parser the parser to parse from
 /// @return the parsed node
@@ -419,6 +475,16 @@ Node* parse_call_expr(Parser* parser);
 /// @return the parsed node
 Node* parse_if_stmt(Parser* parser);
 
+/// parses a while loop
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_while_stmt(Parser* parser);
+
+/// parses a for loop into a block of its initializer and a while loop
+/// @param parser the parser to parse from
+/// @return the parsed node
+Node* parse_for_stmt(Parser* parser);
+
 /// parses a block statment
 /// @param parser the parser to parse from
 /// @return the parsed node
@@ -449,6 +515,42 @@ Node* parse_func_decl(Parser* parser);
 /// @return the head of the ast
 Node* parse_program(ArrayList* nodes);
 
+/// a top level declaration found by brace matching, covering the tokens
+/// [start, end) of the token list
+typedef struct {
+  Token_type kind; ///< T_FUNC, T_LET or T_COMMENT, anything else is a syntax error
+  unsigned long long start;
+  unsigned long long end;
+} decl_range;
+
+/// splits a token stream into its top level declarations without parsing them
+/// @param tokens the tokens of the whole program
+/// @return a list of decl_range in source order, NULL if a declaration is never closed
+ArrayList* find_decl_ranges(ArrayList* tokens);
+
+/// parses a single top level declaration
+/// @param tokens the tokens of the whole program
+/// @param range the declaration to parse
+/// @return the parsed node
+Node* parse_decl_range(ArrayList* tokens, decl_range* range);
+
+/// parses the top level declarations of a program concurrently and assembles
+/// them in source order, the result is identical to parse_program
+/// @param tokens the list of tokens to parse
+/// @param jobs the number of parser threads, 0 for one per cpu
+/// @return the head of the ast
+Node* parse_program_parallel(ArrayList* tokens, unsigned int jobs);
+
+/// parses only the functions reachable from a set of roots. signatures are
+/// parsed up front and the call graph is followed by scanning each body's
+/// tokens, so bodies of unreachable functions are never parsed and never make
+/// it into the AST (syntax errors inside them are not reported)
+/// @param tokens the list of tokens to parse
+/// @param roots names of the entry point functions, NULL to treat every function as one
+/// @param jobs the number of parser threads, 0 for one per cpu
+/// @return the head of the ast
+Node* parse_program_lazy(ArrayList* tokens, ArrayList* roots, unsigned int jobs);
+
 /// inits the parser with an array of tokens
 /// @param tokens the list of tokens to init the parser with
 /// @return the newly created parser
@@ -484,12 +586,34 @@ Token* p_peek_next(Parser* parser);
 /// @return true if the token matches the type, false otherwise
 bool p_match(Token* token, Token_type type);
 
+/// allocates an uninitialized AST node. passes that build nodes use this so
+/// -fmem-report counts them
+/// @return the new node
+Node* new_node(void);
+
 /// recursively frees an AST node and all its children
 /// @param node the node to free
 void free_node(Node* node);
 
+/// deep copies an AST node, names and strings are shared with the original
+/// @param node the node to copy
+/// @return the newly allocated copy
+Node* clone_node(Node* node);
+
+/// folds the structure of an AST node into a hash. names, values and types
+/// count, comment text does not
+/// @param hash the hash so far, CACHE_HASH_INIT to start a new one
+/// @param node the node to hash
+/// @return the updated hash
+uint64_t hash_node(uint64_t hash, Node* node);
+
 /// prints out the AST
 /// @param head the head node of the ast
 void print_ast(Node* head);
 
+/// writes the AST as JSON lines, one object per top-level declaration
+/// @param out the stream to write to
+/// @param head the head node of the ast
+void dump_ast_json(FILE* out, Node* head);
+
 #endif
@@ -77,4 +77,14 @@ Token* createString(Tokenizer* tokenizer);
 /// @param tokenizer the tokenizer to create the number from
 /// @return the token of the number
 Token* createNumber(Tokenizer* tokenizer);
+
+/// returns the enum name of a token type, e.g. "T_IDENTIFIER"
+/// @param type the token type
+/// @return the name, "T_UNKNOWN" for values outside the enum
+const char* tokenTypeName(Token_type type);
+
+/// writes every token as one JSON object per line
+/// @param out the stream to write to
+/// @param tokens the tokens returned by tokenize
+void dumpTokensJson(FILE* out, ArrayList* tokens);
 #endif
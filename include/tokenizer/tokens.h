@@ -20,9 +20,13 @@ typedef enum {
   T_WORD,
   T_DWORD,
   T_QWORD,
+  T_V128,
+  T_V256,
   T_STRING_LIT,
 	T_NUMBER_LIT,
   T_RETURN,
+  T_WHILE,
+  T_FOR,
   // SINGULAR LEXMES
   T_SEMICOLON,
   T_COLON,
@@ -45,11 +49,29 @@ typedef enum {
   T_GREATER,
   T_LESS,
   T_NOT,
+  T_PIPE,
+  T_CARET,
+  T_TILDE,
   // DOUBLE CHAR LEXMES
   T_EQUAL_EQUAL,
   T_NOT_EQUAL,
   T_LESS_EQUAL,
   T_GREATER_EQUAL,
+  T_LESS_LESS,
+  T_GREATER_GREATER,
+  T_PLUS_EQUAL,
+  T_MINUS_EQUAL,
+  T_STAR_EQUAL,
+  T_DIVIDE_EQUAL,
+  T_AND_EQUAL,
+  T_PIPE_EQUAL,
+  T_CARET_EQUAL,
+  // TRIPLE CHAR LEXMES
+  T_GREATER_GREATER_GREATER,
+  T_LESS_LESS_EQUAL,
+  T_GREATER_GREATER_EQUAL,
+  // QUAD CHAR LEXMES
+  T_GREATER_GREATER_GREATER_EQUAL,
 } Token_type;
 
 typedef struct {
@@ -0,0 +1,92 @@
+#ifndef UTILS_CACHE_H
+#define UTILS_CACHE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// starting value for cache_hash
+#define CACHE_HASH_INIT 0xcbf29ce484222325ULL
+
+/// a directory of compiler outputs named by the hash of everything that
+/// produced them. entries are <key>.<ext> files, least recently used first
+/// to go once the directory grows past its cap
+typedef struct {
+  char* dir;
+  unsigned long long max_bytes; ///< size cap for all entries, 0 for no cap
+} compile_cache;
+
+/// counters kept in the cache directory, shared by every compiler process
+typedef struct {
+  unsigned long long hits;
+  unsigned long long misses;
+  unsigned long long evictions;
+} cache_stats;
+
+/// folds bytes into a 64-bit FNV-1a hash
+/// @param hash the hash so far, CACHE_HASH_INIT to start a new one
+/// @param data the bytes to add
+/// @param len how many bytes to add
+/// @return the updated hash
+uint64_t cache_hash(uint64_t hash, const void* data, size_t len);
+
+/// opens a cache, creating its directory if needed
+/// @param dir the cache directory
+/// @param max_bytes the size cap, 0 for no cap
+/// @return the cache, NULL if the directory could not be created
+compile_cache* cache_open(const char* dir, unsigned long long max_bytes);
+
+/// copies a cached entry out and marks it as recently used
+/// @param cache the cache
+/// @param key the hash the entry was stored under
+/// @param ext the kind of entry, e.g. "s" or "o"
+/// @param dest where the entry is copied to
+/// @return true on a hit
+bool cache_fetch(compile_cache* cache, uint64_t key, const char* ext, const char* dest);
+
+/// reads a cached entry into memory and marks it as recently used
+/// @param cache the cache
+/// @param key the hash the entry was stored under
+/// @param ext the kind of entry
+/// @param data set to a malloc'd copy of the entry on a hit
+/// @param len set to the entry's length on a hit
+/// @return true on a hit
+bool cache_fetch_data(compile_cache* cache, uint64_t key, const char* ext, char** data, size_t* len);
+
+/// stores bytes as a cache entry. unlike cache_store this does not evict, so
+/// a batch of small entries can be stored before a single cache_evict
+/// @param cache the cache
+/// @param key the hash to store the entry under
+/// @param ext the kind of entry
+/// @param data the bytes to store
+/// @param len how many bytes to store
+/// @return true if the entry was stored
+bool cache_store_data(compile_cache* cache, uint64_t key, const char* ext, const void* data, size_t len);
+
+/// copies a file into the cache, then evicts entries until it fits its cap
+/// @param cache the cache
+/// @param key the hash to store the entry under
+/// @param ext the kind of entry, e.g. "s" or "o"
+/// @param src the file to copy in
+/// @return true if the entry was stored
+bool cache_store(compile_cache* cache, uint64_t key, const char* ext, const char* src);
+
+/// removes the least recently used entries until the cache fits its cap
+/// @param cache the cache
+/// @return the number of entries removed
+unsigned int cache_evict(compile_cache* cache);
+
+/// counts a lookup in the shared statistics
+/// @param cache the cache
+/// @param hit whether the lookup was a hit
+void cache_record(compile_cache* cache, bool hit);
+
+/// reads the shared statistics
+/// @param cache the cache
+/// @return the counters, all zero for a new cache
+cache_stats cache_read_stats(compile_cache* cache);
+
+/// frees a cache handle, leaving the directory in place
+/// @param cache the cache
+void cache_close(compile_cache* cache);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef UTILS_JSON_H
+#define UTILS_JSON_H
+#include <stdio.h>
+
+/// writes a string as a quoted JSON string, escaping what JSON requires
+/// @param out the stream to write to
+/// @param str the string to write, NULL is written as null
+void json_write_str(FILE* out, const char* str);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef UTILS_STATS_H
+#define UTILS_STATS_H
+#include <stdbool.h>
+
+/// process wide counters behind -ftime-report and -fmem-report
+typedef enum {
+  STAT_LIST_ALLOCS, ///< arraylists created
+  STAT_HT_ALLOCS,   ///< hashtables created
+  STAT_NODE_ALLOCS, ///< AST nodes created by the parser
+  STAT_ALLOC_BYTES, ///< bytes requested by the allocations above, growth included
+  STAT_INSNS,       ///< instructions emitted
+  STAT_COUNT,
+} stat_id;
+
+/// counting is off until a report asks for it, so the hot paths only pay
+/// for a branch
+extern bool stats_enabled;
+
+/// adds to a counter, safe to call from any thread
+/// @param id the counter
+/// @param n the amount to add
+void stat_add(stat_id id, unsigned long long n);
+
+/// reads a counter
+/// @param id the counter
+/// @return its current value
+unsigned long long stat_get(stat_id id);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef UTILS_THREADPOOL_H
+#define UTILS_THREADPOOL_H
+#include <stdbool.h>
+#include <pthread.h>
+
+/// a unit of work queued on a thread pool
+typedef struct pool_task {
+  void (*fn)(void* arg);
+  void* arg;
+  struct pool_task* next;
+} pool_task;
+
+typedef struct {
+  pthread_t* threads;
+  unsigned int thread_count;
+  pool_task* head;         ///< next task to run
+  pool_task* tail;         ///< last queued task
+  unsigned int pending;    ///< tasks queued or still running
+  bool shutdown;
+  pthread_mutex_t lock;
+  pthread_cond_t has_work; ///< signaled when a task is queued or on shutdown
+  pthread_cond_t idle;     ///< signaled when pending drops to zero
+} threadpool_t;
+
+/// returns the number of processors that are currently online
+/// @return the processor count, at least 1
+unsigned int online_cpus(void);
+
+/// starts a pool of worker threads
+/// @param thread_count how many workers to start, 0 for one per online cpu
+/// @return the new thread pool
+threadpool_t* pool_create(unsigned int thread_count);
+
+/// queues a task, tasks start in the order they were submitted
+/// @param pool the pool to run the task on
+/// @param fn the function to run
+/// @param arg the argument passed to fn
+void pool_submit(threadpool_t* pool, void (*fn)(void* arg), void* arg);
+
+/// blocks until every submitted task has finished
+/// @param pool the pool to wait on
+void pool_wait(threadpool_t* pool);
+
+/// waits for outstanding tasks, then stops and frees the pool
+/// @param pool the pool to destroy
+void pool_destroy(threadpool_t* pool);
+
+#endif
@@ -2,15 +2,20 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stdint.h>
 #include <assert.h>
 #include "assembler/assembler.h"
 #include "errors/errors.h"
+#include "utils/threadpool.h"
+#include "utils/stats.h"
+#include "utils/json.h"
 
 static const regid arg_regs[] = { REG_RDI, REG_RSI, REG_RDX, REG_RCX, REG_R8, REG_R9 };
 
 static void asm_emit(asm_ctx* ctx, const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
+  if (fmt[0] != '.') { stat_add(STAT_INSNS, 1); }
   if (ctx->emitter->indent > 0) {
     fprintf(ctx->emitter->file, "%*c", ctx->emitter->indent, ' ');
   }
@@ -27,17 +32,46 @@ static void asm_raw(asm_ctx* ctx, const char* fmt, ...) {
   va_end(args);
 }
 
-static unsigned int type_size(var_t* t) {
+/// the size of one value of a type, one element for arrays
+static unsigned int elem_size(var_t* t) {
   if (t->is_adr) { return 8; }
   switch (t->type) {
     case LIT_BYTE:  return 1;
     case LIT_WORD:  return 2;
     case LIT_DWORD: return 4;
     case LIT_QWORD: return 8;
+    case LIT_V128:  return 16;
+    case LIT_V256:  return 32;
     default: return 8;
   }
 }
 
+/// the bytes a variable of a type occupies
+static unsigned int type_size(var_t* t) {
+  unsigned int sz = elem_size(t);
+  return t->is_array ? sz * t->array_len : sz;
+}
+
+static regsize type_regsize(var_t* t) {
+  switch (elem_size(t)) {
+    case 1:  return SZ_8;
+    case 2:  return SZ_16;
+    case 4:  return SZ_32;
+    case 16: return SZ_128;
+    case 32: return SZ_256;
+    default: return SZ_64;
+  }
+}
+
+static bool is_vector(var_t* t) {
+  return !t->is_adr && (t->type == LIT_V128 || t->type == LIT_V256);
+}
+
+/// moves a slot down far enough to hold a type, aligned for its elements
+static long align_slot(long offset, var_t* t) {
+  return (offset - (long)type_size(t)) & ~(long)(elem_size(t) - 1);
+}
+
 static void push_scope(asm_ctx* ctx) {
   scope_t* s = malloc(sizeof(scope_t));
   s->symbols = create_ht(64);
@@ -64,9 +98,7 @@ static symbol_t* find_symbol(asm_ctx* ctx, const char* name) {
 }
 
 static symbol_t* define_local(asm_ctx* ctx, const char* name, var_t type) {
-  unsigned int sz = type_size(&type);
-  if (sz < 8) { sz = 8; }
-  ctx->cur_offset -= sz;
+  ctx->cur_offset = align_slot(ctx->cur_offset, &type);
   symbol_t* sym = malloc(sizeof(symbol_t));
   sym->name = name;
   sym->stack_offset = ctx->cur_offset;
@@ -92,42 +124,256 @@ static unsigned int new_label(asm_ctx* ctx) {
   return ctx->label_count++;
 }
 
-static long count_locals(Node* node) {
-  if (!node) { return 0; }
+/// labels are namespaced by function so functions can be generated independently
+static char* label_str(asm_ctx* ctx, unsigned int n) {
+  size_t len = strlen(ctx->label_prefix) + 16;
+  char* buf = malloc(len);
+  snprintf(buf, len, ".L%s.%u", ctx->label_prefix, n);
+  return buf;
+}
+
+/// replays the slot layout of define_local over a statement
+/// @return the lowest offset any slot in the statement reaches
+static long lowest_slot(Node* node, long offset) {
+  if (!node) { return offset; }
   switch (node->type) {
     case AST_BLOCK: {
-      long sum = 0;
+      long low = offset;
       ArrayList* nodes = node->blockStmt.nodes;
       for (int i = 0; i < nodes->length; i++) {
-        sum += count_locals((Node*)get_list(nodes, i));
+        Node* n = (Node*)get_list(nodes, i);
+        if (n->type == AST_VAR_DECL) {
+          offset = align_slot(offset, &n->varDecl.type->variable_t);
+          if (offset < low) { low = offset; }
+        } else {
+          long inner = lowest_slot(n, offset);
+          if (inner < low) { low = inner; }
+        }
       }
-      return sum;
+      return low;
     }
     case AST_VAR_DECL:
-      return 8;
+      return align_slot(offset, &node->varDecl.type->variable_t);
     case AST_IF: {
-      long t = count_locals(node->ifStmt.then_branch);
-      long e = count_locals(node->ifStmt.else_branch);
-      return t + e;
+      long t = lowest_slot(node->ifStmt.then_branch, offset);
+      long e = lowest_slot(node->ifStmt.else_branch, offset);
+      return t < e ? t : e;
+    }
+    case AST_WHILE:
+      return lowest_slot(node->whileStmt.body, offset);
+    default:
+      return offset;
+  }
+}
+
+static long count_frame_bytes(Node* func_decl) {
+  long offset = 0;
+  ArrayList* params = func_decl->funcDecl.type->function_t.params;
+  for (int i = 0; i < params->length; i++) {
+    Node* p = (Node*)get_list(params, i);
+    offset = align_slot(offset, &p->funcParam.type->variable_t);
+  }
+  return -lowest_slot(func_decl->funcDecl.block, offset);
+}
+
+/// the alignment the vector slots of a statement need, 0 when it has none
+static unsigned int vector_align(Node* node) {
+  if (!node) { return 0; }
+  unsigned int a = 0, b = 0;
+  switch (node->type) {
+    case AST_BLOCK: {
+      ArrayList* nodes = node->blockStmt.nodes;
+      for (int i = 0; i < nodes->length; i++) {
+        b = vector_align((Node*)get_list(nodes, i));
+        if (b > a) { a = b; }
+      }
+      return a;
     }
+    case AST_VAR_DECL: {
+      var_t* t = &node->varDecl.type->variable_t;
+      return is_vector(t) ? elem_size(t) : 0;
+    }
+    case AST_IF:
+      a = vector_align(node->ifStmt.then_branch);
+      b = vector_align(node->ifStmt.else_branch);
+      return a > b ? a : b;
+    case AST_WHILE:
+      return vector_align(node->whileStmt.body);
     default:
       return 0;
   }
 }
 
 static long compute_frame_size(Node* func_decl) {
-  long size = count_locals(func_decl->funcDecl.block);
-  ArrayList* params = func_decl->funcDecl.type->function_t.params;
-  size += 8 * params->length;
-  if (size % 16 != 0) { size += 16 - (size % 16); }
+  long size = count_frame_bytes(func_decl);
+  // slots are aligned relative to the top of the frame, so the frame size
+  // keeps the bottom just as aligned
+  long align = vector_align(func_decl->funcDecl.block) > 16 ? 32 : 16;
+  if (size % align != 0) { size += align - (size % align); }
   return size;
 }
 
+static bool has_call_list(ArrayList* nodes);
+
+static bool has_call(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_CALL:     return true;
+    case AST_BLOCK:    return has_call_list(node->blockStmt.nodes);
+    case AST_VAR_DECL: return has_call(node->varDecl.assign);
+    case AST_IF:
+      return has_call(node->ifStmt.cond) || has_call(node->ifStmt.then_branch) ||
+             has_call(node->ifStmt.else_branch);
+    case AST_WHILE:
+      return has_call(node->whileStmt.cond) || has_call(node->whileStmt.body) ||
+             has_call(node->whileStmt.step);
+    case AST_RETURN:   return has_call(node->returnStmt.return_val);
+    case AST_UNARY:    return has_call(node->unaryExpr.expr);
+    case AST_BINARY:
+      return has_call(node->binaryExpr.expr_left) || has_call(node->binaryExpr.expr_right);
+    case AST_ASSIGN:
+      return has_call(node->assignExpr.target) || has_call(node->assignExpr.val);
+    case AST_CAST:     return has_call(node->castExpr.inner);
+    case AST_INDEX:
+      return has_call(node->arrayIndex.target) || has_call(node->arrayIndex.index);
+    case AST_ARRAY_LIT: return has_call_list(node->arrayLit.elements);
+    default:           return false;
+  }
+}
+
+static bool has_call_list(ArrayList* nodes) {
+  for (int i = 0; i < nodes->length; i++) {
+    if (has_call((Node*)get_list(nodes, i))) { return true; }
+  }
+  return false;
+}
+
+/// collects the names of the slots a statement declares, and separately the
+/// names of the arrays among them
+static void collect_slots(Node* node, ArrayList* slots, ArrayList* arrays) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_BLOCK:
+      for (int i = 0; i < node->blockStmt.nodes->length; i++) {
+        collect_slots((Node*)get_list(node->blockStmt.nodes, i), slots, arrays);
+      }
+      break;
+    case AST_VAR_DECL:
+      add_list(slots, (void*)node->varDecl.ident->identifierExpr.name);
+      if (node->varDecl.type->variable_t.is_array) {
+        add_list(arrays, (void*)node->varDecl.ident->identifierExpr.name);
+      }
+      break;
+    case AST_IF:
+      collect_slots(node->ifStmt.then_branch, slots, arrays);
+      collect_slots(node->ifStmt.else_branch, slots, arrays);
+      break;
+    case AST_WHILE:
+      collect_slots(node->whileStmt.body, slots, arrays);
+      break;
+    default:
+      break;
+  }
+}
+
+static bool has_name(ArrayList* names, const char* name) {
+  for (int i = 0; i < names->length; i++) {
+    if (strcmp((const char*)get_list(names, i), name) == 0) { return true; }
+  }
+  return false;
+}
+
+/// whether a statement lets the address of a slot out, through &x or a stack
+/// array used as a value. a global of the same name counts as a slot
+static bool leaks_slot(Node* node, ArrayList* slots, ArrayList* arrays) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_IDENTIFIER:
+      return has_name(arrays, node->identifierExpr.name);
+    case AST_UNARY:
+      if (node->unaryExpr.op == U_ADDR && node->unaryExpr.expr->type == AST_IDENTIFIER) {
+        return has_name(slots, node->unaryExpr.expr->identifierExpr.name);
+      }
+      return leaks_slot(node->unaryExpr.expr, slots, arrays);
+    case AST_INDEX:
+      // indexing reads the element in place, only the index itself can leak
+      return (node->arrayIndex.target->type != AST_IDENTIFIER &&
+              leaks_slot(node->arrayIndex.target, slots, arrays)) ||
+             leaks_slot(node->arrayIndex.index, slots, arrays);
+    case AST_BLOCK:
+      for (int i = 0; i < node->blockStmt.nodes->length; i++) {
+        if (leaks_slot((Node*)get_list(node->blockStmt.nodes, i), slots, arrays)) { return true; }
+      }
+      return false;
+    case AST_CALL:
+      for (int i = 0; i < node->callExpr.args->length; i++) {
+        if (leaks_slot((Node*)get_list(node->callExpr.args, i), slots, arrays)) { return true; }
+      }
+      return false;
+    case AST_VAR_DECL: return leaks_slot(node->varDecl.assign, slots, arrays);
+    case AST_IF:
+      return leaks_slot(node->ifStmt.cond, slots, arrays) ||
+             leaks_slot(node->ifStmt.then_branch, slots, arrays) ||
+             leaks_slot(node->ifStmt.else_branch, slots, arrays);
+    case AST_WHILE:
+      return leaks_slot(node->whileStmt.cond, slots, arrays) ||
+             leaks_slot(node->whileStmt.body, slots, arrays) ||
+             leaks_slot(node->whileStmt.step, slots, arrays);
+    case AST_RETURN: return leaks_slot(node->returnStmt.return_val, slots, arrays);
+    case AST_BINARY:
+      return leaks_slot(node->binaryExpr.expr_left, slots, arrays) ||
+             leaks_slot(node->binaryExpr.expr_right, slots, arrays);
+    case AST_ASSIGN:
+      return leaks_slot(node->assignExpr.target, slots, arrays) ||
+             leaks_slot(node->assignExpr.val, slots, arrays);
+    case AST_CAST: return leaks_slot(node->castExpr.inner, slots, arrays);
+    default:       return false;
+  }
+}
+
+/// a callee may still read through a pointer into the frame, so a frame
+/// whose address escapes can not be torn down before a call
+static bool frame_escapes(Node* func_decl) {
+  ArrayList* slots = init_list(16);
+  ArrayList* arrays = init_list(4);
+  ArrayList* params = func_decl->funcDecl.type->function_t.params;
+  for (int i = 0; i < params->length; i++) {
+    Node* p = (Node*)get_list(params, i);
+    add_list(slots, (void*)p->funcParam.ident->identifierExpr.name);
+  }
+  collect_slots(func_decl->funcDecl.block, slots, arrays);
+  bool escapes = leaks_slot(func_decl->funcDecl.block, slots, arrays);
+  free(slots->items); free(slots);
+  free(arrays->items); free(arrays);
+  return escapes;
+}
+
+/// keeps the CFA in sync with %rsp when there is no frame pointer to track it
+static void cfa_adjust(asm_ctx* ctx, int delta) {
+  if (!ctx->use_rbp && !ctx->stack_align) {
+    asm_emit(ctx, ".cfi_adjust_cfa_offset %d", delta);
+  }
+}
+
+/// displacement of a frame slot from the current %rsp, used when the frame
+/// pointer is omitted. slots live at (entry %rsp + offset)
+static long rsp_disp(asm_ctx* ctx, long offset) {
+  return ctx->frame_size + offset + 8 * (long)ctx->push_depth;
+}
+
+static operand_t* mk_local(asm_ctx* ctx, long offset, regsize size) {
+  if (ctx->use_rbp) {
+    return mk_mem(REG_RBP, size, offset);
+  }
+  return mk_mem(REG_RSP, size, rsp_disp(ctx, offset));
+}
+
 static void push_rax(asm_ctx* ctx) {
   operand_t* rax = mk_register(REG_RAX, SZ_64);
   emit_push(ctx->emitter, rax);
   free(rax);
   ctx->push_depth++;
+  cfa_adjust(ctx, 8);
 }
 
 static void pop_into(asm_ctx* ctx, regid id) {
@@ -135,6 +381,7 @@ static void pop_into(asm_ctx* ctx, regid id) {
   emit_pop(ctx->emitter, r);
   free(r);
   ctx->push_depth--;
+  cfa_adjust(ctx, -8);
 }
 
 static void load_imm(asm_ctx* ctx, long long val) {
@@ -144,37 +391,239 @@ static void load_imm(asm_ctx* ctx, long long val) {
   free(imm); free(rax);
 }
 
-static void load_local(asm_ctx* ctx, long offset) {
-  operand_t* mem = mk_mem(REG_RBP, SZ_64, offset);
-  operand_t* rax = mk_register(REG_RAX, SZ_64);
-  emit_mov(ctx->emitter, mem, rax);
-  free(mem); free(rax);
+/// narrow values live in %rax widened to 64 bits: BYTE is unsigned, WORD and
+/// DWORD are signed
+static const char* load_mnemonic(var_t* t) {
+  switch (type_regsize(t)) {
+    case SZ_8:  return "movzbq";
+    case SZ_16: return "movswq";
+    case SZ_32: return "movslq";
+    default:    return "movq";
+  }
 }
 
-static void store_local(asm_ctx* ctx, long offset) {
-  operand_t* mem = mk_mem(REG_RBP, SZ_64, offset);
-  operand_t* rax = mk_register(REG_RAX, SZ_64);
-  emit_mov(ctx->emitter, rax, mem);
-  free(mem); free(rax);
+/// loads a value of the operand's width into a register, widened to 64 bits
+static void load_mem(asm_ctx* ctx, operand_t* mem, regid id) {
+  regsize size = mem->op.mem.base.size;
+  operand_t* reg = mk_register(id, SZ_64);
+  if (size == SZ_64) {
+    emit_mov(ctx->emitter, mem, reg);
+  } else if (size == SZ_8) {
+    emit_movzx(ctx->emitter, mem, reg);
+  } else {
+    emit_movsx(ctx->emitter, mem, reg);
+  }
+  free(reg);
+}
+
+static void load_local_into(asm_ctx* ctx, symbol_t* sym, regid id) {
+  operand_t* mem = mk_local(ctx, sym->stack_offset, type_regsize(&sym->type));
+  load_mem(ctx, mem, id);
+  free(mem);
+}
+
+static void load_local(asm_ctx* ctx, symbol_t* sym) {
+  load_local_into(ctx, sym, REG_RAX);
+}
+
+static void store_reg(asm_ctx* ctx, regid id, symbol_t* sym) {
+  regsize size = type_regsize(&sym->type);
+  operand_t* mem = mk_local(ctx, sym->stack_offset, size);
+  operand_t* reg = mk_register(id, size);
+  emit_mov(ctx->emitter, reg, mem);
+  free(mem); free(reg);
+}
+
+static void store_local(asm_ctx* ctx, symbol_t* sym) {
+  store_reg(ctx, REG_RAX, sym);
+}
+
+/// truncates %rax to a type and widens it back the way loads of it would
+static void extend_rax(asm_ctx* ctx, var_t* t) {
+  switch (type_regsize(t)) {
+    case SZ_8:  asm_emit(ctx, "movzbq %%al, %%rax"); break;
+    case SZ_16: asm_emit(ctx, "movswq %%ax, %%rax"); break;
+    case SZ_32: asm_emit(ctx, "movslq %%eax, %%rax"); break;
+    default:    break;
+  }
 }
 
 static void gen_expr(asm_ctx* ctx, Node* node);
 static void gen_stmt(asm_ctx* ctx, Node* node);
 static void gen_block(asm_ctx* ctx, Node* node);
 
+/// a string literal is named by the hash of its bytes, so every function,
+/// whether generated in parallel or taken from the fragment cache, refers to
+/// the one copy in the pool without coordinating
+static void string_label(const char* str, char* buf, size_t len) {
+  uint64_t hash = cache_hash(CACHE_HASH_INIT, str, strlen(str));
+  snprintf(buf, len, ".LS%016llx", (unsigned long long)hash);
+}
+
 static void gen_literal(asm_ctx* ctx, Node* node) {
+  if (node->literalExpr.str_value) {
+    char label[32];
+    string_label(node->literalExpr.str_value, label, sizeof(label));
+    asm_emit(ctx, "leaq %s(%%rip), %%rax", label);
+    return;
+  }
   load_imm(ctx, node->literalExpr.num_value);
 }
 
+/// loads the address of a variable into %rax or %rdx
+static void gen_address(asm_ctx* ctx, symbol_t* sym, const char* reg) {
+  if (sym->is_global) {
+    asm_emit(ctx, "leaq %s(%%rip), %s", sym->name, reg);
+  } else if (ctx->use_rbp) {
+    asm_emit(ctx, "leaq %ld(%%rbp), %s", sym->stack_offset, reg);
+  } else {
+    asm_emit(ctx, "leaq %ld(%%rsp), %s", rsp_disp(ctx, sym->stack_offset), reg);
+  }
+}
+
 static void gen_identifier(asm_ctx* ctx, Node* node) {
   const char* name = node->identifierExpr.name;
   symbol_t* sym = find_symbol(ctx, name);
   if (!sym) { std_compile_error("undefined identifier"); }
-  if (sym->is_global) {
-    asm_emit(ctx, "movq %s(%%rip), %%rax", name);
+  if (is_vector(&sym->type)) { std_compile_error("a vector can not be used as a scalar"); }
+  if (sym->type.is_array) {
+    // an array used as a value is the address of its first element
+    gen_address(ctx, sym, "%rax");
+  } else if (sym->is_global) {
+    asm_emit(ctx, "%s %s(%%rip), %%rax", load_mnemonic(&sym->type), name);
+  } else {
+    load_local(ctx, sym);
+  }
+}
+
+/// an operand loaded straight into any register: a literal, a scalar
+/// variable or the address of one
+static bool is_direct_operand(asm_ctx* ctx, Node* node) {
+  if (node->type == AST_LITERAL) { return true; }
+  if (node->type == AST_UNARY && node->unaryExpr.op == U_ADDR) { node = node->unaryExpr.expr; }
+  if (node->type != AST_IDENTIFIER) { return false; }
+  symbol_t* sym = find_symbol(ctx, node->identifierExpr.name);
+  return sym && !is_vector(&sym->type);
+}
+
+static void load_direct_operand(asm_ctx* ctx, Node* node, regid id) {
+  if (node->type == AST_LITERAL && node->literalExpr.str_value) {
+    char label[32];
+    string_label(node->literalExpr.str_value, label, sizeof(label));
+    asm_emit(ctx, "leaq %s(%%rip), %s", label, reg_to_str(SZ_64, id));
+    return;
+  }
+  if (node->type == AST_LITERAL) {
+    operand_t* imm = mk_immutable(node->literalExpr.num_value);
+    operand_t* reg = mk_register(id, SZ_64);
+    emit_mov(ctx->emitter, imm, reg);
+    free(imm); free(reg);
+    return;
+  }
+  bool addr = node->type == AST_UNARY;
+  Node* ident = addr ? node->unaryExpr.expr : node;
+  symbol_t* sym = find_symbol(ctx, ident->identifierExpr.name);
+  const char* reg = reg_to_str(SZ_64, id);
+  if (addr || sym->type.is_array) {
+    gen_address(ctx, sym, reg);
+  } else if (sym->is_global) {
+    asm_emit(ctx, "%s %s(%%rip), %s", load_mnemonic(&sym->type), sym->name, reg);
+  } else {
+    load_local_into(ctx, sym, id);
+  }
+}
+
+/// the type a pointer expression points at: a pointer or array variable, a
+/// pointer cast, the address of a variable or any of these offset by a value
+static var_t pointee_type(asm_ctx* ctx, Node* node) {
+  var_t t = { 0 };
+  switch (node->type) {
+    case AST_IDENTIFIER: {
+      symbol_t* sym = find_symbol(ctx, node->identifierExpr.name);
+      if (!sym) { std_compile_error("undefined identifier"); }
+      t = sym->type;
+      if (t.is_array) {
+        t.is_array = false;
+        t.array_len = 0;
+        return t;
+      }
+      break;
+    }
+    case AST_CAST:
+      t = node->castExpr.var_t->variable_t;
+      break;
+    case AST_LITERAL:
+      if (node->literalExpr.str_value) {
+        t.type = LIT_BYTE;
+        return t;
+      }
+      break;
+    case AST_UNARY:
+      if (node->unaryExpr.op == U_ADDR && node->unaryExpr.expr->type == AST_IDENTIFIER) {
+        symbol_t* sym = find_symbol(ctx, node->unaryExpr.expr->identifierExpr.name);
+        if (sym && !sym->type.is_array) { return sym->type; }
+      }
+      break;
+    case AST_BINARY:
+      if (node->binaryExpr.op == B_ADD || node->binaryExpr.op == B_SUB) {
+        return pointee_type(ctx, node->binaryExpr.expr_left);
+      }
+      break;
+    default:
+      break;
+  }
+  if (!t.is_adr) { std_compile_error("can only dereference a pointer"); }
+  t.is_adr = false;
+  t.type = (lit_t)(LIT_BYTE + t.type_adr);
+  return t;
+}
+
+/// peels literal offsets off a pointer expression into a displacement
+static Node* split_offset(Node* node, long* disp) {
+  *disp = 0;
+  while (node->type == AST_BINARY &&
+         (node->binaryExpr.op == B_ADD || node->binaryExpr.op == B_SUB)) {
+    Node* r = node->binaryExpr.expr_right;
+    if (r->type != AST_LITERAL || r->literalExpr.str_value) { break; }
+    long long d = node->binaryExpr.op == B_ADD ? r->literalExpr.num_value : -r->literalExpr.num_value;
+    if (*disp + d < INT32_MIN || *disp + d > INT32_MAX) { break; }
+    *disp += (long)d;
+    node = node->binaryExpr.expr_left;
+  }
+  return node;
+}
+
+/// the sized operand a dereference reads or writes, with its base in id
+static operand_t* deref_mem(asm_ctx* ctx, Node* node, regid id) {
+  var_t elem = pointee_type(ctx, node->unaryExpr.expr);
+  long disp;
+  Node* base = split_offset(node->unaryExpr.expr, &disp);
+  if (is_direct_operand(ctx, base)) {
+    load_direct_operand(ctx, base, id);
   } else {
-    load_local(ctx, sym->stack_offset);
+    bool save = id != REG_RAX;
+    if (save) { push_rax(ctx); }
+    gen_expr(ctx, base);
+    if (save) {
+      asm_emit(ctx, "movq %%rax, %s", reg_to_str(SZ_64, id));
+      pop_into(ctx, REG_RAX);
+    }
   }
+  return mk_mem(id, type_regsize(&elem), disp);
+}
+
+static void gen_deref(asm_ctx* ctx, Node* node) {
+  operand_t* mem = deref_mem(ctx, node, REG_RAX);
+  load_mem(ctx, mem, REG_RAX);
+  free(mem);
+}
+
+/// stores %rax through a pointer, keeping it as the value of the assignment
+static void gen_store_deref(asm_ctx* ctx, Node* target) {
+  operand_t* mem = deref_mem(ctx, target, REG_RDX);
+  operand_t* rax = mk_register(REG_RAX, mem->op.mem.base.size);
+  emit_mov(ctx->emitter, rax, mem);
+  free(mem); free(rax);
 }
 
 static void gen_unary(asm_ctx* ctx, Node* node) {
@@ -185,11 +634,11 @@ static void gen_unary(asm_ctx* ctx, Node* node) {
     }
     symbol_t* sym = find_symbol(ctx, ue.expr->identifierExpr.name);
     if (!sym) { std_compile_error("undefined identifier"); }
-    if (sym->is_global) {
-      asm_emit(ctx, "leaq %s(%%rip), %%rax", sym->name);
-    } else {
-      asm_emit(ctx, "leaq %ld(%%rbp), %%rax", sym->stack_offset);
-    }
+    gen_address(ctx, sym, "%rax");
+    return;
+  }
+  if (ue.op == U_DEREF) {
+    gen_deref(ctx, node);
     return;
   }
   gen_expr(ctx, ue.expr);
@@ -202,6 +651,12 @@ static void gen_unary(asm_ctx* ctx, Node* node) {
       asm_emit(ctx, "sete %%al");
       asm_emit(ctx, "movzbq %%al, %%rax");
       break;
+    case U_BIT_NOT: {
+      operand_t* rax = mk_register(REG_RAX, SZ_64);
+      emit_not(ctx->emitter, rax);
+      free(rax);
+      break;
+    }
     case U_POS:
       break;
     default:
@@ -209,8 +664,50 @@ static void gen_unary(asm_ctx* ctx, Node* node) {
   }
 }
 
+static bool is_shift(binary_expr_t op) {
+  return op == B_SHL || op == B_SAR || op == B_SHR;
+}
+
+/// a literal right operand of a bitwise op or shift that fits the
+/// instruction's immediate, so it needs no register
+static bool bitwise_imm(binary_expr be, long long* imm) {
+  Node* r = be.expr_right;
+  if (r->type != AST_LITERAL || r->literalExpr.str_value) { return false; }
+  *imm = r->literalExpr.num_value;
+  if (is_shift(be.op)) {
+    *imm &= 63; // the count the instruction itself would use
+    return true;
+  }
+  return (be.op == B_AND || be.op == B_OR || be.op == B_XOR) &&
+         *imm >= INT32_MIN && *imm <= INT32_MAX;
+}
+
+/// applies a bitwise op or shift to %rax, src being an immediate or %rcx
+static void emit_bitwise(asm_ctx* ctx, binary_expr_t op, operand_t* src) {
+  operand_t* rax = mk_register(REG_RAX, SZ_64);
+  operand_t* count = src->kind == OP_REG ? mk_register(REG_RCX, SZ_8) : mk_immutable(src->op.imm);
+  switch (op) {
+    case B_AND: emit_and(ctx->emitter, src, rax); break;
+    case B_OR:  emit_or(ctx->emitter, src, rax); break;
+    case B_XOR: emit_xor(ctx->emitter, src, rax); break;
+    case B_SHL: emit_shl(ctx->emitter, count, rax); break;
+    case B_SAR: emit_sar(ctx->emitter, count, rax); break;
+    case B_SHR: emit_shr(ctx->emitter, count, rax); break;
+    default: std_compile_error("unsupported binary op");
+  }
+  free(rax); free(count);
+}
+
 static void gen_binary(asm_ctx* ctx, Node* node) {
   binary_expr be = node->binaryExpr;
+  long long imm;
+  if (bitwise_imm(be, &imm)) {
+    gen_expr(ctx, be.expr_left);
+    operand_t* src = mk_immutable(imm);
+    emit_bitwise(ctx, be.op, src);
+    free(src);
+    return;
+  }
   gen_expr(ctx, be.expr_left);
   push_rax(ctx);
   gen_expr(ctx, be.expr_right);
@@ -248,117 +745,1443 @@ static void gen_binary(asm_ctx* ctx, Node* node) {
       break;
     }
     default:
-      std_compile_error("unsupported binary op");
+      emit_bitwise(ctx, be.op, rcx);
+      break;
   }
   free(rax); free(rcx);
 }
 
-static void gen_call(asm_ctx* ctx, Node* node) {
-  call_expr ce = node->callExpr;
-  ArrayList* args = ce.args;
-  int n = args->length;
-  if (n > 6) { std_compile_error("more than 6 args not supported"); }
-  bool pad = (ctx->push_depth % 2) != 0;
-  if (pad) {
-    asm_emit(ctx, "subq $8, %%rsp");
-    ctx->push_depth++;
+/// the label failed bounds checks jump to, emitted once after the epilogue
+static const char* trap_label(asm_ctx* ctx) {
+  if (!ctx->trap_label) { ctx->trap_label = label_str(ctx, new_label(ctx)); }
+  return ctx->trap_label;
+}
+
+/// an element access, resolved before any code for it is emitted
+typedef struct {
+  symbol_t* sym;   ///< the array or pointer being indexed
+  var_t elem;      ///< the type of one element
+  bool is_const;   ///< the index is a literal, folded into the displacement
+  long long index; ///< the literal index when is_const
+  bool recast;     ///< indexed through a pointer cast, so the length no longer applies
+} index_ref;
+
+static index_ref resolve_index(asm_ctx* ctx, Node* node) {
+  index_expr ie = node->arrayIndex;
+  index_ref ref = { 0 };
+  Node* target = ie.target;
+  // the inliner passes a pointer argument as a cast to the parameter type
+  if (target->type == AST_CAST && target->castExpr.var_t->variable_t.is_adr &&
+      target->castExpr.inner->type == AST_IDENTIFIER) {
+    ref.recast = true;
+    target = target->castExpr.inner;
   }
-  for (int i = 0; i < n; i++) {
-    gen_expr(ctx, (Node*)get_list(args, i));
-    push_rax(ctx);
+  if (target->type != AST_IDENTIFIER) {
+    std_compile_error("can only index an array or pointer variable");
   }
-  for (int i = n - 1; i >= 0; i--) {
-    pop_into(ctx, arg_regs[i]);
+  ref.sym = find_symbol(ctx, target->identifierExpr.name);
+  if (!ref.sym) { std_compile_error("undefined identifier"); }
+  ref.elem = ref.recast ? ie.target->castExpr.var_t->variable_t : ref.sym->type;
+  if (ref.elem.is_array) {
+    ref.elem.is_array = false;
+    ref.elem.array_len = 0;
+  } else if (ref.elem.is_adr) {
+    ref.elem.is_adr = false;
+    ref.elem.type = (lit_t)(LIT_BYTE + ref.elem.type_adr);
+  } else {
+    std_compile_error("can only index an array or pointer variable");
   }
-  operand_t* lbl = mk_label(ce.callee->identifierExpr.name);
-  emit_call(ctx->emitter, lbl);
-  free(lbl);
-  if (pad) {
-    asm_emit(ctx, "addq $8, %%rsp");
-    ctx->push_depth--;
+  ref.is_const = ie.index->type == AST_LITERAL && !ie.index->literalExpr.str_value;
+  if (ref.is_const) {
+    ref.index = ie.index->literalExpr.num_value;
+    if (ref.sym->type.is_array && !ref.recast &&
+        (ref.index < 0 || ref.index >= ref.sym->type.array_len)) {
+      std_compile_error("array index out of bounds");
+    }
   }
+  return ref;
 }
 
-static void gen_assign(asm_ctx* ctx, Node* node) {
-  assign_expr ae = node->assignExpr;
-  if (ae.target->type != AST_IDENTIFIER) {
-    std_compile_error("only identifier assignment supported");
-  }
-  gen_expr(ctx, ae.val);
-  const char* name = ae.target->identifierExpr.name;
-  symbol_t* sym = find_symbol(ctx, name);
-  if (!sym) { std_compile_error("undefined identifier in assignment"); }
-  if (sym->is_global) {
-    asm_emit(ctx, "movq %%rax, %s(%%rip)", name);
-  } else {
-    store_local(ctx, sym->stack_offset);
+static bool is_proven(asm_ctx* ctx, Node* node) {
+  for (int i = 0; i < ctx->proven->length; i++) {
+    if (get_list(ctx->proven, i) == node) { return true; }
   }
+  return false;
 }
 
-static void gen_cast(asm_ctx* ctx, Node* node) {
-  gen_expr(ctx, node->castExpr.inner);
+/// a scalar local index is loaded straight into %rcx, leaving %rax alone
+static symbol_t* index_local(asm_ctx* ctx, Node* node) {
+  Node* idx = node->arrayIndex.index;
+  if (idx->type != AST_IDENTIFIER) { return NULL; }
+  symbol_t* sym = find_symbol(ctx, idx->identifierExpr.name);
+  if (!sym || sym->is_global || sym->type.is_array) { return NULL; }
+  return sym;
 }
 
-static void gen_expr(asm_ctx* ctx, Node* node) {
-  switch (node->type) {
-    case AST_LITERAL:    gen_literal(ctx, node); break;
-    case AST_IDENTIFIER: gen_identifier(ctx, node); break;
-    case AST_UNARY:      gen_unary(ctx, node); break;
-    case AST_BINARY:     gen_binary(ctx, node); break;
-    case AST_CALL:       gen_call(ctx, node); break;
-    case AST_ASSIGN:     gen_assign(ctx, node); break;
-    case AST_CAST:       gen_cast(ctx, node); break;
-    default:
-      std_compile_error("unsupported expression");
+/// leaves a non literal index in %rcx, bounds checked when enabled
+static void gen_index_reg(asm_ctx* ctx, Node* node, index_ref* ref) {
+  if (ref->is_const) { return; }
+  symbol_t* local = index_local(ctx, node);
+  if (local) {
+    load_local_into(ctx, local, REG_RCX);
+  } else {
+    gen_expr(ctx, node->arrayIndex.index);
+    asm_emit(ctx, "movq %%rax, %%rcx");
+  }
+  if (ctx->opts.bounds_check && ref->sym->type.is_array && !ref->recast &&
+      !is_proven(ctx, node)) {
+    // unsigned, so a negative index fails the same compare
+    asm_emit(ctx, "cmpq $%u, %%rcx", ref->sym->type.array_len);
+    asm_emit(ctx, "jae %s", trap_label(ctx));
   }
 }
 
-static void gen_var_decl(asm_ctx* ctx, Node* node) {
-  var_decl vd = node->varDecl;
-  symbol_t* sym = define_local(ctx, vd.ident->identifierExpr.name, vd.type->variable_t);
-  if (vd.assign) {
-    gen_expr(ctx, vd.assign);
-    store_local(ctx, sym->stack_offset);
+/// the operand addressing an element. stack arrays are addressed off the
+/// frame register directly, anything else has its base loaded into %rdx
+static operand_t* index_mem(asm_ctx* ctx, index_ref* ref) {
+  symbol_t* sym = ref->sym;
+  unsigned int scale = elem_size(&ref->elem);
+  regsize size = type_regsize(&ref->elem);
+  long disp = ref->is_const ? (long)ref->index * scale : 0;
+  regid base = REG_RDX;
+  if (sym->type.is_array && !sym->is_global) {
+    base = ctx->use_rbp ? REG_RBP : REG_RSP;
+    disp += ctx->use_rbp ? sym->stack_offset : rsp_disp(ctx, sym->stack_offset);
+  } else if (sym->type.is_array) {
+    gen_address(ctx, sym, "%rdx");
+  } else if (sym->is_global) {
+    asm_emit(ctx, "movq %s(%%rip), %%rdx", sym->name);
+  } else {
+    operand_t* slot = mk_local(ctx, sym->stack_offset, SZ_64);
+    operand_t* rdx = mk_register(REG_RDX, SZ_64);
+    emit_mov(ctx->emitter, slot, rdx);
+    free(slot); free(rdx);
   }
+  if (ref->is_const) { return mk_mem(base, size, disp); }
+  return mk_mem_index(base, REG_RCX, scale, size, disp);
 }
 
-static void gen_return(asm_ctx* ctx, Node* node) {
-  return_stmt rs = node->returnStmt;
-  if (rs.return_val) { gen_expr(ctx, rs.return_val); }
-  asm_emit(ctx, "jmp %s", ctx->epilogue_label);
+static void gen_index(asm_ctx* ctx, Node* node) {
+  index_ref ref = resolve_index(ctx, node);
+  gen_index_reg(ctx, node, &ref);
+  operand_t* mem = index_mem(ctx, &ref);
+  load_mem(ctx, mem, REG_RAX);
+  free(mem);
 }
 
-static void gen_if(asm_ctx* ctx, Node* node) {
-  if_stmt is = node->ifStmt;
-  unsigned int else_lbl = new_label(ctx);
-  unsigned int end_lbl = new_label(ctx);
-  gen_expr(ctx, is.cond);
-  asm_emit(ctx, "cmpq $0, %%rax");
-  asm_emit(ctx, "je .L%u", else_lbl);
-  gen_stmt(ctx, is.then_branch);
-  asm_emit(ctx, "jmp .L%u", end_lbl);
-  asm_raw(ctx, ".L%u:", else_lbl);
-  if (is.else_branch) { gen_stmt(ctx, is.else_branch); }
-  asm_raw(ctx, ".L%u:", end_lbl);
+/// stores %rax into an element, keeping it as the value of the assignment
+static void gen_store_index(asm_ctx* ctx, Node* target) {
+  index_ref ref = resolve_index(ctx, target);
+  // only an index computed through %rax needs the value saved around it
+  bool save = !ref.is_const && !index_local(ctx, target);
+  if (save) { push_rax(ctx); }
+  gen_index_reg(ctx, target, &ref);
+  if (save) { pop_into(ctx, REG_RAX); }
+  operand_t* mem = index_mem(ctx, &ref);
+  operand_t* rax = mk_register(REG_RAX, mem->op.mem.base.size);
+  emit_mov(ctx->emitter, rax, mem);
+  free(mem); free(rax);
 }
 
-static void gen_block(asm_ctx* ctx, Node* node) {
-  push_scope(ctx);
-  ArrayList* nodes = node->blockStmt.nodes;
-  for (int i = 0; i < nodes->length; i++) {
-    gen_stmt(ctx, (Node*)get_list(nodes, i));
+// ------------------------------------------------------------------
+// vector values
+//
+// a vector expression leaves its value in %xmm0, or %ymm0 for a V256, the
+// way a scalar one leaves it in %rax. vector variables live in slots
+// aligned to their size, so they are used as memory operands directly
+
+typedef enum {
+  VI_LOAD,     ///< (address) -> vector
+  VI_STORE,    ///< (address, vector)
+  VI_BINARY,   ///< (vector, vector) -> vector
+  VI_SHUFFLE,  ///< (vector, literal) -> vector
+  VI_MOVEMASK, ///< (vector) -> scalar
+} vintrin_kind;
+
+/// a vector intrinsic, called like any other function with `call`
+typedef struct {
+  const char* name;
+  vintrin_kind kind;
+  const char* op;     ///< the packed instruction, without the v of its AVX form
+  unsigned int width; ///< bytes a load or store moves, 0 when it follows the arguments
+  target_isa isa;     ///< the oldest instruction set with the 128 bit form
+} vintrin;
+
+static const vintrin vintrins[] = {
+  { "vload128",   VI_LOAD,     NULL,       16, ISA_SSE2 },
+  { "vload256",   VI_LOAD,     NULL,       32, ISA_AVX2 },
+  { "vstore128",  VI_STORE,    NULL,       16, ISA_SSE2 },
+  { "vstore256",  VI_STORE,    NULL,       32, ISA_AVX2 },
+  { "vadd8",      VI_BINARY,   "paddb",    0,  ISA_SSE2 },
+  { "vadd16",     VI_BINARY,   "paddw",    0,  ISA_SSE2 },
+  { "vadd32",     VI_BINARY,   "paddd",    0,  ISA_SSE2 },
+  { "vadd64",     VI_BINARY,   "paddq",    0,  ISA_SSE2 },
+  { "vsub8",      VI_BINARY,   "psubb",    0,  ISA_SSE2 },
+  { "vsub16",     VI_BINARY,   "psubw",    0,  ISA_SSE2 },
+  { "vsub32",     VI_BINARY,   "psubd",    0,  ISA_SSE2 },
+  { "vsub64",     VI_BINARY,   "psubq",    0,  ISA_SSE2 },
+  { "vmul16",     VI_BINARY,   "pmullw",   0,  ISA_SSE2 },
+  { "vmul32",     VI_BINARY,   "pmulld",   0,  ISA_SSE42 },
+  { "vcmpeq8",    VI_BINARY,   "pcmpeqb",  0,  ISA_SSE2 },
+  { "vcmpeq16",   VI_BINARY,   "pcmpeqw",  0,  ISA_SSE2 },
+  { "vcmpeq32",   VI_BINARY,   "pcmpeqd",  0,  ISA_SSE2 },
+  { "vcmpeq64",   VI_BINARY,   "pcmpeqq",  0,  ISA_SSE42 },
+  { "vcmpgt8",    VI_BINARY,   "pcmpgtb",  0,  ISA_SSE2 },
+  { "vcmpgt16",   VI_BINARY,   "pcmpgtw",  0,  ISA_SSE2 },
+  { "vcmpgt32",   VI_BINARY,   "pcmpgtd",  0,  ISA_SSE2 },
+  { "vcmpgt64",   VI_BINARY,   "pcmpgtq",  0,  ISA_SSE42 },
+  { "vshuffle32", VI_SHUFFLE,  "pshufd",   0,  ISA_SSE2 },
+  { "vmovemask8", VI_MOVEMASK, "pmovmskb", 0,  ISA_SSE2 },
+};
+
+static const vintrin* find_vintrin(const char* name) {
+  if (name[0] != 'v') { return NULL; }
+  for (size_t i = 0; i < sizeof(vintrins) / sizeof(vintrins[0]); i++) {
+    if (strcmp(vintrins[i].name, name) == 0) { return &vintrins[i]; }
   }
-  pop_scope(ctx);
+  return NULL;
 }
 
-static void gen_stmt(asm_ctx* ctx, Node* node) {
+static unsigned int vec_width(asm_ctx* ctx, Node* node);
+
+/// the width in bytes of what an intrinsic call returns, 0 for a scalar
+static unsigned int vintrin_width(asm_ctx* ctx, const vintrin* vi, Node* call) {
+  ArrayList* args = call->callExpr.args;
+  switch (vi->kind) {
+    case VI_LOAD:
+      return vi->width;
+    case VI_BINARY:
+    case VI_SHUFFLE:
+      return args->length > 0 ? vec_width(ctx, (Node*)get_list(args, 0)) : 0;
+    default:
+      return 0;
+  }
+}
+
+/// the width in bytes of a vector expression, 0 for a scalar one
+static unsigned int vec_width(asm_ctx* ctx, Node* node) {
   switch (node->type) {
-    case AST_BLOCK:    gen_block(ctx, node); break;
-    case AST_IF:       gen_if(ctx, node); break;
-    case AST_RETURN:   gen_return(ctx, node); break;
-    case AST_VAR_DECL: gen_var_decl(ctx, node); break;
-    case AST_COMMENT:  break;
-    default:           gen_expr(ctx, node);
+    case AST_IDENTIFIER: {
+      symbol_t* sym = find_symbol(ctx, node->identifierExpr.name);
+      return sym && is_vector(&sym->type) ? elem_size(&sym->type) : 0;
+    }
+    case AST_ASSIGN:
+      return vec_width(ctx, node->assignExpr.target);
+    case AST_CALL: {
+      const vintrin* vi = find_vintrin(node->callExpr.callee->identifierExpr.name);
+      return vi ? vintrin_width(ctx, vi, node) : 0;
+    }
+    default:
+      return 0;
+  }
+}
+
+/// every vector uses the AVX encoding once the target has it, mixing the
+/// two costs a state transition
+static bool use_vex(asm_ctx* ctx, unsigned int width) {
+  return width == 32 || ctx->opts.isa >= ISA_AVX2;
+}
+
+static regsize vec_size(unsigned int width) {
+  return width == 32 ? SZ_256 : SZ_128;
+}
+
+static const char* vec_reg(unsigned int n, unsigned int width) {
+  return reg_to_str(vec_size(width), (regid)(REG_XMM0 + n));
+}
+
+/// the aligned slot of a vector variable as a memory operand
+static void vec_sym_addr(asm_ctx* ctx, symbol_t* sym, char* buf, size_t len) {
+  if (sym->is_global) {
+    snprintf(buf, len, "%s(%%rip)", sym->name);
+  } else if (ctx->use_rbp) {
+    snprintf(buf, len, "%ld(%%rbp)", sym->stack_offset);
+  } else {
+    snprintf(buf, len, "%ld(%%rsp)", rsp_disp(ctx, sym->stack_offset));
+  }
+}
+
+/// moves a vector between register n and a variable
+static void vec_move_sym(asm_ctx* ctx, symbol_t* sym, unsigned int n, bool load) {
+  unsigned int width = elem_size(&sym->type);
+  char addr[64];
+  vec_sym_addr(ctx, sym, addr, sizeof(addr));
+  const char* v = use_vex(ctx, width) ? "v" : "";
+  if (load) {
+    asm_emit(ctx, "%smovdqa %s, %s", v, addr, vec_reg(n, width));
+  } else {
+    asm_emit(ctx, "%smovdqa %s, %s", v, vec_reg(n, width), addr);
+  }
+}
+
+/// saves vector register 0 below %rsp the way push_rax saves %rax
+static void push_vec(asm_ctx* ctx, unsigned int width) {
+  asm_emit(ctx, "subq $%u, %%rsp", width);
+  ctx->push_depth += width / 8;
+  cfa_adjust(ctx, (int)width);
+  operand_t* top = mk_mem(REG_RSP, vec_size(width), 0);
+  operand_t* reg = mk_register(REG_XMM0, vec_size(width));
+  emit_vmov(ctx->emitter, reg, top, false, use_vex(ctx, width));
+  free(top); free(reg);
+}
+
+static void pop_vec(asm_ctx* ctx, unsigned int n, unsigned int width) {
+  operand_t* top = mk_mem(REG_RSP, vec_size(width), 0);
+  operand_t* reg = mk_register((regid)(REG_XMM0 + n), vec_size(width));
+  emit_vmov(ctx->emitter, top, reg, false, use_vex(ctx, width));
+  free(top); free(reg);
+  asm_emit(ctx, "addq $%u, %%rsp", width);
+  ctx->push_depth -= width / 8;
+  cfa_adjust(ctx, -(int)width);
+}
+
+static void gen_vec_expr(asm_ctx* ctx, Node* node);
+
+/// a vector variable argument is read straight from its slot
+static symbol_t* vec_operand_sym(asm_ctx* ctx, Node* node) {
+  if (node->type != AST_IDENTIFIER) { return NULL; }
+  return find_symbol(ctx, node->identifierExpr.name);
+}
+
+/// emits an intrinsic call, leaving a vector result in register 0 and a
+/// scalar one in %rax
+static void gen_vintrin(asm_ctx* ctx, Node* node, const vintrin* vi) {
+  ArrayList* args = node->callExpr.args;
+  unsigned int want = (vi->kind == VI_LOAD || vi->kind == VI_MOVEMASK) ? 1 : 2;
+  if (args->length != want) {
+    std_compile_error("wrong number of arguments to a vector intrinsic");
+  }
+  Node* a = (Node*)get_list(args, 0);
+  Node* b = want > 1 ? (Node*)get_list(args, 1) : NULL;
+  unsigned int width = vi->width ? vi->width : vec_width(ctx, a);
+  if (width == 0) { std_compile_error("vector intrinsic expects a vector"); }
+  if (ctx->opts.isa < vi->isa || (width == 32 && ctx->opts.isa < ISA_AVX2)) {
+    std_compile_error("vector intrinsic needs a newer -march");
+  }
+  if ((vi->kind == VI_STORE || vi->kind == VI_BINARY) && vec_width(ctx, b) != width) {
+    std_compile_error("vector widths do not match");
+  }
+  if (width == 32) { ctx->uses_ymm = true; }
+  bool vex = use_vex(ctx, width);
+  const char* v = vex ? "v" : "";
+  const char* r0 = vec_reg(0, width);
+  const char* r1 = vec_reg(1, width);
+  switch (vi->kind) {
+    case VI_LOAD:
+      gen_expr(ctx, a);
+      asm_emit(ctx, "%smovdqu (%%rax), %s", v, r0);
+      break;
+    case VI_STORE:
+      gen_expr(ctx, a);
+      push_rax(ctx);
+      gen_vec_expr(ctx, b);
+      pop_into(ctx, REG_RAX);
+      asm_emit(ctx, "%smovdqu %s, (%%rax)", v, r0);
+      break;
+    case VI_MOVEMASK:
+      gen_vec_expr(ctx, a);
+      asm_emit(ctx, "%s%s %s, %%eax", v, vi->op, r0);
+      break;
+    case VI_SHUFFLE:
+      if (b->type != AST_LITERAL || b->literalExpr.str_value ||
+          b->literalExpr.num_value < 0 || b->literalExpr.num_value > 255) {
+        std_compile_error("shuffle control must be a literal from 0 to 255");
+      }
+      gen_vec_expr(ctx, a);
+      asm_emit(ctx, "%s%s $%lld, %s, %s", v, vi->op, b->literalExpr.num_value, r0, r0);
+      break;
+    case VI_BINARY: {
+      char src[64];
+      symbol_t* sym = vec_operand_sym(ctx, b);
+      gen_vec_expr(ctx, a);
+      if (sym) {
+        vec_sym_addr(ctx, sym, src, sizeof(src));
+      } else {
+        push_vec(ctx, width);
+        gen_vec_expr(ctx, b);
+        asm_emit(ctx, "%smovdqa %s, %s", v, r0, r1);
+        pop_vec(ctx, 0, width);
+        snprintf(src, sizeof(src), "%s", r1);
+      }
+      if (vex) {
+        asm_emit(ctx, "v%s %s, %s, %s", vi->op, src, r0, r0);
+      } else {
+        asm_emit(ctx, "%s %s, %s", vi->op, src, r0);
+      }
+      break;
+    }
+  }
+}
+
+static void gen_vec_expr(asm_ctx* ctx, Node* node) {
+  unsigned int width = vec_width(ctx, node);
+  if (width == 0) { std_compile_error("expected a vector"); }
+  if (width == 32) {
+    if (ctx->opts.isa < ISA_AVX2) { std_compile_error("V256 needs -march=x86-64-v3"); }
+    ctx->uses_ymm = true;
+  }
+  switch (node->type) {
+    case AST_IDENTIFIER:
+      vec_move_sym(ctx, find_symbol(ctx, node->identifierExpr.name), 0, true);
+      break;
+    case AST_ASSIGN:
+      if (vec_width(ctx, node->assignExpr.val) != width) {
+        std_compile_error("vector widths do not match");
+      }
+      gen_vec_expr(ctx, node->assignExpr.val);
+      vec_move_sym(ctx, find_symbol(ctx, node->assignExpr.target->identifierExpr.name), 0, false);
+      break;
+    default:
+      gen_vintrin(ctx, node, find_vintrin(node->callExpr.callee->identifierExpr.name));
+      break;
+  }
+}
+
+/// whether evaluating an expression can change what another one reads
+static bool has_effects(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_CALL:
+    case AST_ASSIGN:
+      return true;
+    case AST_UNARY:  return has_effects(node->unaryExpr.expr);
+    case AST_BINARY:
+      return has_effects(node->binaryExpr.expr_left) || has_effects(node->binaryExpr.expr_right);
+    case AST_CAST:   return has_effects(node->castExpr.inner);
+    case AST_INDEX:
+      return has_effects(node->arrayIndex.target) || has_effects(node->arrayIndex.index);
+    default:         return false;
+  }
+}
+
+/// stores %rax into the outgoing slot of stack argument i
+static void store_stack_arg(asm_ctx* ctx, int i, unsigned int base) {
+  asm_emit(ctx, "movq %%rax, %u(%%rsp)", 8 * (i - 6 + ctx->push_depth - base));
+}
+
+/// evaluates call arguments into their registers and, past the sixth, into
+/// the stack slots reserved at push depth base. arguments up to the last one
+/// with side effects are evaluated in order, waiting on the stack when they
+/// go in a register. the rest are evaluated straight into place, literals and
+/// variables last, once nothing can clobber their registers
+static void gen_args(asm_ctx* ctx, ArrayList* args, unsigned int base) {
+  int n = args->length;
+  int in_regs = n < 6 ? n : 6;
+  int last = -1;
+  for (int i = 0; i < n; i++) {
+    if (has_effects((Node*)get_list(args, i))) { last = i; }
+  }
+  int waiting[6];
+  int n_waiting = 0;
+  for (int i = 0; i <= last; i++) {
+    Node* arg = (Node*)get_list(args, i);
+    // nothing can change a literal, so it is loaded with the late ones
+    if (i < in_regs && arg->type == AST_LITERAL) { continue; }
+    gen_expr(ctx, arg);
+    if (i < in_regs) {
+      push_rax(ctx);
+      waiting[n_waiting++] = i;
+    } else {
+      store_stack_arg(ctx, i, base);
+    }
+  }
+  // evaluating an expression clobbers %rcx and %rdx, so those two are filled
+  // after every other computed argument
+  int late[2];
+  int n_late = 0;
+  for (int i = last + 1; i < n; i++) {
+    Node* arg = (Node*)get_list(args, i);
+    if (i < in_regs && is_direct_operand(ctx, arg)) { continue; }
+    if (i < in_regs && (arg_regs[i] == REG_RCX || arg_regs[i] == REG_RDX)) {
+      late[n_late++] = i;
+      continue;
+    }
+    gen_expr(ctx, arg);
+    if (i < in_regs) {
+      asm_emit(ctx, "movq %%rax, %s", reg_to_str(SZ_64, arg_regs[i]));
+    } else {
+      store_stack_arg(ctx, i, base);
+    }
+  }
+  if (n_late == 2) {
+    gen_expr(ctx, (Node*)get_list(args, late[0]));
+    push_rax(ctx);
+  }
+  if (n_late > 0) {
+    int i = late[n_late - 1];
+    gen_expr(ctx, (Node*)get_list(args, i));
+    asm_emit(ctx, "movq %%rax, %s", reg_to_str(SZ_64, arg_regs[i]));
+  }
+  if (n_late == 2) { pop_into(ctx, arg_regs[late[0]]); }
+  for (int i = 0; i < in_regs; i++) {
+    Node* arg = (Node*)get_list(args, i);
+    bool deferred = i <= last ? arg->type == AST_LITERAL : is_direct_operand(ctx, arg);
+    if (deferred) { load_direct_operand(ctx, arg, arg_regs[i]); }
+  }
+  while (n_waiting > 0) {
+    pop_into(ctx, arg_regs[waiting[--n_waiting]]);
+  }
+}
+
+static void gen_call(asm_ctx* ctx, Node* node) {
+  call_expr ce = node->callExpr;
+  const vintrin* vi = find_vintrin(ce.callee->identifierExpr.name);
+  if (vi) {
+    if (vintrin_width(ctx, vi, node)) { std_compile_error("a vector can not be used as a scalar"); }
+    gen_vintrin(ctx, node, vi);
+    return;
+  }
+  ArrayList* args = ce.args;
+  int n = args->length;
+  int in_regs = n < 6 ? n : 6;
+  // arguments past the sixth go in an area at the bottom of the stack,
+  // padded so %rsp is 16 byte aligned at the call
+  int on_stack = n - in_regs;
+  int area = on_stack + (int)((ctx->push_depth + on_stack) % 2);
+  if (area > 0) {
+    asm_emit(ctx, "subq $%d, %%rsp", 8 * area);
+    ctx->push_depth += area;
+    cfa_adjust(ctx, 8 * area);
+  }
+  gen_args(ctx, args, ctx->push_depth);
+  // the callee may run SSE code, which stalls on dirty upper halves
+  if (ctx->uses_ymm) { asm_emit(ctx, "vzeroupper"); }
+  operand_t* lbl = mk_label(ce.callee->identifierExpr.name);
+  emit_call(ctx->emitter, lbl);
+  free(lbl);
+  if (area > 0) {
+    asm_emit(ctx, "addq $%d, %%rsp", 8 * area);
+    ctx->push_depth -= area;
+    cfa_adjust(ctx, -8 * area);
+  }
+}
+
+static void gen_assign(asm_ctx* ctx, Node* node) {
+  assign_expr ae = node->assignExpr;
+  if (vec_width(ctx, node)) {
+    gen_vec_expr(ctx, node);
+    return;
+  }
+  if (ae.target->type == AST_INDEX) {
+    gen_expr(ctx, ae.val);
+    gen_store_index(ctx, ae.target);
+    return;
+  }
+  if (ae.target->type == AST_UNARY && ae.target->unaryExpr.op == U_DEREF) {
+    gen_expr(ctx, ae.val);
+    gen_store_deref(ctx, ae.target);
+    return;
+  }
+  if (ae.target->type != AST_IDENTIFIER) {
+    std_compile_error("only identifier assignment supported");
+  }
+  gen_expr(ctx, ae.val);
+  const char* name = ae.target->identifierExpr.name;
+  symbol_t* sym = find_symbol(ctx, name);
+  if (!sym) { std_compile_error("undefined identifier in assignment"); }
+  if (sym->type.is_array) { std_compile_error("can not assign to an array"); }
+  if (sym->is_global) {
+    static const char* const rax_names[] = { "%al", "%ax", "%eax", "%rax" };
+    regsize size = type_regsize(&sym->type);
+    asm_emit(ctx, "mov%c %s, %s(%%rip)", "bwlq"[size], rax_names[size], name);
+  } else {
+    store_local(ctx, sym);
+  }
+}
+
+/// two side effect free expressions that always compute the same value or
+/// name the same place
+static bool same_expr(Node* a, Node* b) {
+  if (a->type != b->type) { return false; }
+  switch (a->type) {
+    case AST_IDENTIFIER:
+      return strcmp(a->identifierExpr.name, b->identifierExpr.name) == 0;
+    case AST_LITERAL:
+      return !a->literalExpr.str_value && !b->literalExpr.str_value &&
+             a->literalExpr.num_value == b->literalExpr.num_value;
+    case AST_UNARY:
+      return a->unaryExpr.op == b->unaryExpr.op && same_expr(a->unaryExpr.expr, b->unaryExpr.expr);
+    case AST_BINARY:
+      return a->binaryExpr.op == b->binaryExpr.op &&
+             same_expr(a->binaryExpr.expr_left, b->binaryExpr.expr_left) &&
+             same_expr(a->binaryExpr.expr_right, b->binaryExpr.expr_right);
+    case AST_INDEX:
+      return same_expr(a->arrayIndex.target, b->arrayIndex.target) &&
+             same_expr(a->arrayIndex.index, b->arrayIndex.index);
+    default:
+      return false;
+  }
+}
+
+/// the immediate an update applies to its target, already truncated to the
+/// target's size. false when the instruction can not encode it
+static bool update_imm(binary_expr_t op, regsize size, Node* value, long long* imm) {
+  if (value->type != AST_LITERAL || value->literalExpr.str_value) { return false; }
+  long long k = value->literalExpr.num_value;
+  unsigned int bits = 8u << size;
+  if (op == B_SHL || op == B_SAR || op == B_SHR) {
+    // a narrow right shift would see the bits a 64 bit load extends it with
+    if (k < 0 || k >= bits || (op != B_SHL && size != SZ_64)) { return false; }
+    *imm = k;
+    return true;
+  }
+  switch (size) {
+    case SZ_8:  *imm = (int8_t)k; return true;
+    case SZ_16: *imm = (int16_t)k; return true;
+    case SZ_32: *imm = (int32_t)k; return true;
+    default:
+      *imm = k;
+      return k >= INT32_MIN && k <= INT32_MAX;
+  }
+}
+
+/// applies op with src to the target in place
+static void emit_update(asm_ctx* ctx, binary_expr_t op, operand_t* src, operand_t* dest) {
+  bool one = src->kind == OP_IMM && src->op.imm == 1;
+  switch (op) {
+    case B_ADD:
+      if (one) { emit_inc(ctx->emitter, dest); } else { emit_add(ctx->emitter, src, dest); }
+      break;
+    case B_SUB:
+      if (one) { emit_dec(ctx->emitter, dest); } else { emit_sub(ctx->emitter, src, dest); }
+      break;
+    case B_AND: emit_and(ctx->emitter, src, dest); break;
+    case B_OR:  emit_or(ctx->emitter, src, dest); break;
+    case B_XOR: emit_xor(ctx->emitter, src, dest); break;
+    case B_SHL: emit_shl(ctx->emitter, src, dest); break;
+    case B_SAR: emit_sar(ctx->emitter, src, dest); break;
+    case B_SHR: emit_shr(ctx->emitter, src, dest); break;
+    default: assert(false);
+  }
+}
+
+/// the same update on a global, which is addressed by name
+static void emit_global_update(asm_ctx* ctx, binary_expr_t op, operand_t* src, symbol_t* sym) {
+  static const char* const rax_names[] = { "%al", "%ax", "%eax", "%rax" };
+  static const char* const mnemonics[] = {
+    [B_ADD] = "add", [B_SUB] = "sub", [B_AND] = "and", [B_OR] = "or",
+    [B_XOR] = "xor", [B_SHL] = "shl", [B_SAR] = "sar", [B_SHR] = "shr",
+  };
+  regsize size = type_regsize(&sym->type);
+  char sfx = "bwlq"[size];
+  if (src->kind == OP_IMM && src->op.imm == 1 && (op == B_ADD || op == B_SUB)) {
+    asm_emit(ctx, "%s%c %s(%%rip)", op == B_ADD ? "inc" : "dec", sfx, sym->name);
+  } else if (src->kind == OP_IMM) {
+    asm_emit(ctx, "%s%c $%lld, %s(%%rip)", mnemonics[op], sfx, src->op.imm, sym->name);
+  } else {
+    asm_emit(ctx, "%s%c %s, %s(%%rip)", mnemonics[op], sfx, rax_names[size], sym->name);
+  }
+}
+
+/// the size of the scalar an update target holds, or false when it is not
+/// one gen_update can address
+static bool update_size(asm_ctx* ctx, Node* target, regsize* size) {
+  switch (target->type) {
+    case AST_IDENTIFIER: {
+      symbol_t* sym = find_symbol(ctx, target->identifierExpr.name);
+      if (!sym || sym->type.is_array || is_vector(&sym->type)) { return false; }
+      *size = type_regsize(&sym->type);
+      return true;
+    }
+    case AST_INDEX: {
+      if (target->arrayIndex.target->type != AST_IDENTIFIER) { return false; }
+      index_ref ref = resolve_index(ctx, target);
+      if (is_vector(&ref.elem)) { return false; }
+      *size = type_regsize(&ref.elem);
+      return true;
+    }
+    case AST_UNARY: {
+      if (target->unaryExpr.op != U_DEREF) { return false; }
+      var_t elem = pointee_type(ctx, target->unaryExpr.expr);
+      *size = type_regsize(&elem);
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+/// a statement `x = x op e` updates x where it lives with one instruction,
+/// `incq -8(%rbp)` or `addl %eax, 4(%rdx,%rcx,4)`, instead of loading it into
+/// %rax and storing it back. the value of the assignment is never formed, so
+/// this only runs where it is thrown away
+/// @return false, having emitted nothing, when the statement needs gen_assign
+static bool gen_update(asm_ctx* ctx, Node* node) {
+  if (node->type != AST_ASSIGN || node->assignExpr.val->type != AST_BINARY) { return false; }
+  Node* target = node->assignExpr.target;
+  binary_expr be = node->assignExpr.val->binaryExpr;
+  switch (be.op) {
+    case B_ADD: case B_SUB: case B_AND: case B_OR: case B_XOR:
+    case B_SHL: case B_SAR: case B_SHR:
+      break;
+    default:
+      return false;
+  }
+  regsize size;
+  if (has_effects(target) || !same_expr(target, be.expr_left) || !update_size(ctx, target, &size)) {
+    return false;
+  }
+  long long imm;
+  operand_t* src;
+  if (update_imm(be.op, size, be.expr_right, &imm)) {
+    src = mk_immutable(imm);
+  } else if (!is_shift(be.op) && !has_effects(be.expr_right)) {
+    // computed first, like the value of any other store
+    gen_expr(ctx, be.expr_right);
+    src = mk_register(REG_RAX, size);
+  } else {
+    return false;
+  }
+  bool in_rax = src->kind == OP_REG;
+  operand_t* dest = NULL;
+  if (target->type == AST_IDENTIFIER) {
+    symbol_t* sym = find_symbol(ctx, target->identifierExpr.name);
+    if (sym->is_global) {
+      emit_global_update(ctx, be.op, src, sym);
+      free(src);
+      return true;
+    }
+    dest = mk_local(ctx, sym->stack_offset, size);
+  } else if (target->type == AST_INDEX) {
+    index_ref ref = resolve_index(ctx, target);
+    bool save = in_rax && !ref.is_const && !index_local(ctx, target);
+    if (save) { push_rax(ctx); }
+    gen_index_reg(ctx, target, &ref);
+    if (save) { pop_into(ctx, REG_RAX); }
+    dest = index_mem(ctx, &ref);
+  } else {
+    dest = deref_mem(ctx, target, in_rax ? REG_RDX : REG_RAX);
+  }
+  emit_update(ctx, be.op, src, dest);
+  free(src); free(dest);
+  return true;
+}
+
+static void gen_cast(asm_ctx* ctx, Node* node) {
+  if (is_vector(&node->castExpr.var_t->variable_t)) {
+    std_compile_error("can not cast to a vector");
+  }
+  gen_expr(ctx, node->castExpr.inner);
+  extend_rax(ctx, &node->castExpr.var_t->variable_t);
+}
+
+static void gen_expr(asm_ctx* ctx, Node* node) {
+  switch (node->type) {
+    case AST_LITERAL:    gen_literal(ctx, node); break;
+    case AST_IDENTIFIER: gen_identifier(ctx, node); break;
+    case AST_UNARY:      gen_unary(ctx, node); break;
+    case AST_BINARY:     gen_binary(ctx, node); break;
+    case AST_CALL:       gen_call(ctx, node); break;
+    case AST_ASSIGN:     gen_assign(ctx, node); break;
+    case AST_CAST:       gen_cast(ctx, node); break;
+    case AST_INDEX:      gen_index(ctx, node); break;
+    default:
+      std_compile_error("unsupported expression");
+  }
+}
+
+static void gen_var_decl(asm_ctx* ctx, Node* node) {
+  var_decl vd = node->varDecl;
+  symbol_t* sym = define_local(ctx, vd.ident->identifierExpr.name, vd.type->variable_t);
+  if (vd.assign && sym->type.is_array) {
+    std_compile_error("arrays can not be initialized");
+  }
+  if (is_vector(&sym->type)) {
+    if (sym->type.is_array) { std_compile_error("arrays of vectors are not supported"); }
+    if (vd.assign) {
+      if (vec_width(ctx, vd.assign) != elem_size(&sym->type)) {
+        std_compile_error("vector widths do not match");
+      }
+      gen_vec_expr(ctx, vd.assign);
+      vec_move_sym(ctx, sym, 0, false);
+    }
+    return;
+  }
+  if (vd.assign) {
+    gen_expr(ctx, vd.assign);
+    store_local(ctx, sym);
+  }
+}
+
+static void emit_frame_teardown(asm_ctx* ctx) {
+  if (ctx->use_rbp || ctx->stack_align) {
+    asm_emit(ctx, "movq %%rbp, %%rsp");
+    asm_emit(ctx, "popq %%rbp");
+    asm_emit(ctx, ".cfi_def_cfa %%rsp, 8");
+  } else if (ctx->frame_size > 0) {
+    asm_emit(ctx, "addq $%ld, %%rsp", ctx->frame_size);
+    asm_emit(ctx, ".cfi_def_cfa_offset 8");
+  }
+}
+
+static bool is_tail_call(asm_ctx* ctx, Node* val) {
+  if (!ctx->opts.optimize_sibling_calls || !val || val->type != AST_CALL ||
+      find_vintrin(val->callExpr.callee->identifierExpr.name)) {
+    return false;
+  }
+  // stack arguments would have to be written over this function's own
+  if (val->callExpr.args->length > 6 || ctx->push_depth != 0 || ctx->frame_escapes) {
+    return false;
+  }
+  // a narrow return type needs its value normalized after the call returns,
+  // which only a self call (returning through this same epilogue) skips safely
+  func_type ft = ctx->cur_func->funcDecl.type->function_t;
+  const char* callee = val->callExpr.callee->identifierExpr.name;
+  return type_size(&ft.ret_t->variable_t) == 8 ||
+         strcmp(callee, ft.ident->identifierExpr.name) == 0;
+}
+
+/// a call in tail position reuses the current frame. self calls jump back
+/// to the parameter spills, everything else tears the frame down and jumps
+static void gen_tail_call(asm_ctx* ctx, Node* node) {
+  call_expr ce = node->callExpr;
+  ArrayList* args = ce.args;
+  int n = args->length;
+  gen_args(ctx, args, ctx->push_depth);
+  const char* callee = ce.callee->identifierExpr.name;
+  func_type ft = ctx->cur_func->funcDecl.type->function_t;
+  if (strcmp(callee, ft.ident->identifierExpr.name) == 0 && n == ft.params->length) {
+    asm_emit(ctx, "jmp %s", ctx->entry_label);
+    return;
+  }
+  asm_emit(ctx, ".cfi_remember_state");
+  if (ctx->uses_ymm) { asm_emit(ctx, "vzeroupper"); }
+  emit_frame_teardown(ctx);
+  asm_emit(ctx, "jmp %s", callee);
+  asm_emit(ctx, ".cfi_restore_state");
+}
+
+static void gen_return(asm_ctx* ctx, Node* node) {
+  return_stmt rs = node->returnStmt;
+  if (is_tail_call(ctx, rs.return_val)) {
+    gen_tail_call(ctx, rs.return_val);
+    return;
+  }
+  if (rs.return_val) {
+    gen_expr(ctx, rs.return_val);
+    extend_rax(ctx, &ctx->cur_func->funcDecl.type->function_t.ret_t->variable_t);
+  }
+  asm_emit(ctx, "jmp %s", ctx->epilogue_label);
+}
+
+static void gen_if(asm_ctx* ctx, Node* node) {
+  if_stmt is = node->ifStmt;
+  unsigned int else_lbl = new_label(ctx);
+  unsigned int end_lbl = new_label(ctx);
+  gen_expr(ctx, is.cond);
+  asm_emit(ctx, "cmpq $0, %%rax");
+  asm_emit(ctx, "je .L%s.%u", ctx->label_prefix, else_lbl);
+  gen_stmt(ctx, is.then_branch);
+  asm_emit(ctx, "jmp .L%s.%u", ctx->label_prefix, end_lbl);
+  asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, else_lbl);
+  if (is.else_branch) { gen_stmt(ctx, is.else_branch); }
+  asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, end_lbl);
+}
+
+/// the jump taken when a comparison holds, NULL for anything else
+static const char* cond_jump(Node* cond) {
+  if (cond->type != AST_BINARY) { return NULL; }
+  switch (cond->binaryExpr.op) {
+    case B_LESS:        return "jl";
+    case B_GREATER:     return "jg";
+    case B_EQUAL_EQUAL: return "je";
+    case B_NOT_EQUAL:   return "jne";
+    case B_GEQ:         return "jge";
+    case B_LEQ:         return "jle";
+    default:            return NULL;
+  }
+}
+
+/// jumps to a label when a loop condition holds. comparisons branch on the
+/// flags directly instead of materializing a 0 or 1 first
+static void gen_cond_jump(asm_ctx* ctx, Node* cond, unsigned int lbl) {
+  const char* jcc = cond_jump(cond);
+  if (!jcc) {
+    gen_expr(ctx, cond);
+    asm_emit(ctx, "cmpq $0, %%rax");
+    asm_emit(ctx, "jne .L%s.%u", ctx->label_prefix, lbl);
+    return;
+  }
+  gen_expr(ctx, cond->binaryExpr.expr_left);
+  push_rax(ctx);
+  gen_expr(ctx, cond->binaryExpr.expr_right);
+  operand_t* rax = mk_register(REG_RAX, SZ_64);
+  operand_t* rcx = mk_register(REG_RCX, SZ_64);
+  emit_mov(ctx->emitter, rax, rcx);
+  pop_into(ctx, REG_RAX);
+  emit_cmp(ctx->emitter, rcx, rax);
+  asm_emit(ctx, "%s .L%s.%u", jcc, ctx->label_prefix, lbl);
+  free(rax); free(rcx);
+}
+
+/// what a loop body does that matters to bounds checking its counter
+typedef struct {
+  const char* counter;
+  const char* bound;   ///< NULL when the bound is a literal
+  bool unsafe;         ///< the counter or bound may change inside the body
+  ArrayList* accesses; ///< array[counter] nodes, on arrays of known length
+  ArrayList* decls;    ///< names declared in the body, which shadow outer arrays
+} loop_scan;
+
+static bool names_counter(loop_scan* ls, Node* node) {
+  if (node->type != AST_IDENTIFIER) { return false; }
+  const char* name = node->identifierExpr.name;
+  return strcmp(name, ls->counter) == 0 || (ls->bound && strcmp(name, ls->bound) == 0);
+}
+
+static void scan_loop(asm_ctx* ctx, loop_scan* ls, Node* node);
+
+static void scan_loop_list(asm_ctx* ctx, loop_scan* ls, ArrayList* nodes) {
+  if (!nodes) { return; }
+  for (int i = 0; i < nodes->length; i++) {
+    scan_loop(ctx, ls, (Node*)get_list(nodes, i));
+  }
+}
+
+static void scan_loop(asm_ctx* ctx, loop_scan* ls, Node* node) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_BLOCK: scan_loop_list(ctx, ls, node->blockStmt.nodes); break;
+    case AST_VAR_DECL:
+      add_list(ls->decls, (void*)node->varDecl.ident->identifierExpr.name);
+      ls->unsafe |= names_counter(ls, node->varDecl.ident);
+      scan_loop(ctx, ls, node->varDecl.assign);
+      break;
+    case AST_IF:
+      scan_loop(ctx, ls, node->ifStmt.cond);
+      scan_loop(ctx, ls, node->ifStmt.then_branch);
+      scan_loop(ctx, ls, node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      scan_loop(ctx, ls, node->whileStmt.cond);
+      scan_loop(ctx, ls, node->whileStmt.body);
+      scan_loop(ctx, ls, node->whileStmt.step);
+      break;
+    case AST_RETURN: scan_loop(ctx, ls, node->returnStmt.return_val); break;
+    case AST_UNARY:
+      // ++, -- and & all hand the operand to something that can change it
+      if (node->unaryExpr.op == U_PLUS_PLUS || node->unaryExpr.op == U_MINUS_MINUS ||
+          node->unaryExpr.op == U_ADDR) {
+        ls->unsafe |= names_counter(ls, node->unaryExpr.expr);
+      }
+      scan_loop(ctx, ls, node->unaryExpr.expr);
+      break;
+    case AST_BINARY:
+      scan_loop(ctx, ls, node->binaryExpr.expr_left);
+      scan_loop(ctx, ls, node->binaryExpr.expr_right);
+      break;
+    case AST_ASSIGN: {
+      Node* target = node->assignExpr.target;
+      ls->unsafe |= names_counter(ls, target);
+      if (target->type == AST_INDEX) {
+        // a store through a pointer could land on the counter or the bound
+        symbol_t* sym = target->arrayIndex.target->type == AST_IDENTIFIER
+                          ? find_symbol(ctx, target->arrayIndex.target->identifierExpr.name)
+                          : NULL;
+        ls->unsafe |= !sym || !sym->type.is_array;
+        scan_loop(ctx, ls, target);
+      } else if (target->type == AST_UNARY) {
+        ls->unsafe = true;
+        scan_loop(ctx, ls, target);
+      }
+      scan_loop(ctx, ls, node->assignExpr.val);
+      break;
+    }
+    case AST_CAST: scan_loop(ctx, ls, node->castExpr.inner); break;
+    case AST_INDEX: {
+      Node* target = node->arrayIndex.target;
+      Node* idx = node->arrayIndex.index;
+      if (target->type == AST_IDENTIFIER && idx->type == AST_IDENTIFIER &&
+          strcmp(idx->identifierExpr.name, ls->counter) == 0) {
+        symbol_t* sym = find_symbol(ctx, target->identifierExpr.name);
+        if (sym && sym->type.is_array) { add_list(ls->accesses, node); }
+      }
+      scan_loop(ctx, ls, idx);
+      break;
+    }
+    case AST_CALL:
+      // the callee could write the counter through an address taken earlier
+      ls->unsafe = true;
+      break;
+    case AST_ARRAY_LIT: scan_loop_list(ctx, ls, node->arrayLit.elements); break;
+    default: break;
+  }
+}
+
+static bool declared_in(loop_scan* ls, const char* name) {
+  for (int i = 0; i < ls->decls->length; i++) {
+    if (strcmp((const char*)get_list(ls->decls, i), name) == 0) { return true; }
+  }
+  return false;
+}
+
+/// step is `counter = counter + 1`
+static bool is_increment(Node* step, const char* counter) {
+  if (!step || step->type != AST_ASSIGN) { return false; }
+  Node* target = step->assignExpr.target;
+  Node* val = step->assignExpr.val;
+  if (target->type != AST_IDENTIFIER || strcmp(target->identifierExpr.name, counter) != 0 ||
+      val->type != AST_BINARY || val->binaryExpr.op != B_ADD) {
+    return false;
+  }
+  Node* l = val->binaryExpr.expr_left;
+  Node* r = val->binaryExpr.expr_right;
+  if (l->type == AST_LITERAL) { Node* t = l; l = r; r = t; }
+  return l->type == AST_IDENTIFIER && strcmp(l->identifierExpr.name, counter) == 0 &&
+         r->type == AST_LITERAL && !r->literalExpr.str_value && r->literalExpr.num_value == 1;
+}
+
+/// a loop `while (i < n) { ... a[i] ... } step i = i + 1` only ever indexes
+/// with i in [i0, n), so one check of i0 >= 0 and n <= len before the loop
+/// stands in for a check on every access. the accesses it covers are added
+/// to ctx->proven
+static void hoist_bounds_checks(asm_ctx* ctx, Node* node) {
+  while_stmt ws = node->whileStmt;
+  Node* cond = ws.cond;
+  if (cond->type != AST_BINARY || cond->binaryExpr.op != B_LESS) { return; }
+  Node* i = cond->binaryExpr.expr_left;
+  Node* n = cond->binaryExpr.expr_right;
+  if (i->type != AST_IDENTIFIER || !is_increment(ws.step, i->identifierExpr.name)) { return; }
+  if (n->type != AST_IDENTIFIER && (n->type != AST_LITERAL || n->literalExpr.str_value)) {
+    return;
+  }
+  // a narrower counter could wrap around to a negative index
+  symbol_t* isym = find_symbol(ctx, i->identifierExpr.name);
+  if (!isym || isym->type.is_array || isym->type.is_adr || elem_size(&isym->type) != 8) {
+    return;
+  }
+  if (n->type == AST_IDENTIFIER) {
+    symbol_t* nsym = find_symbol(ctx, n->identifierExpr.name);
+    if (!nsym || nsym->type.is_array) { return; }
+  }
+  loop_scan ls = {
+    .counter = i->identifierExpr.name,
+    .bound = n->type == AST_IDENTIFIER ? n->identifierExpr.name : NULL,
+    .unsafe = false,
+    .accesses = init_list(8),
+    .decls = init_list(8),
+  };
+  scan_loop(ctx, &ls, ws.body);
+  unsigned int len = 0;
+  bool any = false;
+  for (int k = 0; k < ls.accesses->length && !ls.unsafe; k++) {
+    Node* access = (Node*)get_list(ls.accesses, k);
+    const char* name = access->arrayIndex.target->identifierExpr.name;
+    if (declared_in(&ls, name)) { continue; }
+    unsigned int alen = find_symbol(ctx, name)->type.array_len;
+    if (!any || alen < len) { len = alen; }
+    any = true;
+  }
+  if (any) {
+    unsigned int skip = new_label(ctx);
+    gen_expr(ctx, n);
+    asm_emit(ctx, "movq %%rax, %%rcx");
+    gen_expr(ctx, i);
+    // a loop that never runs indexes nothing
+    asm_emit(ctx, "cmpq %%rcx, %%rax");
+    asm_emit(ctx, "jge .L%s.%u", ctx->label_prefix, skip);
+    asm_emit(ctx, "testq %%rax, %%rax");
+    asm_emit(ctx, "js %s", trap_label(ctx));
+    asm_emit(ctx, "cmpq $%u, %%rcx", len);
+    asm_emit(ctx, "jg %s", trap_label(ctx));
+    asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, skip);
+    for (int k = 0; k < ls.accesses->length; k++) {
+      Node* access = (Node*)get_list(ls.accesses, k);
+      if (!declared_in(&ls, access->arrayIndex.target->identifierExpr.name)) {
+        add_list(ctx->proven, access);
+      }
+    }
+  }
+  free(ls.accesses->items); free(ls.accesses);
+  free(ls.decls->items); free(ls.decls);
+}
+
+// ------------------------------------------------------------------
+// loop vectorization
+//
+// a counted loop whose body only stores to arrays at the counter, from
+// sums, differences and comparisons of other arrays at the counter and of
+// values the loop never changes, runs a vector of elements per iteration
+// until fewer than a vector's worth are left. the scalar loop it was
+// generated from then finishes the rest, picking up the counter where the
+// vector loop left it
+
+/// expressions are evaluated on a stack of vector registers from 0, values
+/// broadcast before the loop live in the registers from VEC_SPLAT_BASE
+#define VEC_TEMPS 8
+#define VEC_SPLAT_BASE 8
+#define VEC_SPLATS 8
+
+typedef struct {
+  const char* counter;
+  symbol_t* counter_sym;
+  bool has_elem;
+  var_t elem;          ///< the element type every array in the loop shares
+  ArrayList* splats;   ///< literals and invariant scalars, one register each
+  ArrayList* accesses; ///< every array[counter] node
+} vec_loop;
+
+static bool vec_access_ok(asm_ctx* ctx, vec_loop* vl, Node* node) {
+  Node* target = node->arrayIndex.target;
+  Node* idx = node->arrayIndex.index;
+  if (target->type != AST_IDENTIFIER || idx->type != AST_IDENTIFIER ||
+      strcmp(idx->identifierExpr.name, vl->counter) != 0) {
+    return false;
+  }
+  // distinct arrays never overlap, which pointers could
+  symbol_t* sym = find_symbol(ctx, target->identifierExpr.name);
+  if (!sym || !sym->type.is_array || sym->type.is_adr) { return false; }
+  if (!vl->has_elem) {
+    vl->elem = sym->type;
+    vl->has_elem = true;
+  } else if (sym->type.type != vl->elem.type) {
+    return false;
+  }
+  add_list(vl->accesses, node);
+  return true;
+}
+
+/// a literal compared against elements has to fit them, the packed compare
+/// only sees its low bits
+static bool vec_literal_fits(vec_loop* vl, Node* node) {
+  long long v = node->literalExpr.num_value;
+  switch (elem_size(&vl->elem)) {
+    case 1:  return v >= 0 && v <= 255;
+    case 2:  return v >= -32768 && v <= 32767;
+    case 4:  return v >= -2147483648LL && v <= 2147483647LL;
+    default: return true;
+  }
+}
+
+static bool vec_expr_ok(asm_ctx* ctx, vec_loop* vl, Node* node, unsigned int depth, bool top) {
+  if (depth >= VEC_TEMPS) { return false; }
+  switch (node->type) {
+    case AST_INDEX:
+      return vec_access_ok(ctx, vl, node);
+    case AST_LITERAL:
+      if (node->literalExpr.str_value || vl->splats->length >= VEC_SPLATS) { return false; }
+      add_list(vl->splats, node);
+      return true;
+    case AST_IDENTIFIER: {
+      symbol_t* sym = find_symbol(ctx, node->identifierExpr.name);
+      if (!sym || sym->type.is_array || is_vector(&sym->type) || strcmp(sym->name, vl->counter) == 0 ||
+          vl->splats->length >= VEC_SPLATS) {
+        return false;
+      }
+      add_list(vl->splats, node);
+      return true;
+    }
+    case AST_BINARY: {
+      Node* l = node->binaryExpr.expr_left;
+      Node* r = node->binaryExpr.expr_right;
+      switch (node->binaryExpr.op) {
+        case B_ADD:
+        case B_SUB:
+          return vec_expr_ok(ctx, vl, l, depth, false) && vec_expr_ok(ctx, vl, r, depth + 1, false);
+        case B_EQUAL_EQUAL:
+        case B_LESS:
+        case B_GREATER:
+          // a scalar compares the widened values, so only the element types
+          // and literals that fit them compare the same way packed
+          if (!top || (l->type != AST_INDEX && l->type != AST_LITERAL) ||
+              (r->type != AST_INDEX && r->type != AST_LITERAL) ||
+              (l->type == AST_LITERAL && r->type == AST_LITERAL)) {
+            return false;
+          }
+          if (!vec_expr_ok(ctx, vl, l, depth, false) || !vec_expr_ok(ctx, vl, r, depth + 1, false)) {
+            return false;
+          }
+          if ((l->type == AST_LITERAL && !vec_literal_fits(vl, l)) ||
+              (r->type == AST_LITERAL && !vec_literal_fits(vl, r))) {
+            return false;
+          }
+          if (node->binaryExpr.op != B_EQUAL_EQUAL && vl->elem.type == LIT_BYTE) {
+            return false; // BYTE is unsigned, packed compares are signed
+          }
+          if (elem_size(&vl->elem) == 8) {
+            return ctx->opts.isa >= ISA_SSE42;
+          }
+          return true;
+        default:
+          return false;
+      }
+    }
+    default:
+      return false;
+  }
+}
+
+/// checks the loop shape and collects what gen_vector_loop needs
+static bool vec_loop_ok(asm_ctx* ctx, Node* node, vec_loop* vl) {
+  while_stmt ws = node->whileStmt;
+  Node* cond = ws.cond;
+  if (cond->type != AST_BINARY || cond->binaryExpr.op != B_LESS) { return false; }
+  Node* i = cond->binaryExpr.expr_left;
+  Node* n = cond->binaryExpr.expr_right;
+  if (i->type != AST_IDENTIFIER || !is_increment(ws.step, i->identifierExpr.name)) { return false; }
+  vl->counter = i->identifierExpr.name;
+  vl->counter_sym = find_symbol(ctx, vl->counter);
+  symbol_t* c = vl->counter_sym;
+  if (!c || c->is_global || c->type.is_array || c->type.is_adr || elem_size(&c->type) != 8) {
+    return false;
+  }
+  if (n->type == AST_IDENTIFIER) {
+    symbol_t* nsym = find_symbol(ctx, n->identifierExpr.name);
+    if (!nsym || nsym->type.is_array || nsym == c) { return false; }
+  } else if (n->type != AST_LITERAL || n->literalExpr.str_value) {
+    return false;
+  }
+  if (ws.body->type != AST_BLOCK) { return false; }
+  ArrayList* stmts = ws.body->blockStmt.nodes;
+  unsigned int stores = 0;
+  for (int k = 0; k < stmts->length; k++) {
+    Node* st = (Node*)get_list(stmts, k);
+    if (st->type == AST_COMMENT) { continue; }
+    // every statement is arr[i] = ..., so nothing but array elements change
+    if (st->type != AST_ASSIGN || st->assignExpr.target->type != AST_INDEX ||
+        !vec_access_ok(ctx, vl, st->assignExpr.target) ||
+        !vec_expr_ok(ctx, vl, st->assignExpr.val, 0, true)) {
+      return false;
+    }
+    stores++;
+  }
+  if (stores == 0) { return false; }
+  // with bounds checks on, only a loop whose accesses the preheader covered
+  for (int k = 0; k < vl->accesses->length && ctx->opts.bounds_check; k++) {
+    if (!is_proven(ctx, (Node*)get_list(vl->accesses, k))) { return false; }
+  }
+  return true;
+}
+
+static bool vec_avx(asm_ctx* ctx) {
+  return ctx->opts.isa >= ISA_AVX2;
+}
+
+/// the name of vector register n at the width the loop runs at
+static const char* vreg(asm_ctx* ctx, unsigned int n) {
+  return vec_reg(n, vec_avx(ctx) ? 32 : 16);
+}
+
+/// the b, w, d or q suffix of packed integer instructions on the elements
+static char vec_suffix(vec_loop* vl) {
+  switch (elem_size(&vl->elem)) {
+    case 1:  return 'b';
+    case 2:  return 'w';
+    case 4:  return 'd';
+    default: return 'q';
+  }
+}
+
+/// emits a packed op, `op src, dst` on SSE and `vop src, dst, dst` on AVX
+static void vec_op(asm_ctx* ctx, const char* op, unsigned int src, unsigned int dst) {
+  if (vec_avx(ctx)) {
+    asm_emit(ctx, "v%s %s, %s, %s", op, vreg(ctx, src), vreg(ctx, dst), vreg(ctx, dst));
+  } else {
+    asm_emit(ctx, "%s %s, %s", op, vreg(ctx, src), vreg(ctx, dst));
+  }
+}
+
+/// the address of array[counter], with the counter in %rcx
+static void vec_addr(asm_ctx* ctx, vec_loop* vl, Node* access, char* buf, size_t len) {
+  symbol_t* sym = find_symbol(ctx, access->arrayIndex.target->identifierExpr.name);
+  unsigned int scale = elem_size(&vl->elem);
+  if (sym->is_global) {
+    gen_address(ctx, sym, "%rdx");
+    snprintf(buf, len, "(%%rdx,%%rcx,%u)", scale);
+  } else if (ctx->use_rbp) {
+    snprintf(buf, len, "%ld(%%rbp,%%rcx,%u)", sym->stack_offset, scale);
+  } else {
+    snprintf(buf, len, "%ld(%%rsp,%%rcx,%u)", rsp_disp(ctx, sym->stack_offset), scale);
+  }
+}
+
+static unsigned int vec_splat_reg(vec_loop* vl, Node* node) {
+  for (int k = 0; k < vl->splats->length; k++) {
+    if (get_list(vl->splats, k) == node) { return VEC_SPLAT_BASE + k; }
+  }
+  assert(false);
+  return 0;
+}
+
+/// fills every element of a vector register with the low bits of %rax
+static void vec_broadcast(asm_ctx* ctx, vec_loop* vl, unsigned int reg) {
+  const char* x = vreg(ctx, reg);
+  if (vec_avx(ctx)) {
+    const char* xmm = vec_reg(reg, 16);
+    asm_emit(ctx, "vmovq %%rax, %s", xmm);
+    asm_emit(ctx, "vpbroadcast%c %s, %s", vec_suffix(vl), xmm, x);
+    return;
+  }
+  switch (elem_size(&vl->elem)) {
+    case 1:
+      asm_emit(ctx, "movd %%eax, %s", x);
+      asm_emit(ctx, "punpcklbw %s, %s", x, x);
+      asm_emit(ctx, "pshuflw $0, %s, %s", x, x);
+      asm_emit(ctx, "punpcklqdq %s, %s", x, x);
+      break;
+    case 2:
+      asm_emit(ctx, "movd %%eax, %s", x);
+      asm_emit(ctx, "pshuflw $0, %s, %s", x, x);
+      asm_emit(ctx, "punpcklqdq %s, %s", x, x);
+      break;
+    case 4:
+      asm_emit(ctx, "movd %%eax, %s", x);
+      asm_emit(ctx, "pshufd $0, %s, %s", x, x);
+      break;
+    default:
+      asm_emit(ctx, "movq %%rax, %s", x);
+      asm_emit(ctx, "punpcklqdq %s, %s", x, x);
+      break;
+  }
+}
+
+static void vec_expr(asm_ctx* ctx, vec_loop* vl, Node* node, unsigned int depth);
+
+/// the register holding an expression, evaluating it into register depth
+/// unless it was broadcast before the loop
+static unsigned int vec_operand(asm_ctx* ctx, vec_loop* vl, Node* node, unsigned int depth) {
+  if (node->type == AST_LITERAL || node->type == AST_IDENTIFIER) {
+    return vec_splat_reg(vl, node);
+  }
+  vec_expr(ctx, vl, node, depth);
+  return depth;
+}
+
+/// leaves the value of an expression in vector register depth
+static void vec_expr(asm_ctx* ctx, vec_loop* vl, Node* node, unsigned int depth) {
+  const char* mov = vec_avx(ctx) ? "vmovdqu" : "movdqu";
+  char op[16];
+  switch (node->type) {
+    case AST_INDEX: {
+      char addr[48];
+      vec_addr(ctx, vl, node, addr, sizeof(addr));
+      asm_emit(ctx, "%s %s, %s", mov, addr, vreg(ctx, depth));
+      return;
+    }
+    case AST_LITERAL:
+    case AST_IDENTIFIER:
+      asm_emit(ctx, "%s %s, %s", vec_avx(ctx) ? "vmovdqa" : "movdqa",
+               vreg(ctx, vec_splat_reg(vl, node)), vreg(ctx, depth));
+      return;
+    default:
+      break;
+  }
+  binary_expr be = node->binaryExpr;
+  char sfx = vec_suffix(vl);
+  // pcmpgt only tests greater than, so a < b is b > a
+  bool swap = be.op == B_LESS;
+  vec_expr(ctx, vl, swap ? be.expr_right : be.expr_left, depth);
+  unsigned int src = vec_operand(ctx, vl, swap ? be.expr_left : be.expr_right, depth + 1);
+  switch (be.op) {
+    case B_ADD: snprintf(op, sizeof(op), "padd%c", sfx); break;
+    case B_SUB: snprintf(op, sizeof(op), "psub%c", sfx); break;
+    case B_EQUAL_EQUAL: snprintf(op, sizeof(op), "pcmpeq%c", sfx); break;
+    default: snprintf(op, sizeof(op), "pcmpgt%c", sfx); break;
+  }
+  vec_op(ctx, op, src, depth);
+  if (be.op == B_ADD || be.op == B_SUB) { return; }
+  // a true lane is all ones, negating it gives the 1 a scalar compare does
+  snprintf(op, sizeof(op), "psub%c", sfx);
+  if (vec_avx(ctx)) {
+    asm_emit(ctx, "vpxor %s, %s, %s", vreg(ctx, depth + 1), vreg(ctx, depth + 1), vreg(ctx, depth + 1));
+    asm_emit(ctx, "v%s %s, %s, %s", op, vreg(ctx, depth), vreg(ctx, depth + 1), vreg(ctx, depth));
+  } else {
+    asm_emit(ctx, "pxor %s, %s", vreg(ctx, depth + 1), vreg(ctx, depth + 1));
+    vec_op(ctx, op, depth, depth + 1);
+    asm_emit(ctx, "movdqa %s, %s", vreg(ctx, depth + 1), vreg(ctx, depth));
+  }
+}
+
+/// emits the vector loop in front of a scalar loop that can take it, which
+/// then only runs the elements left over
+static void gen_vector_loop(asm_ctx* ctx, Node* node) {
+  vec_loop vl = { 0 };
+  vl.splats = init_list(VEC_SPLATS);
+  vl.accesses = init_list(8);
+  if (vec_loop_ok(ctx, node, &vl)) {
+    unsigned int lanes = (vec_avx(ctx) ? 32 : 16) / elem_size(&vl.elem);
+    unsigned int body_lbl = new_label(ctx);
+    unsigned int cond_lbl = new_label(ctx);
+    for (int k = 0; k < vl.splats->length; k++) {
+      gen_expr(ctx, (Node*)get_list(vl.splats, k));
+      vec_broadcast(ctx, &vl, VEC_SPLAT_BASE + k);
+    }
+    gen_expr(ctx, node->whileStmt.cond->binaryExpr.expr_right);
+    asm_emit(ctx, "movq %%rax, %%r8");
+    load_local_into(ctx, vl.counter_sym, REG_RCX);
+    asm_emit(ctx, "jmp .L%s.%u", ctx->label_prefix, cond_lbl);
+    asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, body_lbl);
+    ArrayList* stmts = node->whileStmt.body->blockStmt.nodes;
+    const char* mov = vec_avx(ctx) ? "vmovdqu" : "movdqu";
+    for (int k = 0; k < stmts->length; k++) {
+      Node* st = (Node*)get_list(stmts, k);
+      if (st->type == AST_COMMENT) { continue; }
+      unsigned int val = vec_operand(ctx, &vl, st->assignExpr.val, 0);
+      char addr[48];
+      vec_addr(ctx, &vl, st->assignExpr.target, addr, sizeof(addr));
+      asm_emit(ctx, "%s %s, %s", mov, vreg(ctx, val), addr);
+    }
+    asm_emit(ctx, "addq $%u, %%rcx", lanes);
+    asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, cond_lbl);
+    asm_emit(ctx, "leaq %u(%%rcx), %%rdx", lanes);
+    asm_emit(ctx, "cmpq %%r8, %%rdx");
+    asm_emit(ctx, "jle .L%s.%u", ctx->label_prefix, body_lbl);
+    if (vec_avx(ctx)) { asm_emit(ctx, "vzeroupper"); }
+    store_reg(ctx, REG_RCX, vl.counter_sym);
+    ctx->loops_vectorized++;
+  }
+  free(vl.splats->items); free(vl.splats);
+  free(vl.accesses->items); free(vl.accesses);
+}
+
+/// loops are laid out bottom tested: one jump into the condition, then every
+/// iteration runs the body and a single conditional branch back to its top
+static void gen_while(asm_ctx* ctx, Node* node) {
+  unsigned int proven = ctx->proven->length;
+  if (ctx->opts.bounds_check) { hoist_bounds_checks(ctx, node); }
+  if (ctx->opts.vectorize) { gen_vector_loop(ctx, node); }
+  while_stmt ws = node->whileStmt;
+  unsigned int body_lbl = new_label(ctx);
+  unsigned int cond_lbl = new_label(ctx);
+  bool forever = ws.cond->type == AST_LITERAL && ws.cond->literalExpr.num_value != 0;
+  if (!forever) {
+    asm_emit(ctx, "jmp .L%s.%u", ctx->label_prefix, cond_lbl);
+  }
+  asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, body_lbl);
+  gen_stmt(ctx, ws.body);
+  if (ws.step) { gen_stmt(ctx, ws.step); }
+  if (forever) {
+    asm_emit(ctx, "jmp .L%s.%u", ctx->label_prefix, body_lbl);
+  } else {
+    asm_raw(ctx, ".L%s.%u:", ctx->label_prefix, cond_lbl);
+    gen_cond_jump(ctx, ws.cond, body_lbl);
+  }
+  ctx->proven->length = proven;
+}
+
+static void gen_block(asm_ctx* ctx, Node* node) {
+  push_scope(ctx);
+  ArrayList* nodes = node->blockStmt.nodes;
+  for (int i = 0; i < nodes->length; i++) {
+    gen_stmt(ctx, (Node*)get_list(nodes, i));
+  }
+  pop_scope(ctx);
+}
+
+static void gen_stmt(asm_ctx* ctx, Node* node) {
+  switch (node->type) {
+    case AST_BLOCK:    gen_block(ctx, node); break;
+    case AST_IF:       gen_if(ctx, node); break;
+    case AST_WHILE:    gen_while(ctx, node); break;
+    case AST_RETURN:   gen_return(ctx, node); break;
+    case AST_VAR_DECL: gen_var_decl(ctx, node); break;
+    case AST_COMMENT:  break;
+    default:
+      if (vec_width(ctx, node)) {
+        gen_vec_expr(ctx, node);
+      } else if (!gen_update(ctx, node)) {
+        gen_expr(ctx, node);
+      }
   }
 }
 
@@ -367,33 +2190,89 @@ void gen_func_decl(asm_ctx* ctx, Node* node) {
   func_type ft = fd.type->function_t;
   const char* name = ft.ident->identifierExpr.name;
   long frame = compute_frame_size(node);
+  ctx->label_prefix = name;
+  ctx->label_count = 0;
+
+  // without a frame pointer, leaf functions only reserve their slots while
+  // everything else pads %rsp so call sites stay 16 byte aligned
+  ctx->use_rbp = !ctx->opts.omit_frame_pointer;
+  ctx->frame_size = 0;
+  // %rbp is 16 byte aligned, so only V256 slots, or V128 ones without a
+  // frame pointer, need the frame realigned. it is then addressed off %rsp,
+  // keeping %rbp only to undo the realignment
+  ctx->stack_align = vector_align(fd.block);
+  if (ctx->stack_align == 16 && ctx->use_rbp) { ctx->stack_align = 0; }
+  ctx->uses_ymm = false;
+  if (ctx->stack_align) {
+    ctx->use_rbp = false;
+    ctx->frame_size = frame;
+  } else if (!ctx->use_rbp) {
+    bool leaf = !has_call(fd.block);
+    ctx->frame_size = leaf ? count_frame_bytes(node) : frame + 8;
+  }
+  if (is_vector(&ft.ret_t->variable_t)) {
+    std_compile_error("functions can not return vectors, store them through a pointer instead");
+  }
 
   ctx->emitter->indent = 0;
-  asm_emit(ctx, ".globl %s", name);
+  if (!ctx->opts.whole_program || strcmp(name, "main") == 0) {
+    asm_emit(ctx, ".globl %s", name);
+  }
   asm_raw(ctx, "%s:", name);
   ctx->emitter->indent = 4;
-  asm_emit(ctx, "pushq %%rbp");
-  asm_emit(ctx, "movq %%rsp, %%rbp");
-  if (frame > 0) {
-    asm_emit(ctx, "subq $%ld, %%rsp", frame);
+  asm_emit(ctx, ".cfi_startproc");
+  if (ctx->use_rbp || ctx->stack_align) {
+    asm_emit(ctx, "pushq %%rbp");
+    asm_emit(ctx, ".cfi_def_cfa_offset 16");
+    asm_emit(ctx, ".cfi_offset %%rbp, -16");
+    asm_emit(ctx, "movq %%rsp, %%rbp");
+    asm_emit(ctx, ".cfi_def_cfa_register %%rbp");
+    if (ctx->stack_align) {
+      asm_emit(ctx, "andq $-%u, %%rsp", ctx->stack_align);
+    }
+    if (frame > 0) {
+      asm_emit(ctx, "subq $%ld, %%rsp", frame);
+    }
+  } else if (ctx->frame_size > 0) {
+    asm_emit(ctx, "subq $%ld, %%rsp", ctx->frame_size);
+    asm_emit(ctx, ".cfi_def_cfa_offset %ld", ctx->frame_size + 8);
   }
 
-  unsigned int el = new_label(ctx);
-  char buf[32];
-  snprintf(buf, sizeof(buf), ".L%u", el);
-  ctx->epilogue_label = strdup(buf);
+  ctx->epilogue_label = label_str(ctx, new_label(ctx));
   ctx->cur_offset = 0;
   ctx->push_depth = 0;
+  ctx->cur_func = node;
+  ctx->frame_escapes = ctx->opts.optimize_sibling_calls && frame_escapes(node);
+  ctx->entry_label = NULL;
+  ctx->trap_label = NULL;
+  if (ctx->opts.optimize_sibling_calls) {
+    ctx->entry_label = label_str(ctx, new_label(ctx));
+    asm_raw(ctx, "%s:", ctx->entry_label);
+  }
 
   push_scope(ctx);
   ArrayList* params = ft.params;
   for (int i = 0; i < params->length; i++) {
     Node* p = (Node*)get_list(params, i);
+    if (p->funcParam.type->variable_t.is_array) {
+      std_compile_error("array parameters are not supported, pass a &TYPE pointer instead");
+    }
+    if (is_vector(&p->funcParam.type->variable_t)) {
+      std_compile_error("vector parameters are not supported, pass a pointer instead");
+    }
     symbol_t* sym = define_local(ctx, p->funcParam.ident->identifierExpr.name, p->funcParam.type->variable_t);
-    operand_t* reg = mk_register(arg_regs[i], SZ_64);
-    operand_t* mem = mk_mem(REG_RBP, SZ_64, sym->stack_offset);
-    emit_mov(ctx->emitter, reg, mem);
-    free(reg); free(mem);
+    if (i < 6) {
+      store_reg(ctx, arg_regs[i], sym);
+      continue;
+    }
+    // the caller left the rest just above the return address
+    long above = 8 + 8 * (i - 6);
+    if (ctx->use_rbp || ctx->stack_align) {
+      asm_emit(ctx, "movq %ld(%%rbp), %%rax", above + 8);
+    } else {
+      asm_emit(ctx, "movq %ld(%%rsp), %%rax", ctx->frame_size + above);
+    }
+    store_local(ctx, sym);
   }
 
   ArrayList* nodes = fd.block->blockStmt.nodes;
@@ -403,13 +2282,23 @@ void gen_func_decl(asm_ctx* ctx, Node* node) {
 
   asm_raw(ctx, "%s:", ctx->epilogue_label);
   ctx->emitter->indent = 4;
-  asm_emit(ctx, "movq %%rbp, %%rsp");
-  asm_emit(ctx, "popq %%rbp");
+  if (ctx->uses_ymm) { asm_emit(ctx, "vzeroupper"); }
+  emit_frame_teardown(ctx);
   asm_emit(ctx, "ret");
+  if (ctx->trap_label) {
+    asm_raw(ctx, "%s:", ctx->trap_label);
+    asm_emit(ctx, "ud2");
+  }
+  asm_emit(ctx, ".cfi_endproc");
 
   pop_scope(ctx);
   free((void*)ctx->epilogue_label);
+  free((void*)ctx->entry_label);
+  free((void*)ctx->trap_label);
   ctx->epilogue_label = NULL;
+  ctx->entry_label = NULL;
+  ctx->trap_label = NULL;
+  ctx->cur_func = NULL;
 }
 
 static void gen_global(asm_ctx* ctx, Node* node) {
@@ -417,8 +2306,31 @@ static void gen_global(asm_ctx* ctx, Node* node) {
   const char* name = vd.ident->identifierExpr.name;
   var_t type = vd.type->variable_t;
   define_global(ctx, name, type);
+  if (type.is_array || is_vector(&type)) {
+    if (type.is_array && is_vector(&type)) { std_compile_error("arrays of vectors are not supported"); }
+    if (vd.assign) { std_compile_error("arrays and vectors can not be initialized"); }
+    ctx->emitter->indent = 0;
+    asm_emit(ctx, ".balign %u", elem_size(&type));
+    asm_raw(ctx, "%s:", name);
+    ctx->emitter->indent = 4;
+    asm_emit(ctx, ".zero %u", type_size(&type));
+    ctx->emitter->indent = 0;
+    return;
+  }
   unsigned int sz = type_size(&type);
   long long val = 0;
+  if (vd.assign && vd.assign->type == AST_LITERAL && vd.assign->literalExpr.str_value) {
+    if (sz != 8) { std_compile_error("a string can only initialize an address"); }
+    char label[32];
+    string_label(vd.assign->literalExpr.str_value, label, sizeof(label));
+    ctx->emitter->indent = 0;
+    asm_emit(ctx, ".balign 8");
+    asm_raw(ctx, "%s:", name);
+    ctx->emitter->indent = 4;
+    asm_emit(ctx, ".quad %s", label);
+    ctx->emitter->indent = 0;
+    return;
+  }
   if (vd.assign && vd.assign->type == AST_LITERAL) {
     val = vd.assign->literalExpr.num_value;
   }
@@ -436,6 +2348,291 @@ static void gen_global(asm_ctx* ctx, Node* node) {
   ctx->emitter->indent = 0;
 }
 
+static void collect_strings(Node* node, ArrayList* out);
+
+static void collect_strings_list(ArrayList* nodes, ArrayList* out) {
+  if (!nodes) { return; }
+  for (int i = 0; i < nodes->length; i++) {
+    collect_strings((Node*)get_list(nodes, i), out);
+  }
+}
+
+/// every string literal of a subtree, in source order
+static void collect_strings(Node* node, ArrayList* out) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_LITERAL:
+      if (node->literalExpr.str_value) { add_list(out, (void*)node->literalExpr.str_value); }
+      break;
+    case AST_FUNC_DECL: collect_strings(node->funcDecl.block, out); break;
+    case AST_BLOCK:     collect_strings_list(node->blockStmt.nodes, out); break;
+    case AST_VAR_DECL:  collect_strings(node->varDecl.assign, out); break;
+    case AST_IF:
+      collect_strings(node->ifStmt.cond, out);
+      collect_strings(node->ifStmt.then_branch, out);
+      collect_strings(node->ifStmt.else_branch, out);
+      break;
+    case AST_WHILE:
+      collect_strings(node->whileStmt.cond, out);
+      collect_strings(node->whileStmt.body, out);
+      collect_strings(node->whileStmt.step, out);
+      break;
+    case AST_RETURN:    collect_strings(node->returnStmt.return_val, out); break;
+    case AST_UNARY:     collect_strings(node->unaryExpr.expr, out); break;
+    case AST_BINARY:
+      collect_strings(node->binaryExpr.expr_left, out);
+      collect_strings(node->binaryExpr.expr_right, out);
+      break;
+    case AST_ASSIGN:
+      collect_strings(node->assignExpr.target, out);
+      collect_strings(node->assignExpr.val, out);
+      break;
+    case AST_CAST:      collect_strings(node->castExpr.inner, out); break;
+    case AST_INDEX:
+      collect_strings(node->arrayIndex.target, out);
+      collect_strings(node->arrayIndex.index, out);
+      break;
+    case AST_CALL:      collect_strings_list(node->callExpr.args, out); break;
+    case AST_ARRAY_LIT: collect_strings_list(node->arrayLit.elements, out); break;
+    default: break;
+  }
+}
+
+/// a string as a .string operand. literals have no escape sequences, so
+/// every byte is written back exactly
+static char* quote_string(const char* str) {
+  char* buf = malloc(4 * strlen(str) + 1);
+  char* w = buf;
+  for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      *w++ = '\\';
+      *w++ = (char)*p;
+    } else if (*p < 0x20 || *p >= 0x7f) {
+      w += sprintf(w, "\\%03o", *p);
+    } else {
+      *w++ = (char)*p;
+    }
+  }
+  *w = '\0';
+  return buf;
+}
+
+/// emits each distinct string literal once, into a section the linker
+/// merges across object files as well
+static void gen_string_pool(asm_ctx* ctx, Node* program) {
+  ArrayList* strs = init_list(16);
+  collect_strings_list(program->programDecl.nodes, strs);
+  if (strs->length == 0) {
+    free(strs->items);
+    free(strs);
+    return;
+  }
+  hashtable_t* seen = create_ht(64);
+  ctx->emitter->indent = 0;
+  asm_emit(ctx, ".section .rodata.str1.1,\"aMS\",@progbits,1");
+  for (int i = 0; i < strs->length; i++) {
+    const char* str = (const char*)get_list(strs, i);
+    char label[32];
+    string_label(str, label, sizeof(label));
+    const char* first = (const char*)get_ht(seen, label);
+    if (first) {
+      if (strcmp(first, str) != 0) { std_compile_error("string literal hash collision"); }
+      continue;
+    }
+    add_ht(seen, label, strdup(str));
+    char* quoted = quote_string(str);
+    asm_raw(ctx, "%s:", label);
+    ctx->emitter->indent = 4;
+    asm_emit(ctx, ".string \"%s\"", quoted);
+    ctx->emitter->indent = 0;
+    free(quoted);
+  }
+  destroy_ht(seen);
+  free(strs->items);
+  free(strs);
+}
+
+typedef struct {
+  asm_ctx* parent;
+  Node* func;
+  char* buf;   ///< the function's assembly, filled in by the worker
+  size_t len;
+  bool reused; ///< buf came from the fragment cache, nothing to generate
+} func_job;
+
+/// a context that shares the parent's global scope and options but owns all
+/// of the per-function state, writing to its own stream
+static asm_ctx* mk_func_ctx(asm_ctx* parent, FILE* out) {
+  asm_ctx* ctx = asm_init_file(out);
+  ctx->opts = parent->opts;
+  push_stack(ctx->scope_stk, peek_stack(parent->scope_stk));
+  return ctx;
+}
+
+static void free_func_ctx(asm_ctx* ctx) {
+  // the global scope belongs to the parent
+  pop_stack(ctx->scope_stk);
+  asm_free_keep_file(ctx);
+}
+
+static void gen_func_job(void* arg) {
+  func_job* job = (func_job*)arg;
+  FILE* out = open_memstream(&job->buf, &job->len);
+  asm_ctx* ctx = mk_func_ctx(job->parent, out);
+  gen_func_decl(ctx, job->func);
+  __atomic_fetch_add(&job->parent->loops_vectorized, ctx->loops_vectorized, __ATOMIC_RELAXED);
+  free_func_ctx(ctx);
+  fclose(out);
+}
+
+/// generates every job that was not reused, on a thread pool when there is
+/// more than one worker
+static void run_func_jobs(func_job* work, int count, unsigned int jobs) {
+  if (jobs <= 1) {
+    for (int i = 0; i < count; i++) {
+      if (!work[i].reused) { gen_func_job(&work[i]); }
+    }
+    return;
+  }
+  threadpool_t* pool = pool_create(jobs);
+  for (int i = 0; i < count; i++) {
+    if (!work[i].reused) { pool_submit(pool, gen_func_job, &work[i]); }
+  }
+  pool_destroy(pool);
+}
+
+/// writes the results out in source order so the output does not depend on
+/// scheduling
+static void write_func_jobs(asm_ctx* ctx, func_job* work, int count) {
+  for (int i = 0; i < count; i++) {
+    fwrite(work[i].buf, 1, work[i].len, ctx->emitter->file);
+    free(work[i].buf);
+  }
+}
+
+static void gen_funcs_parallel(asm_ctx* ctx, ArrayList* funcs, unsigned int jobs) {
+  func_job* work = calloc(funcs->length, sizeof(func_job));
+  for (int i = 0; i < funcs->length; i++) {
+    work[i].parent = ctx;
+    work[i].func = (Node*)get_list(funcs, i);
+  }
+  run_func_jobs(work, funcs->length, jobs);
+  write_func_jobs(ctx, work, funcs->length);
+  free(work);
+}
+
+/// mixes in what a function's code depends on beyond its own body: the types
+/// of the globals it names and the signatures of the functions it calls
+static uint64_t hash_deps(asm_ctx* ctx, hashtable_t* sigs, Node* node, uint64_t h);
+
+static uint64_t hash_deps_list(asm_ctx* ctx, hashtable_t* sigs, ArrayList* nodes, uint64_t h) {
+  for (int i = 0; i < nodes->length; i++) {
+    h = hash_deps(ctx, sigs, (Node*)get_list(nodes, i), h);
+  }
+  return h;
+}
+
+static uint64_t hash_deps(asm_ctx* ctx, hashtable_t* sigs, Node* node, uint64_t h) {
+  if (!node) { return h; }
+  switch (node->type) {
+    case AST_IDENTIFIER: {
+      // only globals are in scope here; a local of the same name just costs
+      // an extra dependency
+      symbol_t* sym = find_symbol(ctx, node->identifierExpr.name);
+      if (sym) {
+        h = cache_hash(h, sym->name, strlen(sym->name) + 1);
+        // field by field: padding, and whichever of type_adr and type is
+        // unused, would make the key unstable
+        var_t t = sym->type;
+        const long long type[] = {
+          t.is_adr, t.is_array, t.array_len, t.is_adr ? (long long)t.type_adr : (long long)t.type,
+        };
+        h = cache_hash(h, type, sizeof(type));
+      }
+      return h;
+    }
+    case AST_CALL: {
+      Node** callee = (Node**)get_ht(sigs, node->callExpr.callee->identifierExpr.name);
+      if (callee) { h = hash_node(h, (*callee)->funcDecl.type); }
+      return hash_deps_list(ctx, sigs, node->callExpr.args, h);
+    }
+    case AST_BLOCK:    return hash_deps_list(ctx, sigs, node->blockStmt.nodes, h);
+    case AST_VAR_DECL: return hash_deps(ctx, sigs, node->varDecl.assign, h);
+    case AST_IF:
+      h = hash_deps(ctx, sigs, node->ifStmt.cond, h);
+      h = hash_deps(ctx, sigs, node->ifStmt.then_branch, h);
+      return hash_deps(ctx, sigs, node->ifStmt.else_branch, h);
+    case AST_WHILE:
+      h = hash_deps(ctx, sigs, node->whileStmt.cond, h);
+      h = hash_deps(ctx, sigs, node->whileStmt.body, h);
+      return hash_deps(ctx, sigs, node->whileStmt.step, h);
+    case AST_RETURN:   return hash_deps(ctx, sigs, node->returnStmt.return_val, h);
+    case AST_UNARY:    return hash_deps(ctx, sigs, node->unaryExpr.expr, h);
+    case AST_BINARY:
+      h = hash_deps(ctx, sigs, node->binaryExpr.expr_left, h);
+      return hash_deps(ctx, sigs, node->binaryExpr.expr_right, h);
+    case AST_ASSIGN:
+      h = hash_deps(ctx, sigs, node->assignExpr.target, h);
+      return hash_deps(ctx, sigs, node->assignExpr.val, h);
+    case AST_CAST:     return hash_deps(ctx, sigs, node->castExpr.inner, h);
+    case AST_INDEX:
+      h = hash_deps(ctx, sigs, node->arrayIndex.target, h);
+      return hash_deps(ctx, sigs, node->arrayIndex.index, h);
+    case AST_ARRAY_LIT: return hash_deps_list(ctx, sigs, node->arrayLit.elements, h);
+    default:           return h;
+  }
+}
+
+/// the key a function's assembly is cached under. the body is hashed after
+/// inlining and dead code elimination, so a change to an inlined callee
+/// changes the key of every function it was inlined into
+static uint64_t func_fingerprint(asm_ctx* ctx, hashtable_t* sigs, Node* func) {
+  uint64_t h = ctx->opts.fragment_salt;
+  const unsigned long long fields[] = {
+    ctx->opts.omit_frame_pointer, ctx->opts.optimize_sibling_calls, ctx->opts.whole_program,
+    ctx->opts.bounds_check, ctx->opts.vectorize, ctx->opts.isa,
+  };
+  h = cache_hash(h, fields, sizeof(fields));
+  h = hash_node(h, func);
+  return hash_deps(ctx, sigs, func->funcDecl.block, h);
+}
+
+/// splices functions whose fingerprint is in the fragment cache into the
+/// output and generates only the rest, storing them for the next run
+static void gen_funcs_incremental(asm_ctx* ctx, ArrayList* funcs, unsigned int jobs) {
+  compile_cache* cache = ctx->opts.fragments;
+  hashtable_t* sigs = create_ht(funcs->length * 2 + 1);
+  for (int i = 0; i < funcs->length; i++) {
+    Node* f = (Node*)get_list(funcs, i);
+    Node** box = malloc(sizeof(Node*));
+    *box = f;
+    add_ht(sigs, f->funcDecl.type->function_t.ident->identifierExpr.name, box);
+  }
+  func_job* work = calloc(funcs->length, sizeof(func_job));
+  uint64_t* keys = malloc(sizeof(uint64_t) * (funcs->length + 1));
+  unsigned int missing = 0;
+  for (int i = 0; i < funcs->length; i++) {
+    work[i].parent = ctx;
+    work[i].func = (Node*)get_list(funcs, i);
+    keys[i] = func_fingerprint(ctx, sigs, work[i].func);
+    work[i].reused = cache_fetch_data(cache, keys[i], "fn", &work[i].buf, &work[i].len);
+    if (work[i].reused) {
+      ctx->funcs_reused++;
+    } else {
+      missing++;
+    }
+  }
+  destroy_ht(sigs);
+  run_func_jobs(work, funcs->length, jobs < missing ? jobs : missing);
+  for (int i = 0; i < funcs->length; i++) {
+    if (!work[i].reused) { cache_store_data(cache, keys[i], "fn", work[i].buf, work[i].len); }
+  }
+  if (missing > 0) { cache_evict(cache); }
+  write_func_jobs(ctx, work, funcs->length);
+  free(keys);
+  free(work);
+}
+
 void gen_program(asm_ctx* ctx, Node* program) {
   push_scope(ctx);
   ArrayList* nodes = program->programDecl.nodes;
@@ -452,23 +2649,100 @@ void gen_program(asm_ctx* ctx, Node* program) {
       if (n->type == AST_VAR_DECL) { gen_global(ctx, n); }
     }
   }
+  gen_string_pool(ctx, program);
   ctx->emitter->indent = 0;
   asm_emit(ctx, ".text");
+  ArrayList* funcs = init_list(64);
   for (int i = 0; i < nodes->length; i++) {
     Node* n = (Node*)get_list(nodes, i);
-    if (n->type == AST_FUNC_DECL) { gen_func_decl(ctx, n); }
+    if (n->type == AST_FUNC_DECL) { add_list(funcs, n); }
   }
+  unsigned int jobs = ctx->opts.jobs ? ctx->opts.jobs : online_cpus();
+  if (jobs > funcs->length) { jobs = funcs->length; }
+  if (ctx->opts.fragments) {
+    gen_funcs_incremental(ctx, funcs, jobs);
+  } else if (jobs > 1) {
+    gen_funcs_parallel(ctx, funcs, jobs);
+  } else {
+    for (int i = 0; i < funcs->length; i++) {
+      gen_func_decl(ctx, (Node*)get_list(funcs, i));
+    }
+  }
+  free(funcs->items);
+  free(funcs);
   pop_scope(ctx);
 }
 
+void dump_asm_json(FILE* out, FILE* text) {
+  char* line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  char* symbol = NULL;
+  while ((len = getline(&line, &cap, text)) > 0) {
+    if (line[len - 1] == '\n') { line[--len] = '\0'; }
+    char* start = line;
+    while (*start == ' ') { start++; }
+    if (*start == '\0') { continue; }
+    const char* kind = "insn";
+    size_t n = strlen(start);
+    if (start[n - 1] == ':') {
+      kind = "label";
+      // local labels are .L<func>.<n>, anything else starts a new symbol
+      if (start[0] != '.') {
+        free(symbol);
+        symbol = strndup(start, n - 1);
+      }
+    } else if (start[0] == '.') {
+      kind = "directive";
+      if (strcmp(start, ".text") == 0 || strcmp(start, ".data") == 0 ||
+          strncmp(start, ".section", 8) == 0) {
+        free(symbol);
+        symbol = NULL;
+      }
+    }
+    fputs("{\"symbol\":", out);
+    json_write_str(out, symbol);
+    fprintf(out, ",\"kind\":\"%s\",\"text\":", kind);
+    json_write_str(out, start);
+    fputs("}\n", out);
+  }
+  free(symbol);
+  free(line);
+}
+
+asm_opts asm_default_opts(unsigned int opt_level) {
+  asm_opts opts;
+  opts.opt_level = opt_level;
+  opts.omit_frame_pointer = opt_level >= 1;
+  opts.optimize_sibling_calls = opt_level >= 2;
+  opts.whole_program = false;
+  opts.bounds_check = false;
+  opts.vectorize = opt_level >= 2;
+  opts.isa = ISA_SSE2;
+  opts.jobs = 1;
+  opts.fragments = NULL;
+  opts.fragment_salt = CACHE_HASH_INIT;
+  return opts;
+}
+
 asm_ctx* asm_init(const char* output_file) {
   asm_ctx* ctx = malloc(sizeof(asm_ctx));
   ctx->emitter = emitter_init(output_file);
   ctx->scope_stk = init_stack();
   ctx->cur_offset = 0;
   ctx->label_count = 0;
+  ctx->label_prefix = "";
   ctx->push_depth = 0;
   ctx->epilogue_label = NULL;
+  ctx->entry_label = NULL;
+  ctx->cur_func = NULL;
+  ctx->opts = asm_default_opts(0);
+  ctx->use_rbp = true;
+  ctx->frame_size = 0;
+  ctx->funcs_reused = 0;
+  ctx->trap_label = NULL;
+  ctx->proven = init_list(8);
+  ctx->loops_vectorized = 0;
   return ctx;
 }
 
@@ -478,8 +2752,18 @@ asm_ctx* asm_init_file(FILE* file) {
   ctx->scope_stk = init_stack();
   ctx->cur_offset = 0;
   ctx->label_count = 0;
+  ctx->label_prefix = "";
   ctx->push_depth = 0;
   ctx->epilogue_label = NULL;
+  ctx->entry_label = NULL;
+  ctx->cur_func = NULL;
+  ctx->opts = asm_default_opts(0);
+  ctx->use_rbp = true;
+  ctx->frame_size = 0;
+  ctx->funcs_reused = 0;
+  ctx->trap_label = NULL;
+  ctx->proven = init_list(8);
+  ctx->loops_vectorized = 0;
   return ctx;
 }
 
@@ -490,6 +2774,9 @@ static void drain_scopes(asm_ctx* ctx) {
     free(s);
   }
   delete_stack(ctx->scope_stk);
+  // the nodes belong to the AST
+  free(ctx->proven->items);
+  free(ctx->proven);
 }
 
 void asm_free(asm_ctx* ctx) {
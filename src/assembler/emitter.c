@@ -5,16 +5,17 @@
 #include <stdlib.h>
 #include "assembler/emitter.h"
 #include "parser/parser.h"
+#include "utils/stats.h"
 
 emitter* emitter_init(const char* file_name) {
-  emitter* emitter = malloc(sizeof(emitter));
+  emitter* emitter = malloc(sizeof(*emitter));
   emitter->file = fopen(file_name, "w");
   emitter->indent = 0;
   return emitter;
 }
 
 emitter* emitter_init2(FILE* file) {
-  emitter* emitter = malloc(sizeof(emitter));
+  emitter* emitter = malloc(sizeof(*emitter));
   emitter->file = file;
   emitter->indent = 0;
   return emitter;
@@ -41,6 +42,15 @@ operand_t* mk_mem(regid id, regsize size, long disp) {
   return mem;
 }
 
+operand_t* mk_mem_index(regid base, regid index, unsigned int scale, regsize size, long disp) {
+  assert(scale == 1 || scale == 2 || scale == 4 || scale == 8);
+  operand_t* mem = mk_mem(base, size, disp);
+  mem->op.mem.has_index = true;
+  mem->op.mem.index = index;
+  mem->op.mem.scale = scale;
+  return mem;
+}
+
 operand_t* mk_label(const char* label) {
   operand_t* l = malloc(sizeof(operand_t));
   *l = (operand_t){ .kind = OP_LABEL, .op.label = label };
@@ -50,6 +60,8 @@ operand_t* mk_label(const char* label) {
 void emit_print(emitter* emitter, const char* fmt, ...) {
   va_list args;
   va_start(args, fmt);
+  // directives and labels are not instructions
+  if (fmt[0] != '.' && strcmp(fmt, "%s:") != 0) { stat_add(STAT_INSNS, 1); }
   char buf[256];
   unsigned int buf_idx = 0;
   if (emitter->indent > 0) {
@@ -103,38 +115,54 @@ void emit_globl(emitter* emitter, const char* name) {
   emit_print(emitter, ".globl %s", name);
 }
 
-static const char* reg_to_str(regsize size, regid id) {
+const char* reg_to_str(regsize size, regid id) {
+  if (id >= REG_XMM0 && id <= REG_XMM15) {
+    static const char* const xmm[] = {
+      "%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7",
+      "%xmm8", "%xmm9", "%xmm10", "%xmm11", "%xmm12", "%xmm13", "%xmm14", "%xmm15",
+    };
+    static const char* const ymm[] = {
+      "%ymm0", "%ymm1", "%ymm2", "%ymm3", "%ymm4", "%ymm5", "%ymm6", "%ymm7",
+      "%ymm8", "%ymm9", "%ymm10", "%ymm11", "%ymm12", "%ymm13", "%ymm14", "%ymm15",
+    };
+    if (size == SZ_128) { return xmm[id - REG_XMM0]; }
+    if (size == SZ_256) { return ymm[id - REG_XMM0]; }
+  }
   switch(id) {
     case REG_RAX:
       switch(size) {
-        case SZ_8:  return "%ah";
+        case SZ_8:  return "%al";
         case SZ_16: return "%ax";
         case SZ_32: return "%eax";
         case SZ_64: return "%rax";
+        default:    break; // vector sizes name no general purpose register
       }
       break;
     case REG_RBX:
       switch(size) {
-        case SZ_8:  return "%bh";
+        case SZ_8:  return "%bl";
         case SZ_16: return "%bx";
         case SZ_32: return "%ebx";
         case SZ_64: return "%rbx";
+        default:    break;
       }
       break;
     case REG_RCX:
       switch(size) {
-        case SZ_8:  return "%ch";
+        case SZ_8:  return "%cl";
         case SZ_16: return "%cx";
         case SZ_32: return "%ecx";
         case SZ_64: return "%rcx";
+        default:    break;
       }
       break;
     case REG_RDX:
       switch(size) {
-        case SZ_8:  return "%dh";
+        case SZ_8:  return "%dl";
         case SZ_16: return "%dx";
         case SZ_32: return "%edx";
         case SZ_64: return "%rdx";
+        default:    break;
       }
       break;
     case REG_RSI:
@@ -143,6 +171,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%si";
         case SZ_32: return "%esi";
         case SZ_64: return "%rsi";
+        default:    break;
       }
       break;
     case REG_RDI:
@@ -151,6 +180,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%di";
         case SZ_32: return "%edi";
         case SZ_64: return "%rdi";
+        default:    break;
       }
       break;
     case REG_RBP:
@@ -159,6 +189,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%bp";
         case SZ_32: return "%ebp";
         case SZ_64: return "%rbp";
+        default:    break;
       }
       break;
     case REG_RSP:
@@ -167,6 +198,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%sp";
         case SZ_32: return "%esp";
         case SZ_64: return "%rsp";
+        default:    break;
       }
       break;
     case REG_R8:
@@ -175,6 +207,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r8w";
         case SZ_32: return "%r8d";
         case SZ_64: return "%r8";
+        default:    break;
       }
       break;
     case REG_R9:
@@ -183,6 +216,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r9w";
         case SZ_32: return "%r9d";
         case SZ_64: return "%r9";
+        default:    break;
       }
       break;
     case REG_R10:
@@ -191,6 +225,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r10w";
         case SZ_32: return "%r10d";
         case SZ_64: return "%r10";
+        default:    break;
       }
       break;
     case REG_R11:
@@ -199,6 +234,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r11w";
         case SZ_32: return "%r11d";
         case SZ_64: return "%r11";
+        default:    break;
       }
       break;
     case REG_R12:
@@ -207,6 +243,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r12w";
         case SZ_32: return "%r12d";
         case SZ_64: return "%r12";
+        default:    break;
       }
       break;
     case REG_R13:
@@ -215,6 +252,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r13w";
         case SZ_32: return "%r13d";
         case SZ_64: return "%r13";
+        default:    break;
       }
       break;
     case REG_R14:
@@ -223,6 +261,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r14w";
         case SZ_32: return "%r14d";
         case SZ_64: return "%r14";
+        default:    break;
       }
       break;
     case REG_R15:
@@ -231,6 +270,7 @@ static const char* reg_to_str(regsize size, regid id) {
         case SZ_16: return "%r15w";
         case SZ_32: return "%r15d";
         case SZ_64: return "%r15";
+        default:    break;
       }
       break;
     default:
@@ -253,9 +293,15 @@ static void operand_to_str(char buf[32], operand_t* op) {
       break;
     case OP_MEM:
       mem_t mem = op->op.mem;
-      reg_t reg_base = mem.base;
-      const char* reg_str = reg_to_str(reg_base.size, reg_base.id);
-      sprintf(buf, "%ld(%s)", mem.disp, reg_str);
+      // the size only describes the access width, addresses are always 64 bit
+      const char* reg_str = reg_to_str(SZ_64, mem.base.id);
+      if (!mem.has_index) {
+        sprintf(buf, "%ld(%s)", mem.disp, reg_str);
+      } else if (mem.disp == 0) {
+        sprintf(buf, "(%s,%s,%u)", reg_str, reg_to_str(SZ_64, mem.index), mem.scale);
+      } else {
+        sprintf(buf, "%ld(%s,%s,%u)", mem.disp, reg_str, reg_to_str(SZ_64, mem.index), mem.scale);
+      }
       break;
     case OP_LABEL:
       const char* label = op->op.label;
@@ -308,6 +354,35 @@ void emit_mov(emitter* emitter, operand_t* src, operand_t* dest) {
   emit_print(emitter, "mov%s %s, %s", size, src_str, dest_str);
 }
 
+void emit_vmov(emitter* emitter, operand_t* src, operand_t* dest, bool aligned, bool vex) {
+  assert(get_reg_size(src, dest) >= SZ_128);
+  char src_str[32];
+  operand_to_str(src_str, src);
+  char dest_str[32];
+  operand_to_str(dest_str, dest);
+  vex |= get_reg_size(src, dest) == SZ_256;
+  emit_print(emitter, "%smovdq%s %s, %s", vex ? "v" : "", aligned ? "a" : "u", src_str, dest_str);
+}
+
+static void emit_extend(emitter* emitter, const char* kind, operand_t* src, operand_t* dest) {
+  char src_str[32];
+  operand_to_str(src_str, src);
+  char dest_str[32];
+  operand_to_str(dest_str, dest);
+  const char* from = reg_size_to_str(get_reg_size(src, NULL));
+  const char* to = reg_size_to_str(get_reg_size(NULL, dest));
+  emit_print(emitter, "mov%s%s%s %s, %s", kind, from, to, src_str, dest_str);
+}
+
+void emit_movzx(emitter* emitter, operand_t* src, operand_t* dest) {
+  assert(get_reg_size(src, NULL) != SZ_32);
+  emit_extend(emitter, "z", src, dest);
+}
+
+void emit_movsx(emitter* emitter, operand_t* src, operand_t* dest) {
+  emit_extend(emitter, "s", src, dest);
+}
+
 void emit_push(emitter* emitter, operand_t* op) {
   char op_str[32];
   operand_to_str(op_str, op);
@@ -371,6 +446,47 @@ void emit_idiv(emitter* emitter, operand_t* divisor, operand_t* dividend) {
   emit_print(emitter, "idiv%s %s", size, div_str);
 }
 
+/// emits a two operand instruction sized by its destination
+static void emit_sized_op(emitter* emitter, const char* instr, operand_t* src, operand_t* dest) {
+  char src_str[32];
+  operand_to_str(src_str, src);
+  char dest_str[32];
+  operand_to_str(dest_str, dest);
+  const char* size = reg_size_to_str(get_reg_size(NULL, dest));
+  emit_print(emitter, "%s%s %s, %s", instr, size, src_str, dest_str);
+}
+
+void emit_and(emitter* emitter, operand_t* src, operand_t* dest) {
+  emit_sized_op(emitter, "and", src, dest);
+}
+
+void emit_or(emitter* emitter, operand_t* src, operand_t* dest) {
+  emit_sized_op(emitter, "or", src, dest);
+}
+
+void emit_xor(emitter* emitter, operand_t* src, operand_t* dest) {
+  emit_sized_op(emitter, "xor", src, dest);
+}
+
+void emit_not(emitter* emitter, operand_t* op) {
+  char op_str[32];
+  operand_to_str(op_str, op);
+  const char* size = reg_size_to_str(get_reg_size(op, NULL));
+  emit_print(emitter, "not%s %s", size, op_str);
+}
+
+void emit_shl(emitter* emitter, operand_t* count, operand_t* dest) {
+  emit_sized_op(emitter, "shl", count, dest);
+}
+
+void emit_sar(emitter* emitter, operand_t* count, operand_t* dest) {
+  emit_sized_op(emitter, "sar", count, dest);
+}
+
+void emit_shr(emitter* emitter, operand_t* count, operand_t* dest) {
+  emit_sized_op(emitter, "shr", count, dest);
+}
+
 void emit_cmp(emitter* emitter, operand_t* src, operand_t* dest) {
   char src_str[32];
   operand_to_str(src_str, src);
@@ -1,15 +1,28 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
 #include "tokenizer/tokenizer.h"
 #include "tokenizer/tokens.h"
 #include "utils/arraylist.h"
 #include "utils/hashtable.h"
 #include "parser/parser.h"
 #include "assembler/assembler.h"
+#include "optimizer/inliner.h"
+#include "optimizer/dce.h"
+#include "optimizer/licm.h"
+#include "utils/threadpool.h"
+#include "utils/cache.h"
+#include "utils/stats.h"
+#include "utils/json.h"
+
+/// default -fcache-size, in bytes
+#define CACHE_DEFAULT_SIZE (256ULL << 20)
 
 unsigned long getFileCharCount(FILE* file) {
   char c;
@@ -24,44 +37,291 @@ unsigned long getFileCharCount(FILE* file) {
 typedef enum {
   MODE_EXECUTABLE,
   MODE_ASM_ONLY,
+  MODE_OBJECT,
 } compile_mode_t;
 
+/// which per-phase reports the driver prints on stderr
+typedef struct {
+  bool time; ///< -ftime-report: wall time and throughput
+  bool mem;  ///< -fmem-report: allocations and peak memory
+  bool json; ///< one JSON object per phase instead of a table
+} report_opts;
+
+/// what the driver writes besides the compiled output
+typedef struct {
+  unsigned int verbosity; ///< 0 quiet, 1 (-v) progress notes, 2 (-vv) tokens and AST as text too
+  bool tokens;   ///< --dump-tokens: <input>.tokens.jsonl
+  bool ast;      ///< --dump-ast: <input>.ast.jsonl, as parsed
+  bool asm_text; ///< --dump-asm: <input>.asm.jsonl
+} trace_opts;
+
+/// every option the passes read, resolved from the -O level and -f flags
+typedef struct {
+  asm_opts codegen;
+  inline_opts inliner;
+  dce_opts dce;
+  licm_opts licm;
+  bool lazy_parsing; ///< only parse functions reachable from the exported ones
+  bool incremental;  ///< reuse the assembly of unchanged functions from the cache
+  report_opts report;
+  trace_opts trace;
+} compile_opts_t;
+
+/// boolean -f<name> / -fno-<name> switches that map onto compile_opts_t fields
+typedef struct {
+  const char* name;
+  size_t offset;
+} flag_t;
+
+static const flag_t f_flags[] = {
+  { "omit-frame-pointer",     offsetof(compile_opts_t, codegen.omit_frame_pointer) },
+  { "optimize-sibling-calls", offsetof(compile_opts_t, codegen.optimize_sibling_calls) },
+  { "inline-functions",       offsetof(compile_opts_t, inliner.enabled) },
+  { "dce",                    offsetof(compile_opts_t, dce.enabled) },
+  { "whole-program",          offsetof(compile_opts_t, dce.whole_program) },
+  { "move-loop-invariants",   offsetof(compile_opts_t, licm.enabled) },
+  { "bounds-check",           offsetof(compile_opts_t, codegen.bounds_check) },
+  { "vectorize",              offsetof(compile_opts_t, codegen.vectorize) },
+  { "lazy-parsing",           offsetof(compile_opts_t, lazy_parsing) },
+  { "incremental",            offsetof(compile_opts_t, incremental) },
+  { "time-report",            offsetof(compile_opts_t, report.time) },
+  { "mem-report",             offsetof(compile_opts_t, report.mem) },
+};
+
+#define F_FLAG_COUNT (sizeof(f_flags) / sizeof(f_flags[0]))
+
 typedef struct {
   compile_mode_t mode;
-  const char* input;
+  ArrayList* inputs; ///< source paths, not owned
   const char* output;
+  unsigned int jobs; ///< files compiled at once
+  unsigned int opt_level;
+  target_isa isa;                ///< from -march
+  int f_overrides[F_FLAG_COUNT]; ///< -1 when left to the -O level
+  int inline_limit;              ///< -1 when left to the -O level
+  int parallel_jobs;             ///< -1 for one codegen thread per cpu
+  bool inline_report;
+  const char* cache_dir;         ///< NULL when caching is off
+  unsigned long long cache_size; ///< cap on the cache directory, in bytes
+  bool cache_stats;
+  bool report_json;
+  trace_opts trace;
 } cli_args_t;
 
 static void usage(const char* prog) {
   fprintf(stderr,
-    "usage: %s [-S] [-o <output>] <file.av>\n"
-    "  default: assemble and link to an executable (a.out)\n"
+    "usage: %s [-S | -c] [-j <n>] [-v | -vv] [--dump-<what>] [-O<level>] [-march=<arch>] [-f[no-]<flag>] [-o <output>] <file.av>...\n"
+    "  default: assemble and link every file into one executable (a.out)\n"
     "  -S:      stop after emitting assembly (.s)\n"
-    "  -o:      override output path\n",
+    "  -c:      stop after assembling object files (.o)\n"
+    "  -j <n>:  compile up to n files at once (default 1)\n"
+    "  -o:      override output path (one input only with -S or -c)\n"
+    "  -v:      print progress notes, -vv also prints tokens and the AST as text\n"
+    "  --dump-tokens:  write the tokens to <file>.tokens.jsonl, one JSON object per line\n"
+    "  --dump-ast:     write the parsed AST to <file>.ast.jsonl, one line per declaration\n"
+    "  --dump-asm:     write the assembly to <file>.asm.jsonl, one line per line of text\n"
+    "  -O<n>:   optimization level 0 - 3 (default 0)\n"
+    "  -fomit-frame-pointer:     address locals off %%rsp (default at -O1 and up)\n"
+    "  -foptimize-sibling-calls: turn tail calls into jumps (default at -O2 and up)\n"
+    "  -finline-functions:       inline small functions (default at -O2 and up)\n"
+    "  -finline-limit=<n>:       largest function body, in AST nodes, to inline\n"
+    "  -finline-report:          list every inlining decision on stderr\n"
+    "  -fdce:                    remove dead and unreachable code (default at -O1 and up)\n"
+    "  -fwhole-program:          only export main and drop functions it never reaches\n"
+    "  -fmove-loop-invariants:   compute loop invariant expressions once before the loop (default at -O1 and up)\n"
+    "  -fbounds-check:           trap on array indexes outside the declared length\n"
+    "  -fvectorize:              run element-wise array loops a vector at a time (default at -O2 and up)\n"
+    "  -march=<arch>:            x86-64 (SSE2, default), x86-64-v2 (SSE4.2) or x86-64-v3 (AVX2)\n"
+    "  -fparallel-jobs=<n>:      parse and generate functions on n threads (default one per cpu)\n"
+    "  -flazy-parsing:           skip bodies of functions the exported ones never call\n"
+    "  -fcache-dir=<dir>:        reuse outputs of identical earlier compiles kept in dir\n"
+    "  -fcache-size=<n>[KMG]:    evict least recently used cache entries past n bytes (default 256M)\n"
+    "  -fcache-stats:            print cache hits, misses and evictions on stderr\n"
+    "  -fincremental:            only regenerate functions that changed since they were cached\n"
+    "  -ftime-report:            print wall time and throughput of every phase on stderr\n"
+    "  -fmem-report:             print allocations and peak memory of every phase on stderr\n"
+    "  -freport-format=<fmt>:    text (default) or json, one object per phase\n",
     prog);
 }
 
+static int parse_f_flag(const char* arg, cli_args_t* out) {
+  if (strncmp(arg, "inline-limit=", 13) == 0) {
+    char* end;
+    long limit = strtol(arg + 13, &end, 10);
+    if (*end != '\0' || limit < 0) return -1;
+    out->inline_limit = (int)limit;
+    return 0;
+  }
+  if (strncmp(arg, "parallel-jobs=", 14) == 0) {
+    char* end;
+    long jobs = strtol(arg + 14, &end, 10);
+    if (*end != '\0' || jobs < 1) return -1;
+    out->parallel_jobs = (int)jobs;
+    return 0;
+  }
+  if (strncmp(arg, "cache-dir=", 10) == 0) {
+    if (arg[10] == '\0') return -1;
+    out->cache_dir = arg + 10;
+    return 0;
+  }
+  if (strncmp(arg, "cache-size=", 11) == 0) {
+    char* end;
+    unsigned long long size = strtoull(arg + 11, &end, 10);
+    if (end == arg + 11) return -1;
+    switch (*end) {
+      case 'G': size <<= 10; /* fall through */
+      case 'M': size <<= 10; /* fall through */
+      case 'K': size <<= 10; end++; break;
+      default: break;
+    }
+    if (*end != '\0') return -1;
+    out->cache_size = size;
+    return 0;
+  }
+  if (strncmp(arg, "report-format=", 14) == 0) {
+    if (strcmp(arg + 14, "json") == 0) {
+      out->report_json = true;
+    } else if (strcmp(arg + 14, "text") == 0) {
+      out->report_json = false;
+    } else {
+      return -1;
+    }
+    return 0;
+  }
+  if (strcmp(arg, "cache-stats") == 0) {
+    out->cache_stats = true;
+    return 0;
+  }
+  if (strcmp(arg, "inline-report") == 0) {
+    out->inline_report = true;
+    return 0;
+  }
+  int value = 1;
+  if (strncmp(arg, "no-", 3) == 0) {
+    value = 0;
+    arg += 3;
+  }
+  for (size_t f = 0; f < F_FLAG_COUNT; f++) {
+    if (strcmp(arg, f_flags[f].name) == 0) {
+      out->f_overrides[f] = value;
+      return 0;
+    }
+  }
+  return -1;
+}
+
 static int parse_cli_args(int argc, char* argv[], cli_args_t* out) {
   out->mode = MODE_EXECUTABLE;
-  out->input = NULL;
+  out->inputs = init_list(8);
   out->output = NULL;
+  out->jobs = 1;
+  out->opt_level = 0;
+  for (size_t f = 0; f < F_FLAG_COUNT; f++) {
+    out->f_overrides[f] = -1;
+  }
+  out->inline_limit = -1;
+  out->parallel_jobs = -1;
+  out->inline_report = false;
+  out->cache_dir = NULL;
+  out->cache_size = CACHE_DEFAULT_SIZE;
+  out->cache_stats = false;
+  out->report_json = false;
+  out->trace = (trace_opts){ 0 };
+  out->isa = ISA_SSE2;
   for (int i = 1; i < argc; i++) {
     if (strcmp(argv[i], "-S") == 0) {
       out->mode = MODE_ASM_ONLY;
+    } else if (strcmp(argv[i], "-c") == 0) {
+      out->mode = MODE_OBJECT;
+    } else if (strcmp(argv[i], "-v") == 0) {
+      out->trace.verbosity = 1;
+    } else if (strcmp(argv[i], "-vv") == 0) {
+      out->trace.verbosity = 2;
+    } else if (strcmp(argv[i], "--dump-tokens") == 0) {
+      out->trace.tokens = true;
+    } else if (strcmp(argv[i], "--dump-ast") == 0) {
+      out->trace.ast = true;
+    } else if (strcmp(argv[i], "--dump-asm") == 0) {
+      out->trace.asm_text = true;
+    } else if (strncmp(argv[i], "-j", 2) == 0) {
+      const char* n = argv[i][2] ? argv[i] + 2 : (i + 1 < argc ? argv[++i] : "");
+      char* end;
+      long jobs = strtol(n, &end, 10);
+      if (*n == '\0' || *end != '\0' || jobs < 1) return -1;
+      out->jobs = (unsigned int)jobs;
+    } else if (strncmp(argv[i], "-O", 2) == 0) {
+      const char* lvl = argv[i] + 2;
+      if (lvl[0] == '\0') {
+        out->opt_level = 1;
+      } else if (lvl[0] >= '0' && lvl[0] <= '3' && lvl[1] == '\0') {
+        out->opt_level = lvl[0] - '0';
+      } else {
+        return -1;
+      }
+    } else if (strncmp(argv[i], "-march=", 7) == 0) {
+      const char* arch = argv[i] + 7;
+      if (strcmp(arch, "x86-64") == 0) {
+        out->isa = ISA_SSE2;
+      } else if (strcmp(arch, "x86-64-v2") == 0) {
+        out->isa = ISA_SSE42;
+      } else if (strcmp(arch, "x86-64-v3") == 0) {
+        out->isa = ISA_AVX2;
+      } else {
+        return -1;
+      }
+    } else if (strncmp(argv[i], "-f", 2) == 0) {
+      if (parse_f_flag(argv[i] + 2, out) != 0) return -1;
     } else if (strcmp(argv[i], "-o") == 0) {
       if (i + 1 >= argc) return -1;
       out->output = argv[++i];
     } else if (argv[i][0] == '-') {
       return -1;
     } else {
-      if (out->input != NULL) return -1;
-      out->input = argv[i];
+      add_list(out->inputs, argv[i]);
     }
   }
-  if (out->input == NULL) return -1;
+  if (out->inputs->length == 0) return -1;
+  // a single -o path can only name one .s or .o
+  if (out->output && out->mode != MODE_EXECUTABLE && out->inputs->length > 1) return -1;
   return 0;
 }
 
+static compile_opts_t resolve_opts(const cli_args_t* args) {
+  compile_opts_t opts;
+  opts.codegen = asm_default_opts(args->opt_level);
+  opts.inliner = inline_default_opts(args->opt_level);
+  opts.dce = dce_default_opts(args->opt_level);
+  opts.licm = licm_default_opts(args->opt_level);
+  opts.lazy_parsing = false;
+  opts.incremental = false;
+  opts.report.time = false;
+  opts.report.mem = false;
+  for (size_t f = 0; f < F_FLAG_COUNT; f++) {
+    if (args->f_overrides[f] >= 0) {
+      *(bool*)((char*)&opts + f_flags[f].offset) = args->f_overrides[f];
+    }
+  }
+  if (args->inline_limit >= 0) {
+    opts.inliner.max_size = args->inline_limit;
+  }
+  if (args->inline_report) {
+    opts.inliner.report = stderr;
+  }
+  opts.report.json = args->report_json;
+  opts.trace = args->trace;
+  opts.codegen.whole_program = opts.dce.whole_program;
+  opts.dce.bounds_check = opts.codegen.bounds_check;
+  opts.codegen.isa = args->isa;
+  if (args->parallel_jobs >= 0) {
+    opts.codegen.jobs = (unsigned int)args->parallel_jobs;
+  } else {
+    // leave cores to the other files when several are compiled at once
+    unsigned int threads = online_cpus() / args->jobs;
+    opts.codegen.jobs = args->jobs > 1 ? (threads ? threads : 1) : 0;
+  }
+  return opts;
+}
+
 static char* swap_extension(const char* input, const char* new_ext) {
   size_t len = strlen(input);
   const char* dot = strrchr(input, '.');
@@ -73,15 +333,17 @@ static char* swap_extension(const char* input, const char* new_ext) {
   return out;
 }
 
-static int run_assembler_and_linker(const char* asm_path, const char* exe_path) {
+/// runs a command to completion
+/// @return 0 if it exited successfully
+static int run_command(char* const cmd[]) {
   pid_t pid = fork();
   if (pid < 0) {
     perror("fork");
     return -1;
   }
   if (pid == 0) {
-    execlp("gcc", "gcc", asm_path, "-o", exe_path, (char*)NULL);
-    perror("execlp gcc");
+    execvp(cmd[0], cmd);
+    perror("execvp");
     _exit(127);
   }
   int status;
@@ -89,69 +351,487 @@ static int run_assembler_and_linker(const char* asm_path, const char* exe_path)
     perror("waitpid");
     return -1;
   }
-  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
-    fprintf(stderr, "gcc failed to assemble/link %s\n", asm_path);
-    return -1;
-  }
-  return 0;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
 }
 
-int main(int argc, char *argv[]) {
-  cli_args_t args;
-  if (parse_cli_args(argc, argv, &args) != 0) {
-    usage(argv[0]);
-    return EXIT_FAILURE;
-  }
+/// one input file and the files compiling it produces
+typedef struct {
+  const char* input;
+  char* asm_path;
+  char* obj_path; ///< NULL when only assembly is wanted
+  pid_t pid;
+} unit_t;
 
-  FILE* source_file = fopen(args.input, "r");
-  if (source_file == NULL) {
-    fprintf(stderr, "could not open input file: %s\n", args.input);
-    return EXIT_FAILURE;
+typedef enum {
+  PHASE_TOKENIZE,
+  PHASE_PARSE,
+  PHASE_INLINE,
+  PHASE_DCE,
+  PHASE_LICM,
+  PHASE_CODEGEN,
+  PHASE_ASSEMBLE,
+  PHASE_LINK,
+  PHASE_COUNT,
+} phase_id;
+
+static const char* const phase_names[PHASE_COUNT] = {
+  "tokenize", "parse", "inline", "dce", "licm", "codegen", "assemble", "link",
+};
+
+/// what the reports show for one phase
+typedef struct {
+  bool ran;
+  double wall_ms;
+  unsigned long long items; ///< what the phase produced, counted in unit
+  const char* unit;
+  unsigned long long allocs;
+  unsigned long long alloc_bytes;
+  long peak_rss_kib; ///< peak resident set of the process once the phase ended
+} phase_stats;
+
+typedef struct {
+  phase_stats phases[PHASE_COUNT];
+  struct timespec began;                 ///< when the current phase began
+  unsigned long long counters[STAT_COUNT]; ///< counters when the current phase began
+} phase_report;
+
+static void phase_begin(phase_report* r) {
+  for (int i = 0; i < STAT_COUNT; i++) {
+    r->counters[i] = stat_get((stat_id)i);
   }
+  clock_gettime(CLOCK_MONOTONIC, &r->began);
+}
 
-  char* asm_path_owned = NULL;
-  const char* asm_path = NULL;
-  const char* exe_path = NULL;
+/// how much a counter grew since phase_begin
+static unsigned long long phase_delta(const phase_report* r, stat_id id) {
+  return stat_get(id) - r->counters[id];
+}
 
-  if (args.mode == MODE_ASM_ONLY) {
-    if (args.output) {
-      asm_path = args.output;
-    } else {
-      asm_path_owned = swap_extension(args.input, ".s");
-      asm_path = asm_path_owned;
+static void phase_end(phase_report* r, phase_id id, unsigned long long items, const char* unit) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  phase_stats* p = &r->phases[id];
+  p->ran = true;
+  p->wall_ms = (now.tv_sec - r->began.tv_sec) * 1e3 + (now.tv_nsec - r->began.tv_nsec) / 1e6;
+  p->items = items;
+  p->unit = unit;
+  p->allocs = phase_delta(r, STAT_LIST_ALLOCS) + phase_delta(r, STAT_HT_ALLOCS) +
+              phase_delta(r, STAT_NODE_ALLOCS);
+  p->alloc_bytes = phase_delta(r, STAT_ALLOC_BYTES);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  p->peak_rss_kib = usage.ru_maxrss;
+}
+
+static double per_sec(const phase_stats* p) {
+  return p->wall_ms > 0 ? p->items / (p->wall_ms / 1e3) : 0;
+}
+
+/// prints the phases that ran as a table, or as JSON lines. the report is
+/// built up first and written at once so reports from parallel workers do
+/// not interleave
+static void print_report(const phase_report* r, const report_opts* opts, const char* name) {
+  if (!opts->time && !opts->mem) { return; }
+  char* buf = NULL;
+  size_t len = 0;
+  FILE* out = open_memstream(&buf, &len);
+  if (!opts->json) {
+    fprintf(out, "phase report for %s\n%-10s", name, "phase");
+    if (opts->time) { fprintf(out, " %10s %12s %-8s %12s", "wall ms", "items", "unit", "per sec"); }
+    if (opts->mem) { fprintf(out, " %10s %12s %12s", "allocs", "alloc KiB", "peak KiB"); }
+    fputc('\n', out);
+  }
+  double total_ms = 0;
+  unsigned long long total_allocs = 0, total_bytes = 0;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    const phase_stats* p = &r->phases[i];
+    if (!p->ran) { continue; }
+    total_ms += p->wall_ms;
+    total_allocs += p->allocs;
+    total_bytes += p->alloc_bytes;
+    if (opts->json) {
+      fputs("{\"file\":", out);
+      json_write_str(out, name);
+      fprintf(out, ",\"phase\":\"%s\"", phase_names[i]);
+      if (opts->time) {
+        fprintf(out, ",\"wall_ms\":%.3f,\"items\":%llu,\"unit\":", p->wall_ms, p->items);
+        json_write_str(out, p->unit);
+        fprintf(out, ",\"per_sec\":%.1f", per_sec(p));
+      }
+      if (opts->mem) {
+        fprintf(out, ",\"allocs\":%llu,\"alloc_bytes\":%llu,\"peak_rss_kib\":%ld",
+                p->allocs, p->alloc_bytes, p->peak_rss_kib);
+      }
+      fputs("}\n", out);
+      continue;
+    }
+    fprintf(out, "%-10s", phase_names[i]);
+    if (opts->time) {
+      fprintf(out, " %10.3f %12llu %-8s %12.0f", p->wall_ms, p->items, p->unit ? p->unit : "", per_sec(p));
     }
+    if (opts->mem) {
+      fprintf(out, " %10llu %12.1f %12ld", p->allocs, p->alloc_bytes / 1024.0, p->peak_rss_kib);
+    }
+    fputc('\n', out);
+  }
+  if (!opts->json) {
+    fprintf(out, "%-10s", "total");
+    if (opts->time) { fprintf(out, " %10.3f %12s %-8s %12s", total_ms, "", "", ""); }
+    if (opts->mem) { fprintf(out, " %10llu %12.1f %12s", total_allocs, total_bytes / 1024.0, ""); }
+    fputc('\n', out);
+  }
+  fclose(out);
+  fwrite(buf, 1, len, stderr);
+  fflush(stderr);
+  free(buf);
+}
+
+/// opens <input without extension><suffix> for a dump. dumps can be large,
+/// so they get a big buffer of their own instead of sharing stdout
+static FILE* open_sink(const char* input, const char* suffix) {
+  char* path = swap_extension(input, suffix);
+  FILE* sink = fopen(path, "w");
+  if (!sink) {
+    fprintf(stderr, "could not open dump file: %s\n", path);
   } else {
-    asm_path_owned = swap_extension(args.input, ".s");
-    asm_path = asm_path_owned;
-    exe_path = args.output ? args.output : "a.out";
+    setvbuf(sink, NULL, _IOFBF, 1 << 16);
   }
+  free(path);
+  return sink;
+}
 
+/// tokenizes, parses, optimizes and generates one file. compile errors exit
+/// the process, which is why every file is compiled in its own worker
+static int compile_file(const char* input, const char* asm_path, const compile_opts_t* opts,
+                        phase_report* report) {
+  FILE* source_file = fopen(input, "r");
+  if (source_file == NULL) {
+    fprintf(stderr, "could not open input file: %s\n", input);
+    return -1;
+  }
   unsigned int char_count = getFileCharCount(source_file);
-  printf("welcome to ACompiler\n");
+  const trace_opts* trace = &opts->trace;
+  if (trace->verbosity >= 1) {
+    printf("compiling %s\n", input);
+  }
+  phase_begin(report);
   ArrayList* array = tokenize(source_file, char_count);
-  for (int i = 0; i < array->length; i++) {
-    Token* temp = (Token*)get_list(array, i);
-    printf("[%d] TOKEN: type=%d, lexeme='%s'\n", i, temp->type, temp->lexeme);
+  phase_end(report, PHASE_TOKENIZE, array->length, "tokens");
+  if (trace->verbosity >= 2) {
+    for (int i = 0; i < array->length; i++) {
+      Token* temp = (Token*)get_list(array, i);
+      printf("[%d] TOKEN: type=%d, lexeme='%s'\n", i, temp->type, temp->lexeme);
+    }
+  }
+  if (trace->tokens) {
+    FILE* sink = open_sink(input, ".tokens.jsonl");
+    if (sink) {
+      dumpTokensJson(sink, array);
+      fclose(sink);
+    }
+  }
+  Node* head = NULL;
+  phase_begin(report);
+  if (opts->lazy_parsing) {
+    // without -fwhole-program every function is exported and so is a root
+    ArrayList* roots = NULL;
+    if (opts->dce.whole_program) {
+      roots = init_list(1);
+      add_list(roots, (void*)"main");
+    }
+    head = parse_program_lazy(array, roots, opts->codegen.jobs);
+    if (roots) {
+      free(roots->items);
+      free(roots);
+    }
+  } else {
+    head = parse_program_parallel(array, opts->codegen.jobs);
   }
-  Node* head = parse_program(array);
-  print_ast(head);
+  phase_end(report, PHASE_PARSE, phase_delta(report, STAT_NODE_ALLOCS), "nodes");
+  if (trace->verbosity >= 2) {
+    print_ast(head);
+  }
+  if (trace->ast) {
+    FILE* sink = open_sink(input, ".ast.jsonl");
+    if (sink) {
+      dump_ast_json(sink, head);
+      fclose(sink);
+    }
+  }
+  phase_begin(report);
+  unsigned int inlined = inline_program(head, &opts->inliner);
+  phase_end(report, PHASE_INLINE, inlined, "calls");
+  phase_begin(report);
+  unsigned int removed = dce_program(head, &opts->dce);
+  phase_end(report, PHASE_DCE, removed, "removed");
+  phase_begin(report);
+  unsigned int hoisted = licm_program(head, &opts->licm);
+  phase_end(report, PHASE_LICM, hoisted, "hoisted");
+  phase_begin(report);
   asm_ctx* ctx = asm_init(asm_path);
+  ctx->opts = opts->codegen;
   gen_program(ctx, head);
+  if (ctx->opts.fragments && trace->verbosity >= 1) {
+    printf("reused %u functions from the cache\n", ctx->funcs_reused);
+  }
+  if (ctx->loops_vectorized > 0 && trace->verbosity >= 1) {
+    printf("vectorized %u loops\n", ctx->loops_vectorized);
+  }
   asm_free(ctx);
-  printf("wrote assembly to %s\n", asm_path);
+  phase_end(report, PHASE_CODEGEN, phase_delta(report, STAT_INSNS), "insns");
+  if (trace->verbosity >= 1) {
+    printf("wrote assembly to %s\n", asm_path);
+  }
+  if (trace->asm_text) {
+    FILE* text = fopen(asm_path, "r");
+    FILE* sink = text ? open_sink(input, ".asm.jsonl") : NULL;
+    if (sink) {
+      dump_asm_json(sink, text);
+      fclose(sink);
+    }
+    if (text) { fclose(text); }
+  }
   free_node(head);
   destroy_list(array);
   fclose(source_file);
+  return 0;
+}
 
-  int rc = EXIT_SUCCESS;
-  if (args.mode == MODE_EXECUTABLE) {
-    if (run_assembler_and_linker(asm_path, exe_path) != 0) {
-      rc = EXIT_FAILURE;
+/// hash of the running compiler binary, set once in main before any worker
+/// starts, so a rebuild of any part of the compiler misses the cache
+static uint64_t build_key;
+
+/// hashes the bytes of the compiler executable into build_key
+/// @return 0 if the executable could be read
+static int hash_compiler_binary(void) {
+  FILE* exe = fopen("/proc/self/exe", "rb");
+  if (!exe) { return -1; }
+  uint64_t h = CACHE_HASH_INIT;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), exe)) > 0) {
+    h = cache_hash(h, buf, n);
+  }
+  int err = ferror(exe);
+  fclose(exe);
+  if (err) { return -1; }
+  build_key = h;
+  return 0;
+}
+
+/// hashes the compiler build and every option that changes the generated code
+static uint64_t opts_cache_key(const compile_opts_t* opts) {
+  uint64_t h = build_key;
+  // fields one at a time, struct padding would make the key unstable
+  const unsigned long long fields[] = {
+    opts->codegen.opt_level, opts->codegen.omit_frame_pointer,
+    opts->codegen.optimize_sibling_calls, opts->codegen.whole_program, opts->codegen.bounds_check,
+    opts->codegen.vectorize, opts->codegen.isa,
+    opts->inliner.enabled, opts->inliner.max_size, opts->inliner.max_depth,
+    opts->dce.enabled, opts->dce.whole_program, opts->licm.enabled, opts->lazy_parsing,
+  };
+  return cache_hash(h, fields, sizeof(fields));
+}
+
+/// hashes everything that decides the output of a compile: the source bytes
+/// and opts_cache_key
+/// @return 0 if the source could be read
+static int unit_cache_key(const char* input, const compile_opts_t* opts, uint64_t* key) {
+  FILE* file = fopen(input, "rb");
+  if (!file) { return -1; }
+  uint64_t h = opts_cache_key(opts);
+  char buf[8192];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), file)) > 0) {
+    h = cache_hash(h, buf, n);
+  }
+  fclose(file);
+  *key = h;
+  return 0;
+}
+
+/// copies a unit's outputs out of the cache. both the .s and the .o have to
+/// be there for a hit when an object is wanted
+static bool fetch_unit(compile_cache* cache, uint64_t key, const unit_t* unit) {
+  if (!cache_fetch(cache, key, "s", unit->asm_path)) { return false; }
+  return !unit->obj_path || cache_fetch(cache, key, "o", unit->obj_path);
+}
+
+static int compile_unit(unit_t* unit, const compile_opts_t* opts, compile_cache* cache) {
+  uint64_t key;
+  // reports and dumps are only written by a real compile, so skip the cache
+  const trace_opts* trace = &opts->trace;
+  bool traced = opts->inliner.report || trace->tokens || trace->ast || trace->asm_text;
+  bool cached = cache && !traced && unit_cache_key(unit->input, opts, &key) == 0;
+  if (cached) {
+    bool hit = fetch_unit(cache, key, unit);
+    cache_record(cache, hit);
+    if (hit) {
+      if (trace->verbosity >= 1) {
+        printf("cache hit for %s\n", unit->input);
+      }
+      return 0;
+    }
+  }
+  compile_opts_t unit_opts = *opts;
+  if (cache && opts->incremental) {
+    unit_opts.codegen.fragments = cache;
+    unit_opts.codegen.fragment_salt = opts_cache_key(opts);
+  }
+  phase_report report = { 0 };
+  if (compile_file(unit->input, unit->asm_path, &unit_opts, &report) != 0) {
+    return -1;
+  }
+  if (unit->obj_path) {
+    char* cmd[] = { "gcc", "-c", unit->asm_path, "-o", unit->obj_path, NULL };
+    phase_begin(&report);
+    int rc = run_command(cmd);
+    phase_end(&report, PHASE_ASSEMBLE, 1, "files");
+    if (rc != 0) {
+      fprintf(stderr, "gcc failed to assemble %s\n", unit->asm_path);
+      return -1;
+    }
+  }
+  print_report(&report, &opts->report, unit->input);
+  if (cached) {
+    cache_store(cache, key, "s", unit->asm_path);
+    if (unit->obj_path) {
+      cache_store(cache, key, "o", unit->obj_path);
+    }
+  }
+  return 0;
+}
+
+/// compiles every unit, keeping up to jobs worker processes busy. once a
+/// file fails no new ones are started, but running workers are waited for
+/// @return 0 if every unit compiled
+static int run_units(unit_t* units, unsigned int count, unsigned int jobs,
+                     const compile_opts_t* opts, compile_cache* cache) {
+  unsigned int next = 0;
+  unsigned int running = 0;
+  bool failed = false;
+  while ((next < count && !failed) || running > 0) {
+    while (running < jobs && next < count && !failed) {
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fork");
+        failed = true;
+        break;
+      }
+      if (pid == 0) {
+        int status = compile_unit(&units[next], opts, cache) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        // _exit skips stdio teardown, so flush what the worker printed
+        fflush(stdout);
+        _exit(status);
+      }
+      units[next++].pid = pid;
+      running++;
+    }
+    if (running == 0) { break; }
+    int status;
+    pid_t done = wait(&status);
+    if (done < 0) {
+      perror("wait");
+      return -1;
+    }
+    running--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      for (unsigned int i = 0; i < count; i++) {
+        if (units[i].pid == done) {
+          fprintf(stderr, "failed to compile %s\n", units[i].input);
+        }
+      }
+      failed = true;
+    }
+  }
+  return failed ? -1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+  cli_args_t args;
+  if (parse_cli_args(argc, argv, &args) != 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  compile_opts_t opts = resolve_opts(&args);
+  unsigned int count = args.inputs->length;
+  if (opts.dce.whole_program && count > 1) {
+    // functions called from the other files would be dropped or made local
+    fprintf(stderr, "-fwhole-program needs exactly one input file\n");
+    return EXIT_FAILURE;
+  }
+
+  if (opts.incremental && !args.cache_dir) {
+    fprintf(stderr, "-fincremental needs -fcache-dir\n");
+    return EXIT_FAILURE;
+  }
+  stats_enabled = opts.report.time || opts.report.mem;
+  compile_cache* cache = NULL;
+  if (args.cache_dir) {
+    cache = cache_open(args.cache_dir, args.cache_size);
+    if (!cache) {
+      fprintf(stderr, "could not create cache directory: %s\n", args.cache_dir);
+      return EXIT_FAILURE;
+    }
+    if (hash_compiler_binary() != 0) {
+      fprintf(stderr, "could not read the compiler executable to key the cache\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  unit_t* units = calloc(count, sizeof(unit_t));
+  for (unsigned int i = 0; i < count; i++) {
+    const char* input = (const char*)get_list(args.inputs, i);
+    units[i].input = input;
+    if (args.mode == MODE_ASM_ONLY && args.output) {
+      units[i].asm_path = strdup(args.output);
     } else {
+      units[i].asm_path = swap_extension(input, ".s");
+    }
+    if (args.mode == MODE_OBJECT && args.output) {
+      units[i].obj_path = strdup(args.output);
+    } else if (args.mode != MODE_ASM_ONLY) {
+      units[i].obj_path = swap_extension(input, ".o");
+    }
+  }
+
+  int rc = run_units(units, count, args.jobs, &opts, cache) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  if (rc == EXIT_SUCCESS && args.mode == MODE_EXECUTABLE) {
+    const char* exe_path = args.output ? args.output : "a.out";
+    char** cmd = calloc(count + 4, sizeof(char*));
+    cmd[0] = "gcc";
+    for (unsigned int i = 0; i < count; i++) {
+      cmd[i + 1] = units[i].obj_path;
+    }
+    cmd[count + 1] = "-o";
+    cmd[count + 2] = (char*)exe_path;
+    phase_report report = { 0 };
+    phase_begin(&report);
+    int link_rc = run_command(cmd);
+    phase_end(&report, PHASE_LINK, count, "files");
+    print_report(&report, &opts.report, exe_path);
+    if (link_rc != 0) {
+      fprintf(stderr, "gcc failed to link %s\n", exe_path);
+      rc = EXIT_FAILURE;
+    } else if (opts.trace.verbosity >= 1) {
       printf("wrote executable to %s\n", exe_path);
     }
+    free(cmd);
   }
 
-  free(asm_path_owned);
+  for (unsigned int i = 0; i < count; i++) {
+    free(units[i].asm_path);
+    free(units[i].obj_path);
+  }
+  free(units);
+  if (cache && args.cache_stats) {
+    cache_stats stats = cache_read_stats(cache);
+    fprintf(stderr, "cache: %llu hits, %llu misses, %llu evictions\n",
+            stats.hits, stats.misses, stats.evictions);
+  }
+  cache_close(cache);
+  free(args.inputs->items);
+  free(args.inputs);
   return rc;
 }
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "optimizer/analysis.h"
+#include "parser/parser.h"
+#include "utils/arraylist.h"
+
+bool expr_is_pure(Node* node) {
+  if (!node) { return true; }
+  switch (node->type) {
+    case AST_LITERAL:
+    case AST_IDENTIFIER:
+      return true;
+    case AST_UNARY:
+      if (node->unaryExpr.op == U_PLUS_PLUS || node->unaryExpr.op == U_MINUS_MINUS) {
+        return false;
+      }
+      return expr_is_pure(node->unaryExpr.expr);
+    case AST_BINARY:
+      return expr_is_pure(node->binaryExpr.expr_left) && expr_is_pure(node->binaryExpr.expr_right);
+    case AST_CAST:
+      return expr_is_pure(node->castExpr.inner);
+    case AST_INDEX:
+      return expr_is_pure(node->arrayIndex.target) && expr_is_pure(node->arrayIndex.index);
+    default:
+      return false;
+  }
+}
+
+bool stmt_always_returns(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_RETURN:
+      return true;
+    case AST_BLOCK: {
+      ArrayList* nodes = node->blockStmt.nodes;
+      for (int i = 0; i < nodes->length; i++) {
+        if (stmt_always_returns((Node*)get_list(nodes, i))) { return true; }
+      }
+      return false;
+    }
+    case AST_IF:
+      return node->ifStmt.else_branch &&
+             stmt_always_returns(node->ifStmt.then_branch) &&
+             stmt_always_returns(node->ifStmt.else_branch);
+    default:
+      return false;
+  }
+}
+
+bool const_eval(Node* node, long long* out) {
+  if (!node) { return false; }
+  long long l, r;
+  switch (node->type) {
+    case AST_LITERAL:
+      if (node->literalExpr.str_value) { return false; }
+      *out = node->literalExpr.num_value;
+      return true;
+    case AST_UNARY:
+      if (!const_eval(node->unaryExpr.expr, &l)) { return false; }
+      switch (node->unaryExpr.op) {
+        case U_POS: *out = l; return true;
+        case U_NEG: *out = -l; return true;
+        case U_NOT: *out = !l; return true;
+        case U_BIT_NOT: *out = ~l; return true;
+        default: return false;
+      }
+    case AST_BINARY:
+      if (!const_eval(node->binaryExpr.expr_left, &l) ||
+          !const_eval(node->binaryExpr.expr_right, &r)) {
+        return false;
+      }
+      switch (node->binaryExpr.op) {
+        case B_ADD: *out = l + r; return true;
+        case B_SUB: *out = l - r; return true;
+        case B_MUL: *out = l * r; return true;
+        case B_DIV:
+          if (r == 0) { return false; }
+          *out = l / r;
+          return true;
+        case B_LESS:        *out = l < r; return true;
+        case B_GREATER:     *out = l > r; return true;
+        case B_EQUAL_EQUAL: *out = l == r; return true;
+        case B_NOT_EQUAL:   *out = l != r; return true;
+        case B_GEQ:         *out = l >= r; return true;
+        case B_LEQ:         *out = l <= r; return true;
+        case B_AND:         *out = l & r; return true;
+        case B_OR:          *out = l | r; return true;
+        case B_XOR:         *out = l ^ r; return true;
+        // counts are masked the way the shift instructions mask them
+        case B_SHL:         *out = (long long)((unsigned long long)l << (r & 63)); return true;
+        case B_SAR:         *out = l >> (r & 63); return true;
+        case B_SHR:         *out = (long long)((unsigned long long)l >> (r & 63)); return true;
+        default: return false;
+      }
+    default:
+      return false;
+  }
+}
+
+static void collect_calls_list(ArrayList* nodes, ArrayList* out) {
+  if (!nodes) { return; }
+  for (int i = 0; i < nodes->length; i++) {
+    collect_callees((Node*)get_list(nodes, i), out);
+  }
+}
+
+void collect_callees(Node* node, ArrayList* out) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_CALL:
+      add_list(out, (void*)node->callExpr.callee->identifierExpr.name);
+      collect_calls_list(node->callExpr.args, out);
+      break;
+    case AST_BLOCK:    collect_calls_list(node->blockStmt.nodes, out); break;
+    case AST_VAR_DECL: collect_callees(node->varDecl.assign, out); break;
+    case AST_IF:
+      collect_callees(node->ifStmt.cond, out);
+      collect_callees(node->ifStmt.then_branch, out);
+      collect_callees(node->ifStmt.else_branch, out);
+      break;
+    case AST_WHILE:
+      collect_callees(node->whileStmt.cond, out);
+      collect_callees(node->whileStmt.body, out);
+      collect_callees(node->whileStmt.step, out);
+      break;
+    case AST_RETURN:   collect_callees(node->returnStmt.return_val, out); break;
+    case AST_UNARY:    collect_callees(node->unaryExpr.expr, out); break;
+    case AST_BINARY:
+      collect_callees(node->binaryExpr.expr_left, out);
+      collect_callees(node->binaryExpr.expr_right, out);
+      break;
+    case AST_ASSIGN:
+      collect_callees(node->assignExpr.target, out);
+      collect_callees(node->assignExpr.val, out);
+      break;
+    case AST_CAST:     collect_callees(node->castExpr.inner, out); break;
+    case AST_INDEX:
+      collect_callees(node->arrayIndex.target, out);
+      collect_callees(node->arrayIndex.index, out);
+      break;
+    case AST_ARRAY_LIT: collect_calls_list(node->arrayLit.elements, out); break;
+    default: break;
+  }
+}
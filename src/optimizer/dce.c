@@ -0,0 +1,397 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "optimizer/dce.h"
+#include "optimizer/analysis.h"
+#include "parser/parser.h"
+#include "utils/arraylist.h"
+#include "utils/hashtable.h"
+
+typedef struct {
+  Node* decl;        ///< the AST_VAR_DECL or AST_FUNC_PARAM that introduced the local
+  const char* name;
+  unsigned int reads;
+} local_info;
+
+typedef struct {
+  ArrayList* scopes; ///< stack of lists of local_info (not owned)
+  ArrayList* locals; ///< every local_info of the function (owned)
+  bool rewrite;      ///< false while counting reads, true while removing dead code
+  bool bounds_check; ///< an index can trap, so it is never dropped
+  unsigned int removed;
+} dce_fn;
+
+static void free_ptr_list(ArrayList* list) {
+  free(list->items);
+  free(list);
+}
+
+static const char* fn_name(Node* decl) {
+  return decl->funcDecl.type->function_t.ident->identifierExpr.name;
+}
+
+/// overwrites a node with one of its own children, freeing everything else
+static void replace_with(Node* dst, Node** child) {
+  Node* src = *child;
+  *child = NULL;
+  Node* old = malloc(sizeof(Node));
+  *old = *dst;
+  *dst = *src;
+  free(src);
+  free_node(old);
+}
+
+/// turns a statement that is not part of a block list into an empty block
+static void make_empty(Node* node) {
+  Node* old = malloc(sizeof(Node));
+  *old = *node;
+  free_node(old);
+  node->type = AST_BLOCK;
+  node->blockStmt.nodes = init_list(4);
+}
+
+// ------------------------------------------------------------------
+// structural pass: constant branches and unreachable statements
+
+static bool simplify_stmt(dce_fn* d, Node* node);
+
+static void simplify_list(dce_fn* d, ArrayList* nodes) {
+  unsigned int w = 0;
+  bool dead = false;
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)nodes->items[i];
+    if (!dead && (n->type == AST_COMMENT || simplify_stmt(d, n))) {
+      nodes->items[w++] = n;
+      dead = stmt_always_returns(n);
+      continue;
+    }
+    if (n->type != AST_COMMENT) { d->removed++; }
+    free_node(n);
+  }
+  nodes->length = w;
+}
+
+static void simplify_branch(dce_fn* d, Node* node) {
+  if (node && !simplify_stmt(d, node)) {
+    make_empty(node);
+  }
+}
+
+/// @return false if the statement has no effect and can be removed
+static bool simplify_stmt(dce_fn* d, Node* node) {
+  switch (node->type) {
+    case AST_BLOCK:
+      simplify_list(d, node->blockStmt.nodes);
+      return true;
+    case AST_IF: {
+      simplify_branch(d, node->ifStmt.then_branch);
+      simplify_branch(d, node->ifStmt.else_branch);
+      long long cond;
+      if (!const_eval(node->ifStmt.cond, &cond)) { return true; }
+      d->removed++;
+      if (cond) {
+        replace_with(node, &node->ifStmt.then_branch);
+        return true;
+      }
+      if (!node->ifStmt.else_branch) { return false; }
+      replace_with(node, &node->ifStmt.else_branch);
+      return true;
+    }
+    case AST_WHILE: {
+      simplify_branch(d, node->whileStmt.body);
+      long long cond;
+      if (!const_eval(node->whileStmt.cond, &cond) || cond) { return true; }
+      d->removed++;
+      return false;
+    }
+    default:
+      return true;
+  }
+}
+
+// ------------------------------------------------------------------
+// liveness pass: locals that are written but never read
+
+static local_info* declare(dce_fn* d, Node* decl, Node* ident) {
+  local_info* info = NULL;
+  if (d->rewrite) {
+    for (unsigned int i = 0; i < d->locals->length && !info; i++) {
+      local_info* l = (local_info*)get_list(d->locals, i);
+      if (l->decl == decl) { info = l; }
+    }
+  }
+  if (!info) {
+    info = calloc(1, sizeof(local_info));
+    info->decl = decl;
+    info->name = ident->identifierExpr.name;
+    add_list(d->locals, info);
+  }
+  add_list((ArrayList*)get_list(d->scopes, d->scopes->length - 1), info);
+  return info;
+}
+
+static local_info* resolve(dce_fn* d, const char* name) {
+  for (int s = (int)d->scopes->length - 1; s >= 0; s--) {
+    ArrayList* scope = (ArrayList*)get_list(d->scopes, s);
+    for (int i = (int)scope->length - 1; i >= 0; i--) {
+      local_info* l = (local_info*)get_list(scope, i);
+      if (strcmp(l->name, name) == 0) { return l; }
+    }
+  }
+  return NULL; // a global
+}
+
+static void push_scope(dce_fn* d) {
+  add_list(d->scopes, init_list(8));
+}
+
+static void pop_scope(dce_fn* d) {
+  d->scopes->length--;
+  free_ptr_list((ArrayList*)d->scopes->items[d->scopes->length]);
+}
+
+static bool is_dead(dce_fn* d, local_info* info) {
+  return d->rewrite && info && info->reads == 0;
+}
+
+static void walk_expr(dce_fn* d, Node* node);
+
+static void walk_expr_list(dce_fn* d, ArrayList* nodes) {
+  if (!nodes) { return; }
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    walk_expr(d, (Node*)get_list(nodes, i));
+  }
+}
+
+static void walk_expr(dce_fn* d, Node* node) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_IDENTIFIER: {
+      local_info* info = resolve(d, node->identifierExpr.name);
+      if (info && !d->rewrite) { info->reads++; }
+      break;
+    }
+    case AST_ASSIGN: {
+      Node* target = node->assignExpr.target;
+      walk_expr(d, node->assignExpr.val);
+      if (target->type != AST_IDENTIFIER) {
+        walk_expr(d, target);
+        break;
+      }
+      // a store to a local that is never read only needs its value computed
+      if (is_dead(d, resolve(d, target->identifierExpr.name))) {
+        replace_with(node, &node->assignExpr.val);
+        d->removed++;
+      }
+      break;
+    }
+    case AST_UNARY:  walk_expr(d, node->unaryExpr.expr); break;
+    case AST_BINARY:
+      walk_expr(d, node->binaryExpr.expr_left);
+      walk_expr(d, node->binaryExpr.expr_right);
+      break;
+    case AST_CAST:   walk_expr(d, node->castExpr.inner); break;
+    case AST_INDEX:
+      walk_expr(d, node->arrayIndex.target);
+      walk_expr(d, node->arrayIndex.index);
+      break;
+    case AST_CALL:   walk_expr_list(d, node->callExpr.args); break;
+    case AST_ARRAY_LIT: walk_expr_list(d, node->arrayLit.elements); break;
+    default: break;
+  }
+}
+
+static bool walk_stmt(dce_fn* d, Node* node);
+
+static void walk_block(dce_fn* d, Node* block) {
+  push_scope(d);
+  ArrayList* nodes = block->blockStmt.nodes;
+  unsigned int w = 0;
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)nodes->items[i];
+    if (walk_stmt(d, n)) {
+      nodes->items[w++] = n;
+      continue;
+    }
+    d->removed++;
+    free_node(n);
+  }
+  nodes->length = w;
+  pop_scope(d);
+}
+
+static void walk_branch(dce_fn* d, Node* node) {
+  if (node && !walk_stmt(d, node)) {
+    d->removed++;
+    make_empty(node);
+  }
+}
+
+/// whether an index is read anywhere in an expression
+static bool has_index(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_INDEX:  return true;
+    case AST_UNARY:  return has_index(node->unaryExpr.expr);
+    case AST_BINARY: return has_index(node->binaryExpr.expr_left) || has_index(node->binaryExpr.expr_right);
+    case AST_CAST:   return has_index(node->castExpr.inner);
+    default:         return false;
+  }
+}
+
+/// whether dropping an expression can change what the program does. a
+/// bounds checked index is pure but may trap, which has to happen
+static bool removable(dce_fn* d, Node* node) {
+  return expr_is_pure(node) && !(d->bounds_check && has_index(node));
+}
+
+/// @return false if the statement has no effect and can be removed
+static bool walk_stmt(dce_fn* d, Node* node) {
+  switch (node->type) {
+    case AST_BLOCK:
+      walk_block(d, node);
+      return true;
+    case AST_IF:
+      walk_expr(d, node->ifStmt.cond);
+      walk_branch(d, node->ifStmt.then_branch);
+      walk_branch(d, node->ifStmt.else_branch);
+      return true;
+    case AST_WHILE:
+      walk_expr(d, node->whileStmt.cond);
+      walk_branch(d, node->whileStmt.body);
+      walk_expr(d, node->whileStmt.step);
+      return true;
+    case AST_RETURN:
+      walk_expr(d, node->returnStmt.return_val);
+      return true;
+    case AST_COMMENT:
+      return true;
+    case AST_VAR_DECL: {
+      // the initializer is walked first since it still sees any outer variable
+      walk_expr(d, node->varDecl.assign);
+      local_info* info = declare(d, node, node->varDecl.ident);
+      if (!is_dead(d, info)) { return true; }
+      if (removable(d, node->varDecl.assign)) { return false; }
+      replace_with(node, &node->varDecl.assign);
+      return true;
+    }
+    default:
+      walk_expr(d, node);
+      return !d->rewrite || !removable(d, node);
+  }
+}
+
+static void walk_func(dce_fn* d, Node* func) {
+  push_scope(d);
+  ArrayList* params = func->funcDecl.type->function_t.params;
+  for (unsigned int i = 0; i < params->length; i++) {
+    Node* param = (Node*)get_list(params, i);
+    declare(d, param, param->funcParam.ident);
+  }
+  walk_block(d, func->funcDecl.block);
+  pop_scope(d);
+}
+
+static unsigned int dce_func(Node* func, const dce_opts* opts) {
+  dce_fn d = { .scopes = init_list(16), .locals = NULL, .rewrite = false,
+               .bounds_check = opts->bounds_check, .removed = 0 };
+  simplify_stmt(&d, func->funcDecl.block);
+  unsigned int total = d.removed;
+  // removing one dead local can leave the locals its initializer read dead
+  // too, so count and rewrite until nothing changes
+  do {
+    d.removed = 0;
+    d.locals = init_list(32);
+    d.rewrite = false;
+    walk_func(&d, func);
+    d.rewrite = true;
+    walk_func(&d, func);
+    destroy_list(d.locals);
+    total += d.removed;
+  } while (d.removed > 0);
+  free_ptr_list(d.scopes);
+  return total;
+}
+
+// ------------------------------------------------------------------
+// unreferenced functions
+
+/// in whole program mode only the entry point is visible to the linker
+static bool is_exported(const char* name) {
+  return strcmp(name, "main") == 0;
+}
+
+static void mark_reachable(hashtable_t* funcs, hashtable_t* live, const char* name) {
+  Node** func = (Node**)get_ht(funcs, name);
+  if (!func || get_ht(live, name)) { return; }
+  add_ht(live, name, strdup(name));
+  ArrayList* callees = init_list(16);
+  collect_callees((*func)->funcDecl.block, callees);
+  for (unsigned int i = 0; i < callees->length; i++) {
+    mark_reachable(funcs, live, (const char*)get_list(callees, i));
+  }
+  free_ptr_list(callees);
+}
+
+static unsigned int drop_unreferenced(Node* program) {
+  ArrayList* nodes = program->programDecl.nodes;
+  hashtable_t* funcs = create_ht(256);
+  hashtable_t* live = create_ht(256);
+  bool has_root = false;
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)get_list(nodes, i);
+    if (n->type != AST_FUNC_DECL) { continue; }
+    // the table owns its values, so it holds a boxed pointer to the declaration
+    Node** box = malloc(sizeof(Node*));
+    *box = n;
+    add_ht(funcs, fn_name(n), box);
+    has_root |= is_exported(fn_name(n));
+  }
+  unsigned int removed = 0;
+  // without an entry point everything could still be reached from outside
+  if (has_root) {
+    for (unsigned int i = 0; i < nodes->length; i++) {
+      Node* n = (Node*)get_list(nodes, i);
+      if (n->type == AST_FUNC_DECL && is_exported(fn_name(n))) {
+        mark_reachable(funcs, live, fn_name(n));
+      }
+    }
+    unsigned int w = 0;
+    for (unsigned int i = 0; i < nodes->length; i++) {
+      Node* n = (Node*)nodes->items[i];
+      if (n->type == AST_FUNC_DECL && !get_ht(live, fn_name(n))) {
+        free_node(n);
+        removed++;
+        continue;
+      }
+      nodes->items[w++] = n;
+    }
+    nodes->length = w;
+  }
+  destroy_ht(funcs);
+  destroy_ht(live);
+  return removed;
+}
+
+dce_opts dce_default_opts(unsigned int opt_level) {
+  dce_opts opts;
+  opts.enabled = opt_level >= 1;
+  opts.whole_program = false;
+  opts.bounds_check = false;
+  return opts;
+}
+
+unsigned int dce_program(Node* program, const dce_opts* opts) {
+  assert(program->type == AST_PROGRAM);
+  unsigned int removed = 0;
+  ArrayList* nodes = program->programDecl.nodes;
+  for (unsigned int i = 0; i < nodes->length && opts->enabled; i++) {
+    Node* n = (Node*)get_list(nodes, i);
+    if (n->type == AST_FUNC_DECL) { removed += dce_func(n, opts); }
+  }
+  if (opts->whole_program) {
+    removed += drop_unreferenced(program);
+  }
+  return removed;
+}
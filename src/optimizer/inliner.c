@@ -0,0 +1,479 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include "optimizer/inliner.h"
+#include "optimizer/analysis.h"
+#include "parser/parser.h"
+#include "utils/arraylist.h"
+#include "utils/hashtable.h"
+
+typedef struct {
+  Node* decl;
+  Node* body;           ///< the returned expression, NULL if not a candidate
+  const char* reject;   ///< why the function can never be inlined
+  unsigned int size;
+  ArrayList* callees;   ///< names of called functions (not owned)
+  unsigned int visit;
+} fn_info;
+
+typedef struct {
+  const inline_opts* opts;
+  hashtable_t* funcs; ///< name -> fn_info
+  ArrayList* infos;
+  ArrayList* globals; ///< names of global variables (not owned)
+  unsigned int epoch;
+  unsigned int inlined;
+} inliner;
+
+static void free_name_list(ArrayList* list) {
+  free(list->items);
+  free(list);
+}
+
+static const char* fn_name(Node* decl) {
+  return decl->funcDecl.type->function_t.ident->identifierExpr.name;
+}
+
+static unsigned int count_nodes(Node* node) {
+  if (!node) { return 0; }
+  switch (node->type) {
+    case AST_UNARY:  return 1 + count_nodes(node->unaryExpr.expr);
+    case AST_BINARY:
+      return 1 + count_nodes(node->binaryExpr.expr_left) + count_nodes(node->binaryExpr.expr_right);
+    case AST_ASSIGN:
+      return 1 + count_nodes(node->assignExpr.target) + count_nodes(node->assignExpr.val);
+    case AST_CAST:   return 1 + count_nodes(node->castExpr.inner);
+    case AST_INDEX:
+      return 1 + count_nodes(node->arrayIndex.target) + count_nodes(node->arrayIndex.index);
+    case AST_CALL: {
+      unsigned int n = 1;
+      ArrayList* args = node->callExpr.args;
+      for (int i = 0; i < args->length; i++) {
+        n += count_nodes((Node*)get_list(args, i));
+      }
+      return n;
+    }
+    default:         return 1;
+  }
+}
+
+/// finds the single returned expression of a function body
+static Node* single_return(Node* block) {
+  Node* ret = NULL;
+  ArrayList* nodes = block->blockStmt.nodes;
+  for (int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)get_list(nodes, i);
+    if (n->type == AST_COMMENT) { continue; }
+    if (ret || n->type != AST_RETURN) { return NULL; }
+    ret = n;
+  }
+  return ret ? ret->returnStmt.return_val : NULL;
+}
+
+static bool reaches(inliner* in, fn_info* from, const char* target) {
+  if (from->visit == in->epoch) { return false; }
+  from->visit = in->epoch;
+  for (int i = 0; i < from->callees->length; i++) {
+    const char* callee = (const char*)get_list(from->callees, i);
+    if (strcmp(callee, target) == 0) { return true; }
+    fn_info* next = (fn_info*)get_ht(in->funcs, callee);
+    if (next && reaches(in, next, target)) { return true; }
+  }
+  return false;
+}
+
+static bool is_recursive(inliner* in, fn_info* fn) {
+  in->epoch++;
+  return reaches(in, fn, fn_name(fn->decl));
+}
+
+static bool is_trivial(Node* node) {
+  return node->type == AST_LITERAL || node->type == AST_IDENTIFIER;
+}
+
+static void visit_idents(Node* node, void (*fn)(Node*, void*), void* data) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_IDENTIFIER: fn(node, data); break;
+    case AST_UNARY:      visit_idents(node->unaryExpr.expr, fn, data); break;
+    case AST_BINARY:
+      visit_idents(node->binaryExpr.expr_left, fn, data);
+      visit_idents(node->binaryExpr.expr_right, fn, data);
+      break;
+    case AST_ASSIGN:
+      visit_idents(node->assignExpr.target, fn, data);
+      visit_idents(node->assignExpr.val, fn, data);
+      break;
+    case AST_CAST:       visit_idents(node->castExpr.inner, fn, data); break;
+    case AST_INDEX:
+      visit_idents(node->arrayIndex.target, fn, data);
+      visit_idents(node->arrayIndex.index, fn, data);
+      break;
+    case AST_CALL: {
+      ArrayList* args = node->callExpr.args;
+      for (int i = 0; i < args->length; i++) {
+        visit_idents((Node*)get_list(args, i), fn, data);
+      }
+      break;
+    }
+    default: break;
+  }
+}
+
+typedef struct {
+  const char* name;
+  unsigned int count;
+} use_count;
+
+static void count_use(Node* ident, void* data) {
+  use_count* uc = (use_count*)data;
+  if (strcmp(ident->identifierExpr.name, uc->name) == 0) { uc->count++; }
+}
+
+static int param_index(func_type* ft, const char* name) {
+  for (int i = 0; i < ft->params->length; i++) {
+    Node* p = (Node*)get_list(ft->params, i);
+    if (strcmp(p->funcParam.ident->identifierExpr.name, name) == 0) { return i; }
+  }
+  return -1;
+}
+
+typedef struct {
+  func_type* ft;
+  ArrayList* caller_names;
+  bool captured;
+} capture_check;
+
+static bool name_in(ArrayList* names, const char* name) {
+  for (int i = 0; i < names->length; i++) {
+    if (strcmp((const char*)get_list(names, i), name) == 0) { return true; }
+  }
+  return false;
+}
+
+static void check_global_read(Node* ident, void* data) {
+  capture_check* cc = (capture_check*)data;
+  if (name_in(cc->caller_names, ident->identifierExpr.name)) { cc->captured = true; }
+}
+
+static void check_capture(Node* ident, void* data) {
+  capture_check* cc = (capture_check*)data;
+  const char* name = ident->identifierExpr.name;
+  if (param_index(cc->ft, name) >= 0) { return; }
+  if (name_in(cc->caller_names, name)) { cc->captured = true; }
+}
+
+static void collect_decl_names(Node* node, ArrayList* out) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_BLOCK: {
+      ArrayList* nodes = node->blockStmt.nodes;
+      for (int i = 0; i < nodes->length; i++) {
+        collect_decl_names((Node*)get_list(nodes, i), out);
+      }
+      break;
+    }
+    case AST_VAR_DECL:
+      add_list(out, (void*)node->varDecl.ident->identifierExpr.name);
+      break;
+    case AST_IF:
+      collect_decl_names(node->ifStmt.then_branch, out);
+      collect_decl_names(node->ifStmt.else_branch, out);
+      break;
+    case AST_WHILE:
+      collect_decl_names(node->whileStmt.body, out);
+      break;
+    default: break;
+  }
+}
+
+static bool is_plain_qword(Node* type) {
+  var_t vt = type->variable_t;
+  return !vt.is_adr && !vt.is_array && vt.type == LIT_QWORD;
+}
+
+static Node* wrap_cast(Node* type, Node* expr) {
+  if (is_plain_qword(type)) { return expr; }
+  return mk_cast_expr(clone_node(type), expr);
+}
+
+typedef struct {
+  func_type* ft;
+  ArrayList* args;
+} subst_ctx;
+
+static void subst_param(Node* ident, void* data) {
+  subst_ctx* sc = (subst_ctx*)data;
+  int idx = param_index(sc->ft, ident->identifierExpr.name);
+  if (idx < 0) { return; }
+  Node* param = (Node*)get_list(sc->ft->params, idx);
+  Node* arg = clone_node((Node*)get_list(sc->args, idx));
+  Node* repl = wrap_cast(param->funcParam.type, arg);
+  *ident = *repl;
+  free(repl);
+}
+
+/// whether an expression assigns a parameter or takes its address. either
+/// would act on the argument once it replaces the parameter
+static bool uses_param_as_slot(func_type* ft, Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_ASSIGN: {
+      Node* target = node->assignExpr.target;
+      if (target->type == AST_IDENTIFIER && param_index(ft, target->identifierExpr.name) >= 0) {
+        return true;
+      }
+      return uses_param_as_slot(ft, target) || uses_param_as_slot(ft, node->assignExpr.val);
+    }
+    case AST_UNARY: {
+      unary_expr_t op = node->unaryExpr.op;
+      Node* inner = node->unaryExpr.expr;
+      if ((op == U_ADDR || op == U_PLUS_PLUS || op == U_MINUS_MINUS) &&
+          inner->type == AST_IDENTIFIER && param_index(ft, inner->identifierExpr.name) >= 0) {
+        return true;
+      }
+      return uses_param_as_slot(ft, inner);
+    }
+    case AST_BINARY:
+      return uses_param_as_slot(ft, node->binaryExpr.expr_left) ||
+             uses_param_as_slot(ft, node->binaryExpr.expr_right);
+    case AST_CAST:  return uses_param_as_slot(ft, node->castExpr.inner);
+    case AST_INDEX:
+      return uses_param_as_slot(ft, node->arrayIndex.target) ||
+             uses_param_as_slot(ft, node->arrayIndex.index);
+    case AST_CALL: {
+      ArrayList* args = node->callExpr.args;
+      for (int i = 0; i < args->length; i++) {
+        if (uses_param_as_slot(ft, (Node*)get_list(args, i))) { return true; }
+      }
+      return false;
+    }
+    default: return false;
+  }
+}
+
+/// whether an expression stores anywhere. parameters are refused before this
+/// is asked, so a store here reaches a global or memory behind an address
+static bool body_writes(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_ASSIGN: return true;
+    case AST_UNARY:
+      if (node->unaryExpr.op == U_PLUS_PLUS || node->unaryExpr.op == U_MINUS_MINUS) { return true; }
+      return body_writes(node->unaryExpr.expr);
+    case AST_BINARY:
+      return body_writes(node->binaryExpr.expr_left) || body_writes(node->binaryExpr.expr_right);
+    case AST_CAST:  return body_writes(node->castExpr.inner);
+    case AST_INDEX:
+      return body_writes(node->arrayIndex.target) || body_writes(node->arrayIndex.index);
+    case AST_CALL: {
+      ArrayList* args = node->callExpr.args;
+      for (int i = 0; i < args->length; i++) {
+        if (body_writes((Node*)get_list(args, i))) { return true; }
+      }
+      return false;
+    }
+    default: return false;
+  }
+}
+
+/// whether an expression loads through an address, with [p] or p[i]
+static bool loads_memory(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_INDEX: return true;
+    case AST_UNARY:
+      return node->unaryExpr.op == U_DEREF || loads_memory(node->unaryExpr.expr);
+    case AST_BINARY:
+      return loads_memory(node->binaryExpr.expr_left) || loads_memory(node->binaryExpr.expr_right);
+    case AST_CAST:  return loads_memory(node->castExpr.inner);
+    default: return false;
+  }
+}
+
+static void report(inliner* in, const char* callee, const char* caller, const char* fmt, ...);
+
+static const char* check_call(inliner* in, fn_info* fn, Node* call, ArrayList* caller_names) {
+  if (fn->reject) { return fn->reject; }
+  func_type* ft = &fn->decl->funcDecl.type->function_t;
+  ArrayList* args = call->callExpr.args;
+  if (args->length != ft->params->length) { return "argument count mismatch"; }
+  if (uses_param_as_slot(ft, fn->body)) { return "callee assigns or takes the address of a parameter"; }
+  // the callee body could change memory before a substituted argument is read
+  bool body_stores = fn->callees->length > 0 || body_writes(fn->body);
+  for (int i = 0; i < args->length; i++) {
+    Node* arg = (Node*)get_list(args, i);
+    if (!expr_is_pure(arg)) { return "argument has side effects"; }
+    if (body_stores) {
+      capture_check gc = { .ft = ft, .caller_names = in->globals, .captured = false };
+      visit_idents(arg, check_global_read, &gc);
+      if (gc.captured || loads_memory(arg)) { return "argument reads memory the callee may change"; }
+    }
+    if (is_trivial(arg)) { continue; }
+    Node* p = (Node*)get_list(ft->params, i);
+    use_count uc = { .name = p->funcParam.ident->identifierExpr.name, .count = 0 };
+    visit_idents(fn->body, count_use, &uc);
+    if (uc.count > 1) { return "argument would be evaluated more than once"; }
+  }
+  capture_check cc = { .ft = ft, .caller_names = caller_names, .captured = false };
+  visit_idents(fn->body, check_capture, &cc);
+  if (cc.captured) { return "callee global is shadowed by a caller local"; }
+  return NULL;
+}
+
+static void inline_expr(inliner* in, Node* node, const char* caller, ArrayList* caller_names, unsigned int depth);
+
+static void inline_call(inliner* in, Node* call, const char* caller, ArrayList* caller_names, unsigned int depth) {
+  const char* callee = call->callExpr.callee->identifierExpr.name;
+  fn_info* fn = (fn_info*)get_ht(in->funcs, callee);
+  if (!fn) { return; }
+  if (depth >= in->opts->max_depth) {
+    report(in, callee, caller, "not inlined (depth limit %u)", in->opts->max_depth);
+    return;
+  }
+  const char* why = check_call(in, fn, call, caller_names);
+  if (why) {
+    report(in, callee, caller, "not inlined (%s)", why);
+    return;
+  }
+  func_type* ft = &fn->decl->funcDecl.type->function_t;
+  Node* body = clone_node(fn->body);
+  subst_ctx sc = { .ft = ft, .args = call->callExpr.args };
+  // parameters are replaced in place, including a bare parameter at the root
+  visit_idents(body, subst_param, &sc);
+  Node* repl = wrap_cast(ft->ret_t, body);
+
+  Node* old = malloc(sizeof(Node));
+  *old = *call;
+  *call = *repl;
+  free(repl);
+  free_node(old);
+  in->inlined++;
+  report(in, callee, caller, "inlined (size %u)", fn->size);
+  inline_expr(in, call, caller, caller_names, depth + 1);
+}
+
+static void inline_list(inliner* in, ArrayList* nodes, const char* caller, ArrayList* caller_names, unsigned int depth) {
+  if (!nodes) { return; }
+  for (int i = 0; i < nodes->length; i++) {
+    inline_expr(in, (Node*)get_list(nodes, i), caller, caller_names, depth);
+  }
+}
+
+static void inline_expr(inliner* in, Node* node, const char* caller, ArrayList* caller_names, unsigned int depth) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_CALL:
+      inline_list(in, node->callExpr.args, caller, caller_names, depth);
+      inline_call(in, node, caller, caller_names, depth);
+      break;
+    case AST_BLOCK:    inline_list(in, node->blockStmt.nodes, caller, caller_names, depth); break;
+    case AST_VAR_DECL: inline_expr(in, node->varDecl.assign, caller, caller_names, depth); break;
+    case AST_IF:
+      inline_expr(in, node->ifStmt.cond, caller, caller_names, depth);
+      inline_expr(in, node->ifStmt.then_branch, caller, caller_names, depth);
+      inline_expr(in, node->ifStmt.else_branch, caller, caller_names, depth);
+      break;
+    case AST_WHILE:
+      inline_expr(in, node->whileStmt.cond, caller, caller_names, depth);
+      inline_expr(in, node->whileStmt.body, caller, caller_names, depth);
+      inline_expr(in, node->whileStmt.step, caller, caller_names, depth);
+      break;
+    case AST_RETURN:   inline_expr(in, node->returnStmt.return_val, caller, caller_names, depth); break;
+    case AST_UNARY:    inline_expr(in, node->unaryExpr.expr, caller, caller_names, depth); break;
+    case AST_BINARY:
+      inline_expr(in, node->binaryExpr.expr_left, caller, caller_names, depth);
+      inline_expr(in, node->binaryExpr.expr_right, caller, caller_names, depth);
+      break;
+    case AST_ASSIGN:
+      inline_expr(in, node->assignExpr.target, caller, caller_names, depth);
+      inline_expr(in, node->assignExpr.val, caller, caller_names, depth);
+      break;
+    case AST_CAST:     inline_expr(in, node->castExpr.inner, caller, caller_names, depth); break;
+    case AST_INDEX:
+      inline_expr(in, node->arrayIndex.target, caller, caller_names, depth);
+      inline_expr(in, node->arrayIndex.index, caller, caller_names, depth);
+      break;
+    case AST_ARRAY_LIT: inline_list(in, node->arrayLit.elements, caller, caller_names, depth); break;
+    default: break;
+  }
+}
+
+static void report(inliner* in, const char* callee, const char* caller, const char* fmt, ...) {
+  if (!in->opts->report) { return; }
+  va_list args;
+  va_start(args, fmt);
+  fprintf(in->opts->report, "inline: %s into %s: ", callee, caller);
+  vfprintf(in->opts->report, fmt, args);
+  fprintf(in->opts->report, "\n");
+  va_end(args);
+}
+
+static void classify(inliner* in, fn_info* fn) {
+  fn->body = single_return(fn->decl->funcDecl.block);
+  fn->size = fn->body ? count_nodes(fn->body) : 0;
+  if (!fn->body) {
+    fn->reject = "body is not a single return";
+  } else if (fn->size > in->opts->max_size) {
+    fn->reject = "too large";
+  } else if (is_recursive(in, fn)) {
+    fn->reject = "recursive";
+  }
+}
+
+inline_opts inline_default_opts(unsigned int opt_level) {
+  inline_opts opts;
+  opts.enabled = opt_level >= 2;
+  opts.max_size = opt_level >= 3 ? 48 : 16;
+  opts.max_depth = 4;
+  opts.report = NULL;
+  return opts;
+}
+
+unsigned int inline_program(Node* program, const inline_opts* opts) {
+  assert(program->type == AST_PROGRAM);
+  if (!opts->enabled) { return 0; }
+  inliner in = { .opts = opts, .funcs = create_ht(256), .infos = init_list(64),
+                  .globals = init_list(16), .epoch = 0, .inlined = 0 };
+  ArrayList* nodes = program->programDecl.nodes;
+  for (int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)get_list(nodes, i);
+    if (n->type == AST_VAR_DECL) {
+      add_list(in.globals, (void*)n->varDecl.ident->identifierExpr.name);
+    }
+    if (n->type != AST_FUNC_DECL) { continue; }
+    fn_info* fn = calloc(1, sizeof(fn_info));
+    fn->decl = n;
+    fn->callees = init_list(16);
+    collect_callees(n->funcDecl.block, fn->callees);
+    add_ht(in.funcs, fn_name(n), fn);
+    add_list(in.infos, fn);
+  }
+  for (int i = 0; i < in.infos->length; i++) {
+    classify(&in, (fn_info*)get_list(in.infos, i));
+  }
+  for (int i = 0; i < in.infos->length; i++) {
+    fn_info* fn = (fn_info*)get_list(in.infos, i);
+    func_type ft = fn->decl->funcDecl.type->function_t;
+    ArrayList* caller_names = init_list(32);
+    for (int p = 0; p < ft.params->length; p++) {
+      Node* param = (Node*)get_list(ft.params, p);
+      add_list(caller_names, (void*)param->funcParam.ident->identifierExpr.name);
+    }
+    collect_decl_names(fn->decl->funcDecl.block, caller_names);
+    inline_expr(&in, fn->decl->funcDecl.block, fn_name(fn->decl), caller_names, 0);
+    free_name_list(caller_names);
+  }
+  for (int i = 0; i < in.infos->length; i++) {
+    fn_info* fn = (fn_info*)get_list(in.infos, i);
+    free_name_list(fn->callees);
+  }
+  // the hashtable owns the fn_info structs
+  free_name_list(in.infos);
+  free_name_list(in.globals);
+  destroy_ht(in.funcs);
+  return in.inlined;
+}
@@ -0,0 +1,358 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <pthread.h>
+#include "optimizer/licm.h"
+#include "parser/parser.h"
+#include "utils/arraylist.h"
+
+typedef struct {
+  ArrayList* locals;  ///< names of the function's parameters and declarations (not owned)
+  ArrayList* escaped; ///< names whose address is taken anywhere in the function (not owned)
+  ArrayList* arrays;  ///< names that are declared arrays here, local or global (not owned)
+  unsigned int temps; ///< hoisted locals made so far in the function
+  unsigned int hoisted;
+} licm_fn;
+
+typedef struct {
+  ArrayList* written; ///< names assigned or declared anywhere in the loop (not owned)
+  bool calls;         ///< a call or pointer store in the loop may change any global
+  ArrayList* arrays;  ///< the function's declared arrays (not owned)
+  ArrayList* decls;   ///< declarations of the hoisted values, in evaluation order
+} loop_info;
+
+static void free_name_list(ArrayList* list) {
+  free(list->items);
+  free(list);
+}
+
+static bool name_in(ArrayList* names, const char* name) {
+  for (unsigned int i = 0; i < names->length; i++) {
+    if (strcmp((const char*)get_list(names, i), name) == 0) { return true; }
+  }
+  return false;
+}
+
+/// hoisted values live in locals named licm.<n>, which no identifier in the
+/// source can spell. the AST never owns names, so these are kept for the process
+static const char* temp_name(unsigned int n) {
+  static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+  static char** names = NULL;
+  static unsigned int count = 0;
+  pthread_mutex_lock(&lock);
+  if (n >= count) {
+    unsigned int grown = n + 16;
+    names = realloc(names, grown * sizeof(char*));
+    for (unsigned int i = count; i < grown; i++) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), "licm.%u", i);
+      names[i] = strdup(buf);
+    }
+    count = grown;
+  }
+  const char* name = names[n];
+  pthread_mutex_unlock(&lock);
+  return name;
+}
+
+static Node* mk_name(const char* name) {
+  Node* n = new_node();
+  n->type = AST_IDENTIFIER;
+  n->identifierExpr.name = name;
+  return n;
+}
+
+static Node* mk_qword(void) {
+  Node* n = new_node();
+  n->type = AST_TYPE_VAR;
+  var_t t = { .is_adr = false, .is_array = false, .array_len = 0, .type_adr = ADR_QWORD, .type = LIT_QWORD };
+  n->variable_t = t;
+  return n;
+}
+
+static void visit_all(Node* node, void (*fn)(Node*, void*), void* data);
+
+static void visit_all_list(ArrayList* nodes, void (*fn)(Node*, void*), void* data) {
+  if (!nodes) { return; }
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    visit_all((Node*)get_list(nodes, i), fn, data);
+  }
+}
+
+/// calls fn on a node and then on every statement and expression below it
+static void visit_all(Node* node, void (*fn)(Node*, void*), void* data) {
+  if (!node) { return; }
+  fn(node, data);
+  switch (node->type) {
+    case AST_BLOCK:    visit_all_list(node->blockStmt.nodes, fn, data); break;
+    case AST_VAR_DECL: visit_all(node->varDecl.assign, fn, data); break;
+    case AST_IF:
+      visit_all(node->ifStmt.cond, fn, data);
+      visit_all(node->ifStmt.then_branch, fn, data);
+      visit_all(node->ifStmt.else_branch, fn, data);
+      break;
+    case AST_WHILE:
+      visit_all(node->whileStmt.cond, fn, data);
+      visit_all(node->whileStmt.body, fn, data);
+      visit_all(node->whileStmt.step, fn, data);
+      break;
+    case AST_RETURN:   visit_all(node->returnStmt.return_val, fn, data); break;
+    case AST_UNARY:    visit_all(node->unaryExpr.expr, fn, data); break;
+    case AST_BINARY:
+      visit_all(node->binaryExpr.expr_left, fn, data);
+      visit_all(node->binaryExpr.expr_right, fn, data);
+      break;
+    case AST_ASSIGN:
+      visit_all(node->assignExpr.target, fn, data);
+      visit_all(node->assignExpr.val, fn, data);
+      break;
+    case AST_CAST:     visit_all(node->castExpr.inner, fn, data); break;
+    case AST_INDEX:
+      visit_all(node->arrayIndex.target, fn, data);
+      visit_all(node->arrayIndex.index, fn, data);
+      break;
+    case AST_CALL:     visit_all_list(node->callExpr.args, fn, data); break;
+    case AST_ARRAY_LIT: visit_all_list(node->arrayLit.elements, fn, data); break;
+    default: break;
+  }
+}
+
+static bool modifies_operand(unary_expr_t op) {
+  return op == U_PLUS_PLUS || op == U_MINUS_MINUS || op == U_ADDR;
+}
+
+static void note_locals(Node* node, void* data) {
+  licm_fn* f = (licm_fn*)data;
+  if (node->type == AST_VAR_DECL) {
+    add_list(f->locals, (void*)node->varDecl.ident->identifierExpr.name);
+    if (node->varDecl.type->variable_t.is_array) {
+      add_list(f->arrays, (void*)node->varDecl.ident->identifierExpr.name);
+    }
+  } else if (node->type == AST_UNARY && node->unaryExpr.op == U_ADDR &&
+             node->unaryExpr.expr->type == AST_IDENTIFIER) {
+    add_list(f->escaped, (void*)node->unaryExpr.expr->identifierExpr.name);
+  }
+}
+
+/// a store into a declared array stays in it. any other place that is not a
+/// plain name is reached through a pointer, which can point at a global
+static bool stores_through_pointer(loop_info* loop, Node* target) {
+  if (target->type == AST_INDEX) {
+    Node* base = target->arrayIndex.target;
+    return base->type != AST_IDENTIFIER || !name_in(loop->arrays, base->identifierExpr.name);
+  }
+  return target->type != AST_IDENTIFIER;
+}
+
+static void note_writes(Node* node, void* data) {
+  loop_info* loop = (loop_info*)data;
+  switch (node->type) {
+    case AST_VAR_DECL:
+      // also keeps expressions reading a name the loop body shadows in place
+      add_list(loop->written, (void*)node->varDecl.ident->identifierExpr.name);
+      break;
+    case AST_ASSIGN:
+      if (node->assignExpr.target->type == AST_IDENTIFIER) {
+        add_list(loop->written, (void*)node->assignExpr.target->identifierExpr.name);
+      } else if (stores_through_pointer(loop, node->assignExpr.target)) {
+        // a store through a pointer can reach any global, the same as a call
+        loop->calls = true;
+      }
+      break;
+    case AST_UNARY:
+      if (!modifies_operand(node->unaryExpr.op)) { break; }
+      if (node->unaryExpr.expr->type == AST_IDENTIFIER) {
+        add_list(loop->written, (void*)node->unaryExpr.expr->identifierExpr.name);
+      } else if (node->unaryExpr.op != U_ADDR && stores_through_pointer(loop, node->unaryExpr.expr)) {
+        loop->calls = true;
+      }
+      break;
+    case AST_CALL:
+      loop->calls = true;
+      break;
+    default: break;
+  }
+}
+
+/// an expression is invariant when every name it reads keeps its value for
+/// the whole loop. division can trap, so it is never treated as invariant
+static bool is_invariant(licm_fn* f, loop_info* loop, Node* node) {
+  switch (node->type) {
+    case AST_LITERAL:
+      return !node->literalExpr.str_value;
+    case AST_IDENTIFIER: {
+      const char* name = node->identifierExpr.name;
+      if (name_in(loop->written, name) || name_in(f->escaped, name)) { return false; }
+      return !loop->calls || name_in(f->locals, name);
+    }
+    case AST_UNARY:
+      // a load through a pointer can trap, and stores can change it
+      if (modifies_operand(node->unaryExpr.op) || node->unaryExpr.op == U_DEREF) { return false; }
+      return is_invariant(f, loop, node->unaryExpr.expr);
+    case AST_BINARY:
+      if (node->binaryExpr.op == B_DIV) { return false; }
+      return is_invariant(f, loop, node->binaryExpr.expr_left) &&
+             is_invariant(f, loop, node->binaryExpr.expr_right);
+    case AST_CAST:
+      return is_invariant(f, loop, node->castExpr.inner);
+    default:
+      return false;
+  }
+}
+
+/// loading a name or a literal costs as much as loading the hoisted local
+static bool worth_hoisting(Node* node) {
+  switch (node->type) {
+    case AST_BINARY: return true;
+    case AST_UNARY:  return worth_hoisting(node->unaryExpr.expr);
+    case AST_CAST:   return worth_hoisting(node->castExpr.inner);
+    default:         return false;
+  }
+}
+
+/// moves an expression into a new declaration and leaves a read of it behind
+static void hoist(licm_fn* f, loop_info* loop, Node* node) {
+  const char* name = temp_name(f->temps++);
+  Node* value = new_node();
+  *value = *node;
+  add_list(loop->decls, mk_var_decl(mk_name(name), mk_qword(), value));
+  add_list(f->locals, (void*)name);
+  node->type = AST_IDENTIFIER;
+  node->identifierExpr.name = name;
+  f->hoisted++;
+}
+
+static void hoist_expr(licm_fn* f, loop_info* loop, Node* node);
+
+static void hoist_list(licm_fn* f, loop_info* loop, ArrayList* nodes) {
+  if (!nodes) { return; }
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    hoist_expr(f, loop, (Node*)get_list(nodes, i));
+  }
+}
+
+/// hoists the largest invariant expressions found anywhere inside a loop
+static void hoist_expr(licm_fn* f, loop_info* loop, Node* node) {
+  if (!node) { return; }
+  if (worth_hoisting(node) && is_invariant(f, loop, node)) {
+    hoist(f, loop, node);
+    return;
+  }
+  switch (node->type) {
+    case AST_BLOCK:    hoist_list(f, loop, node->blockStmt.nodes); break;
+    case AST_VAR_DECL: hoist_expr(f, loop, node->varDecl.assign); break;
+    case AST_IF:
+      hoist_expr(f, loop, node->ifStmt.cond);
+      hoist_expr(f, loop, node->ifStmt.then_branch);
+      hoist_expr(f, loop, node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      hoist_expr(f, loop, node->whileStmt.cond);
+      hoist_expr(f, loop, node->whileStmt.body);
+      hoist_expr(f, loop, node->whileStmt.step);
+      break;
+    case AST_RETURN:   hoist_expr(f, loop, node->returnStmt.return_val); break;
+    case AST_UNARY:
+      // the operand of ++, -- and & is a place, not a value
+      if (!modifies_operand(node->unaryExpr.op)) { hoist_expr(f, loop, node->unaryExpr.expr); }
+      break;
+    case AST_BINARY:
+      hoist_expr(f, loop, node->binaryExpr.expr_left);
+      hoist_expr(f, loop, node->binaryExpr.expr_right);
+      break;
+    case AST_ASSIGN:
+      if (node->assignExpr.target->type == AST_INDEX) {
+        hoist_expr(f, loop, node->assignExpr.target->arrayIndex.index);
+      }
+      hoist_expr(f, loop, node->assignExpr.val);
+      break;
+    case AST_CAST:     hoist_expr(f, loop, node->castExpr.inner); break;
+    case AST_INDEX:    hoist_expr(f, loop, node->arrayIndex.index); break;
+    case AST_CALL:     hoist_list(f, loop, node->callExpr.args); break;
+    case AST_ARRAY_LIT: hoist_list(f, loop, node->arrayLit.elements); break;
+    default: break;
+  }
+}
+
+static void licm_loop(licm_fn* f, Node* node) {
+  loop_info loop = { .written = init_list(16), .calls = false, .arrays = f->arrays, .decls = init_list(4) };
+  visit_all(node, note_writes, &loop);
+  hoist_expr(f, &loop, node->whileStmt.cond);
+  hoist_expr(f, &loop, node->whileStmt.body);
+  hoist_expr(f, &loop, node->whileStmt.step);
+  if (loop.decls->length > 0) {
+    // the loop turns into a block of the hoisted declarations and the loop,
+    // which keeps the new locals scoped to it
+    Node* inner = new_node();
+    *inner = *node;
+    add_list(loop.decls, inner);
+    node->type = AST_BLOCK;
+    node->blockStmt.nodes = loop.decls;
+  } else {
+    free_name_list(loop.decls);
+  }
+  free_name_list(loop.written);
+}
+
+/// handles inner loops first, so what they hoist can move further out
+static void licm_stmt(licm_fn* f, Node* node) {
+  if (!node) { return; }
+  switch (node->type) {
+    case AST_BLOCK: {
+      ArrayList* nodes = node->blockStmt.nodes;
+      for (unsigned int i = 0; i < nodes->length; i++) {
+        licm_stmt(f, (Node*)get_list(nodes, i));
+      }
+      break;
+    }
+    case AST_IF:
+      licm_stmt(f, node->ifStmt.then_branch);
+      licm_stmt(f, node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      licm_stmt(f, node->whileStmt.body);
+      licm_loop(f, node);
+      break;
+    default: break;
+  }
+}
+
+licm_opts licm_default_opts(unsigned int opt_level) {
+  licm_opts opts;
+  opts.enabled = opt_level >= 1;
+  return opts;
+}
+
+unsigned int licm_program(Node* program, const licm_opts* opts) {
+  assert(program->type == AST_PROGRAM);
+  if (!opts->enabled) { return 0; }
+  unsigned int hoisted = 0;
+  ArrayList* nodes = program->programDecl.nodes;
+  for (unsigned int i = 0; i < nodes->length; i++) {
+    Node* n = (Node*)get_list(nodes, i);
+    if (n->type != AST_FUNC_DECL) { continue; }
+    licm_fn f = { .locals = init_list(32), .escaped = init_list(8), .arrays = init_list(8),
+                  .temps = 0, .hoisted = 0 };
+    ArrayList* params = n->funcDecl.type->function_t.params;
+    for (unsigned int p = 0; p < params->length; p++) {
+      Node* param = (Node*)get_list(params, p);
+      add_list(f.locals, (void*)param->funcParam.ident->identifierExpr.name);
+    }
+    visit_all(n->funcDecl.block, note_locals, &f);
+    // a global array counts unless a parameter or local hides it
+    for (unsigned int g = 0; g < nodes->length; g++) {
+      Node* decl = (Node*)get_list(nodes, g);
+      if (decl->type != AST_VAR_DECL || !decl->varDecl.type->variable_t.is_array) { continue; }
+      const char* name = decl->varDecl.ident->identifierExpr.name;
+      if (!name_in(f.locals, name)) { add_list(f.arrays, (void*)name); }
+    }
+    licm_stmt(&f, n->funcDecl.block);
+    hoisted += f.hoisted;
+    free_name_list(f.locals);
+    free_name_list(f.escaped);
+    free_name_list(f.arrays);
+  }
+  return hoisted;
+}
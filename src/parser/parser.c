@@ -6,14 +6,26 @@
 #include <assert.h>
 #include "errors/errors.h"
 #include "utils/arraylist.h"
+#include "utils/hashtable.h"
+#include "utils/threadpool.h"
+#include "utils/cache.h"
+#include "utils/stats.h"
+#include "utils/json.h"
 #include "parser/parser.h"
 #include "tokenizer/tokens.h"
 
 static bool block_has_ret(Node* block);
 static bool stmt_has_ret(Node* block);
 
+/// every node the parser makes comes from here so -fmem-report can count them
+Node* new_node(void) {
+  stat_add(STAT_NODE_ALLOCS, 1);
+  stat_add(STAT_ALLOC_BYTES, sizeof(Node));
+  return malloc(sizeof(Node));
+}
+
 Node* mk_func_t(Node* ret, ArrayList* params, Node* ident) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   func_type ft = { .ident = ident, .ret_t = ret, .params = params };
   n->type = AST_TYPE_FUNC;  
   n->function_t = ft;
@@ -21,7 +33,7 @@ Node* mk_func_t(Node* ret, ArrayList* params, Node* ident) {
 }
 
 Node* mk_func_param(Node* ident, Node* type) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   func_param fp = { .ident = ident, .type = type };
   n->type = AST_FUNC_PARAM;
   n->funcParam = fp;
@@ -29,7 +41,7 @@ Node* mk_func_param(Node* ident, Node* type) {
 }
 
 Node* mk_var_t(bool is_adr, lit_adr_t type_adr, lit_t type) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   var_t vt;
   n->type = AST_TYPE_VAR;
   vt.is_adr = is_adr;
@@ -43,7 +55,7 @@ Node* mk_var_t(bool is_adr, lit_adr_t type_adr, lit_t type) {
 }
 
 Node* mk_return_stmt(Node* return_val) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_RETURN;
   return_stmt rs = { .return_val = return_val };
   n->returnStmt = rs;
@@ -51,7 +63,7 @@ Node* mk_return_stmt(Node* return_val) {
 }
 
 Node* mk_comment_stmt(char* comment) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_COMMENT;
   comment_stmt cs = { .comment = comment };
   n->commentStmt = cs;
@@ -59,7 +71,7 @@ Node* mk_comment_stmt(char* comment) {
 }
 
 Node* mk_cast_expr(Node* type, Node* inner) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_CAST;
   cast_expr ce = { .var_t = type, .inner = inner };
   n->castExpr = ce;
@@ -67,7 +79,7 @@ Node* mk_cast_expr(Node* type, Node* inner) {
 } 
 
 Node* mk_call_expr(Node* callee, ArrayList* args) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_CALL;
   call_expr ce = { .callee = callee, .args = args };
   n->callExpr = ce;
@@ -75,7 +87,7 @@ Node* mk_call_expr(Node* callee, ArrayList* args) {
 }
 
 Node* mk_index_expr(Node* target, Node* index) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_INDEX;
   index_expr ie = { .target = target, .index = index };
   n->arrayIndex = ie;
@@ -83,7 +95,7 @@ Node* mk_index_expr(Node* target, Node* index) {
 }
 
 Node* mk_assign_expr(Node* target, Node* val) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_ASSIGN;
   assign_expr ae = { .target = target, .val = val };
   n->assignExpr = ae;
@@ -91,7 +103,7 @@ Node* mk_assign_expr(Node* target, Node* val) {
 }
 
 Node* mk_binary_expr(binary_expr_t op, Node* expr_left, Node* expr_right) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_BINARY;
   binary_expr be = { .op = op, .expr_left = expr_left, .expr_right = expr_right };
   n->binaryExpr = be;
@@ -99,7 +111,7 @@ Node* mk_binary_expr(binary_expr_t op, Node* expr_left, Node* expr_right) {
 }
 
 Node* mk_unary_expr(unary_expr_t op, Node* expr) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_UNARY;
   unary_expr ue = { .op = op, .expr = expr };
   n->unaryExpr = ue;
@@ -107,7 +119,7 @@ Node* mk_unary_expr(unary_expr_t op, Node* expr) {
 } 
 
 Node* mk_literal_expr(const char* num_value, const char* str_value) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_LITERAL;
   literal_expr le; 
   if (!num_value) {
@@ -124,15 +136,51 @@ Node* mk_literal_expr(const char* num_value, const char* str_value) {
 Node* mk_identifer_expr(Token* ident) {
   Token_type type = ident->type;
 assert(type == T_IDENTIFIER);
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_IDENTIFIER;
   identifier_expr ie = { .name = ident->lexeme };
   n->identifierExpr = ie;
   return n;
 }
 
+static bool is_assignable(Node* node) {
+  if (!node) { return false; }
+  bool deref = node->type == AST_UNARY && node->unaryExpr.op == U_DEREF;
+  return node->type == AST_IDENTIFIER || node->type == AST_INDEX || deref;
+}
+
+/// whether evaluating an expression does more than produce its value
+static bool has_side_effects(Node* node) {
+  if (!node) { return false; }
+  switch (node->type) {
+    case AST_CALL:
+    case AST_ASSIGN:
+      return true;
+    case AST_UNARY:
+      return node->unaryExpr.op == U_PLUS_PLUS || node->unaryExpr.op == U_MINUS_MINUS ||
+             has_side_effects(node->unaryExpr.expr);
+    case AST_BINARY:
+      return has_side_effects(node->binaryExpr.expr_left) || has_side_effects(node->binaryExpr.expr_right);
+    case AST_CAST:  return has_side_effects(node->castExpr.inner);
+    case AST_INDEX:
+      return has_side_effects(node->arrayIndex.target) || has_side_effects(node->arrayIndex.index);
+    default:        return false;
+  }
+}
+
+Node* mk_update(Token* op_token, Node* target, binary_expr_t op, Node* value) {
+  if (!is_assignable(target)) {
+    compile_error(op_token, "the target of an update must be assignable");
+  }
+  // the target is read and then written, and both must find the same place
+  if (has_side_effects(target)) {
+    compile_error(op_token, "the target of an update must not have side effects");
+  }
+  return mk_assign_expr(target, mk_binary_expr(op, clone_node(target), value));
+}
+
 Node* mk_if_stmt(Node* cond, Node* then_branch, Node* else_branch) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_IF;
   if_stmt is;
   is.cond = cond;
@@ -146,8 +194,16 @@ Node* mk_if_stmt(Node* cond, Node* then_branch, Node* else_branch) {
   return n;
 } 
 
+Node* mk_while_stmt(Node* cond, Node* body, Node* step) {
+  Node* n = new_node();
+  n->type = AST_WHILE;
+  while_stmt ws = { .cond = cond, .body = body, .step = step };
+  n->whileStmt = ws;
+  return n;
+}
+
 Node* mk_block_stmt(ArrayList* nodes) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_BLOCK;
   block_stmt bs = { .nodes = nodes };
   n->blockStmt = bs;
@@ -155,7 +211,7 @@ Node* mk_block_stmt(ArrayList* nodes) {
 }
 
 Node* mk_func_decl(Node* type, Node* block) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_FUNC_DECL;
   func_decl fd = { .type = type, .block = block }; 
   n->funcDecl = fd;
@@ -163,7 +219,7 @@ Node* mk_func_decl(Node* type, Node* block) {
 }
 
 Node* mk_var_decl(Node* ident, Node* type, Node* assign) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_VAR_DECL;
   var_decl vd = { .ident = ident, .type = type, .assign = assign };
   n->varDecl = vd;
@@ -171,7 +227,7 @@ Node* mk_var_decl(Node* ident, Node* type, Node* assign) {
 }
 
 Node* mk_program_decl(ArrayList* nodes) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   n->type = AST_PROGRAM;
   program_decl pd = { .nodes = nodes };
   n->programDecl = pd;
@@ -211,6 +267,11 @@ void free_node(Node* node) {
       free_node(node->ifStmt.then_branch);
       free_node(node->ifStmt.else_branch);
       break;
+    case AST_WHILE:
+      free_node(node->whileStmt.cond);
+      free_node(node->whileStmt.body);
+      free_node(node->whileStmt.step);
+      break;
     case AST_RETURN:
       free_node(node->returnStmt.return_val);
       break;
@@ -258,6 +319,204 @@ void free_node(Node* node) {
   free(node);
 }
 
+static ArrayList* clone_node_list(ArrayList* list) {
+  if (!list) return NULL;
+  ArrayList* out = init_list(list->capacity > 0 ? list->capacity : 1);
+  for (int i = 0; i < list->length; i++) {
+    add_list(out, clone_node((Node*)list->items[i]));
+  }
+  return out;
+}
+
+Node* clone_node(Node* node) {
+  if (!node) return NULL;
+  Node* n = new_node();
+  *n = *node;
+  switch (node->type) {
+    case AST_PROGRAM:
+      n->programDecl.nodes = clone_node_list(node->programDecl.nodes);
+      break;
+    case AST_VAR_DECL:
+      n->varDecl.ident = clone_node(node->varDecl.ident);
+      n->varDecl.type = clone_node(node->varDecl.type);
+      n->varDecl.assign = clone_node(node->varDecl.assign);
+      break;
+    case AST_FUNC_DECL:
+      n->funcDecl.type = clone_node(node->funcDecl.type);
+      n->funcDecl.block = clone_node(node->funcDecl.block);
+      break;
+    case AST_BLOCK:
+      n->blockStmt.nodes = clone_node_list(node->blockStmt.nodes);
+      break;
+    case AST_IF:
+      n->ifStmt.cond = clone_node(node->ifStmt.cond);
+      n->ifStmt.then_branch = clone_node(node->ifStmt.then_branch);
+      n->ifStmt.else_branch = clone_node(node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      n->whileStmt.cond = clone_node(node->whileStmt.cond);
+      n->whileStmt.body = clone_node(node->whileStmt.body);
+      n->whileStmt.step = clone_node(node->whileStmt.step);
+      break;
+    case AST_RETURN:
+      n->returnStmt.return_val = clone_node(node->returnStmt.return_val);
+      break;
+    case AST_UNARY:
+      n->unaryExpr.expr = clone_node(node->unaryExpr.expr);
+      break;
+    case AST_BINARY:
+      n->binaryExpr.expr_left = clone_node(node->binaryExpr.expr_left);
+      n->binaryExpr.expr_right = clone_node(node->binaryExpr.expr_right);
+      break;
+    case AST_ASSIGN:
+      n->assignExpr.target = clone_node(node->assignExpr.target);
+      n->assignExpr.val = clone_node(node->assignExpr.val);
+      break;
+    case AST_CALL:
+      n->callExpr.callee = clone_node(node->callExpr.callee);
+      n->callExpr.args = clone_node_list(node->callExpr.args);
+      break;
+    case AST_CAST:
+      n->castExpr.var_t = clone_node(node->castExpr.var_t);
+      n->castExpr.inner = clone_node(node->castExpr.inner);
+      break;
+    case AST_FUNC_PARAM:
+      n->funcParam.ident = clone_node(node->funcParam.ident);
+      n->funcParam.type = clone_node(node->funcParam.type);
+      break;
+    case AST_TYPE_FUNC:
+      n->function_t.ident = clone_node(node->function_t.ident);
+      n->function_t.ret_t = clone_node(node->function_t.ret_t);
+      n->function_t.params = clone_node_list(node->function_t.params);
+      break;
+    case AST_INDEX:
+      n->arrayIndex.target = clone_node(node->arrayIndex.target);
+      n->arrayIndex.index = clone_node(node->arrayIndex.index);
+      break;
+    case AST_ARRAY_LIT:
+      n->arrayLit.elements = clone_node_list(node->arrayLit.elements);
+      break;
+    case AST_COMMENT:
+    case AST_IDENTIFIER:
+    case AST_LITERAL:
+    case AST_TYPE_VAR:
+      break;
+  }
+  return n;
+}
+
+static uint64_t hash_str(uint64_t hash, const char* str) {
+  if (!str) { return cache_hash(hash, "", 1); }
+  return cache_hash(hash, str, strlen(str) + 1);
+}
+
+static uint64_t hash_long(uint64_t hash, long long value) {
+  return cache_hash(hash, &value, sizeof(value));
+}
+
+static uint64_t hash_node_list(uint64_t hash, ArrayList* list) {
+  if (!list) { return hash_long(hash, -1); }
+  long long count = 0;
+  for (int i = 0; i < list->length; i++) {
+    Node* n = (Node*)list->items[i];
+    // comments never reach the output
+    if (n && n->type == AST_COMMENT) { continue; }
+    hash = hash_node(hash, n);
+    count++;
+  }
+  return hash_long(hash, count);
+}
+
+uint64_t hash_node(uint64_t hash, Node* node) {
+  if (!node) { return hash_long(hash, -1); }
+  hash = hash_long(hash, node->type);
+  switch (node->type) {
+    case AST_PROGRAM:
+      hash = hash_node_list(hash, node->programDecl.nodes);
+      break;
+    case AST_VAR_DECL:
+      hash = hash_node(hash, node->varDecl.ident);
+      hash = hash_node(hash, node->varDecl.type);
+      hash = hash_node(hash, node->varDecl.assign);
+      break;
+    case AST_FUNC_DECL:
+      hash = hash_node(hash, node->funcDecl.type);
+      hash = hash_node(hash, node->funcDecl.block);
+      break;
+    case AST_BLOCK:
+      hash = hash_node_list(hash, node->blockStmt.nodes);
+      break;
+    case AST_IF:
+      hash = hash_node(hash, node->ifStmt.cond);
+      hash = hash_node(hash, node->ifStmt.then_branch);
+      hash = hash_node(hash, node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      hash = hash_node(hash, node->whileStmt.cond);
+      hash = hash_node(hash, node->whileStmt.body);
+      hash = hash_node(hash, node->whileStmt.step);
+      break;
+    case AST_RETURN:
+      hash = hash_node(hash, node->returnStmt.return_val);
+      break;
+    case AST_IDENTIFIER:
+      hash = hash_str(hash, node->identifierExpr.name);
+      break;
+    case AST_LITERAL:
+      hash = hash_long(hash, node->literalExpr.num_value);
+      hash = hash_str(hash, node->literalExpr.str_value);
+      break;
+    case AST_UNARY:
+      hash = hash_long(hash, node->unaryExpr.op);
+      hash = hash_node(hash, node->unaryExpr.expr);
+      break;
+    case AST_BINARY:
+      hash = hash_long(hash, node->binaryExpr.op);
+      hash = hash_node(hash, node->binaryExpr.expr_left);
+      hash = hash_node(hash, node->binaryExpr.expr_right);
+      break;
+    case AST_ASSIGN:
+      hash = hash_node(hash, node->assignExpr.target);
+      hash = hash_node(hash, node->assignExpr.val);
+      break;
+    case AST_CALL:
+      hash = hash_node(hash, node->callExpr.callee);
+      hash = hash_node_list(hash, node->callExpr.args);
+      break;
+    case AST_CAST:
+      hash = hash_node(hash, node->castExpr.var_t);
+      hash = hash_node(hash, node->castExpr.inner);
+      break;
+    case AST_FUNC_PARAM:
+      hash = hash_node(hash, node->funcParam.ident);
+      hash = hash_node(hash, node->funcParam.type);
+      break;
+    case AST_TYPE_FUNC:
+      hash = hash_node(hash, node->function_t.ident);
+      hash = hash_node(hash, node->function_t.ret_t);
+      hash = hash_node_list(hash, node->function_t.params);
+      break;
+    case AST_INDEX:
+      hash = hash_node(hash, node->arrayIndex.target);
+      hash = hash_node(hash, node->arrayIndex.index);
+      break;
+    case AST_ARRAY_LIT:
+      hash = hash_node_list(hash, node->arrayLit.elements);
+      break;
+    case AST_TYPE_VAR: {
+      var_t t = node->variable_t;
+      hash = hash_long(hash, t.is_adr);
+      hash = hash_long(hash, t.is_array);
+      hash = hash_long(hash, t.array_len);
+      hash = hash_long(hash, t.is_adr ? (long long)t.type_adr : (long long)t.type);
+      break;
+    }
+    case AST_COMMENT:
+      break;
+  }
+  return hash;
+}
+
 static bool get_var_type(Parser* parser, var_t* variable, Token* t) {
  if (p_match(t, T_AND)) {
     Token* temp = p_advance(parser);
@@ -295,6 +554,12 @@ static bool get_var_type(Parser* parser, var_t* variable, Token* t) {
       case T_QWORD:
         variable->type = LIT_QWORD;
         break;
+      case T_V128:
+        variable->type = LIT_V128;
+        break;
+      case T_V256:
+        variable->type = LIT_V256;
+        break;
       default:
         variable->type = LIT_QWORD;
         return false;
@@ -304,7 +569,7 @@ static bool get_var_type(Parser* parser, var_t* variable, Token* t) {
 }
 
 Node* parse_var_type(Parser* parser) {
-  Node* n = malloc(sizeof(Node));
+  Node* n = new_node();
   Token* t = p_peek(parser);
   var_t variable;
   n->type = AST_TYPE_VAR;
@@ -364,6 +629,67 @@ Node* parse_if_stmt(Parser* parser) {
   return mk_if_stmt(cond, then_branch, NULL);
 }
 
+Node* parse_while_stmt(Parser* parser) {
+  assert(p_match(p_peek(parser), T_WHILE));
+  p_advance(parser);
+  if (!p_match(p_peek(parser), T_LEFT_PAREN)) {
+    compile_error(p_peek(parser), "while loops require an opening paren");
+  }
+  p_advance(parser);
+  Node* cond = parse_binary_expr(parser);
+  if (!p_match(p_peek(parser), T_RIGHT_PAREN)) {
+    compile_error(p_peek(parser), "while loops require a closing paren");
+  }
+  p_advance(parser);
+  if (!p_match(p_peek(parser), T_LEFT_BRACE)) {
+    compile_error(p_peek(parser), "while loops require a block");
+  }
+  Node* body = parse_block_stmt(parser);
+  return mk_while_stmt(cond, body, NULL);
+}
+
+Node* parse_for_stmt(Parser* parser) {
+  assert(p_match(p_peek(parser), T_FOR));
+  p_advance(parser);
+  if (!p_match(p_peek(parser), T_LEFT_PAREN)) {
+    compile_error(p_peek(parser), "for loops require an opening paren");
+  }
+  p_advance(parser);
+  ArrayList* nodes = init_list(2);
+  // the initializer, a declaration or an expression, brings its own semicolon
+  if (p_match(p_peek(parser), T_LET)) {
+    add_list(nodes, parse_var_decl(parser));
+  } else if (!p_match(p_peek(parser), T_SEMICOLON)) {
+    add_list(nodes, parse_expr(parser));
+    if (!p_match(p_peek(parser), T_SEMICOLON)) {
+      compile_error(p_peek(parser), "expected a semicolon after the for initializer");
+    }
+    p_advance(parser);
+  } else {
+    p_advance(parser);
+  }
+  Node* cond = parse_binary_expr(parser);
+  if (!p_match(p_peek(parser), T_SEMICOLON)) {
+    compile_error(p_peek(parser), "expected a semicolon after the for condition");
+  }
+  p_advance(parser);
+  Node* step = NULL;
+  if (!p_match(p_peek(parser), T_RIGHT_PAREN)) {
+    step = parse_update_expr(parser);
+  }
+  if (!p_match(p_peek(parser), T_RIGHT_PAREN)) {
+    compile_error(p_peek(parser), "for loops require a closing paren");
+  }
+  p_advance(parser);
+  if (!p_match(p_peek(parser), T_LEFT_BRACE)) {
+    compile_error(p_peek(parser), "for loops require a block");
+  }
+  Node* body = parse_block_stmt(parser);
+  // the block scopes a declared loop variable to the loop
+  add_list(nodes, mk_while_stmt(cond, body, step));
+  return mk_block_stmt(nodes);
+}
+
 Node* parse_literal_expr(Parser* parser) {
   Token* temp = p_peek(parser);
   if (!p_match(temp, T_STRING_LIT) && !p_match(temp, T_NUMBER_LIT)) {
@@ -462,6 +788,15 @@ Node* parse_primary(Parser* parser) {
   if (p_match(temp, T_NUMBER_LIT) || p_match(temp, T_STRING_LIT)) {
     return parse_literal_expr(parser);
   }
+  if (p_match(temp, T_LEFT_BRACKET)) {
+    p_advance(parser);
+    Node* addr = parse_binary_expr(parser);
+    if (!p_match(p_peek(parser), T_RIGHT_BRACKET)) {
+      compile_error(p_peek(parser), "expected closing ] after dereferenced address");
+    }
+    p_advance(parser);
+    return mk_unary_expr(U_DEREF, addr);
+  }
   if (p_match(temp, T_LEFT_PAREN)) {
     p_advance(parser);
     Node* inner = parse_assign_expr(parser);
@@ -497,7 +832,7 @@ Node* parse_unary_expr(Parser* parser) {
   }
   if (p_match(temp, T_PLUS_PLUS)) {
     p_advance(parser);
-    return mk_unary_expr(U_PLUS_PLUS, parse_unary_expr(parser));
+    return mk_update(temp, parse_unary_expr(parser), B_ADD, mk_literal_expr("1", NULL));
   }
   if (p_match(temp, T_MINUS)) {
     p_advance(parser);
@@ -505,12 +840,16 @@ Node* parse_unary_expr(Parser* parser) {
   }
   if (p_match(temp, T_MINUS_MINUS)) {
     p_advance(parser);
-    return mk_unary_expr(U_MINUS_MINUS, parse_unary_expr(parser));
+    return mk_update(temp, parse_unary_expr(parser), B_SUB, mk_literal_expr("1", NULL));
   }
   if (p_match(temp, T_NOT)) {
     p_advance(parser);
     return mk_unary_expr(U_NOT, parse_unary_expr(parser));
   }
+  if (p_match(temp, T_TILDE)) {
+    p_advance(parser);
+    return mk_unary_expr(U_BIT_NOT, parse_unary_expr(parser));
+  }
   if (p_match(temp, T_AND)) {
     p_advance(parser);
     return mk_unary_expr(U_ADDR, parse_unary_expr(parser));
@@ -558,29 +897,54 @@ Node* parse_term(Parser* parser) {
   return left;
 }
 
-Node* parse_compare(Parser* parser) {
+Node* parse_shift(Parser* parser) {
   Node* left = parse_term(parser);
   Token* temp = p_peek(parser);
+  while (true) {
+    temp = p_peek(parser);
+    if (p_match(temp, T_LESS_LESS)) {
+      p_advance(parser);
+      left = mk_binary_expr(B_SHL, left, parse_term(parser));
+      continue;
+    }
+    if (p_match(temp, T_GREATER_GREATER)) {
+      p_advance(parser);
+      left = mk_binary_expr(B_SAR, left, parse_term(parser));
+      continue;
+    }
+    if (p_match(temp, T_GREATER_GREATER_GREATER)) {
+      p_advance(parser);
+      left = mk_binary_expr(B_SHR, left, parse_term(parser));
+      continue;
+    }
+    break;
+  }
+  return left;
+}
+
+Node* parse_compare(Parser* parser) {
+  Node* left = parse_shift(parser);
+  Token* temp = p_peek(parser);
   while (true) {
     temp = p_peek(parser);
     if (p_match(temp, T_GREATER)) {
       p_advance(parser);
-      left = mk_binary_expr(B_GREATER, left, parse_term(parser)); 
+      left = mk_binary_expr(B_GREATER, left, parse_shift(parser)); 
       continue;
     }
     if (p_match(temp, T_LESS)) {
       p_advance(parser);
-      left = mk_binary_expr(B_LESS, left, parse_term(parser));
+      left = mk_binary_expr(B_LESS, left, parse_shift(parser));
       continue;
     }
     if (p_match(temp, T_GREATER_EQUAL)) {
       p_advance(parser);
-      left = mk_binary_expr(B_GEQ, left, parse_term(parser));
+      left = mk_binary_expr(B_GEQ, left, parse_shift(parser));
       continue;
     }
     if (p_match(temp, T_LESS_EQUAL)) {
       p_advance(parser);
-      left = mk_binary_expr(B_LEQ, left, parse_term(parser));
+      left = mk_binary_expr(B_LEQ, left, parse_shift(parser));
       continue;
     } 
     break;
@@ -608,8 +972,52 @@ Node* parse_equal(Parser* parser) {
   return left;
 }
 
+Node* parse_bit_and(Parser* parser) {
+  Node* left = parse_equal(parser);
+  while (p_match(p_peek(parser), T_AND)) {
+    p_advance(parser);
+    left = mk_binary_expr(B_AND, left, parse_equal(parser));
+  }
+  return left;
+}
+
+Node* parse_bit_xor(Parser* parser) {
+  Node* left = parse_bit_and(parser);
+  while (p_match(p_peek(parser), T_CARET)) {
+    p_advance(parser);
+    left = mk_binary_expr(B_XOR, left, parse_bit_and(parser));
+  }
+  return left;
+}
+
+Node* parse_bit_or(Parser* parser) {
+  Node* left = parse_bit_xor(parser);
+  while (p_match(p_peek(parser), T_PIPE)) {
+    p_advance(parser);
+    left = mk_binary_expr(B_OR, left, parse_bit_xor(parser));
+  }
+  return left;
+}
+
 Node* parse_binary_expr(Parser* parser) {
-  return parse_equal(parser);
+  return parse_bit_or(parser);
+}
+
+/// the operator a compound assignment token applies
+static bool compound_op(Token* token, binary_expr_t* op) {
+  switch (token ? token->type : T_UNKNOWN) {
+    case T_PLUS_EQUAL:                      *op = B_ADD; return true;
+    case T_MINUS_EQUAL:                     *op = B_SUB; return true;
+    case T_STAR_EQUAL:                      *op = B_MUL; return true;
+    case T_DIVIDE_EQUAL:                    *op = B_DIV; return true;
+    case T_AND_EQUAL:                       *op = B_AND; return true;
+    case T_PIPE_EQUAL:                      *op = B_OR;  return true;
+    case T_CARET_EQUAL:                     *op = B_XOR; return true;
+    case T_LESS_LESS_EQUAL:                 *op = B_SHL; return true;
+    case T_GREATER_GREATER_EQUAL:           *op = B_SAR; return true;
+    case T_GREATER_GREATER_GREATER_EQUAL:   *op = B_SHR; return true;
+    default: return false;
+  }
 }
 
 Node* parse_assign_expr(Parser* parser) {
@@ -617,15 +1025,32 @@ Node* parse_assign_expr(Parser* parser) {
   Token* temp = p_peek(parser);
   if (p_match(temp, T_EQUAL)) {
     p_advance(parser);
-    if (!left || (left->type != AST_IDENTIFIER && left->type != AST_INDEX)) {
+    if (!is_assignable(left)) {
       compile_error(p_peek(parser), "left side of = must be assignable");
     } 
     Node* value = parse_assign_expr(parser);
     return mk_assign_expr(left, value);
   }
+  binary_expr_t op;
+  if (compound_op(temp, &op)) {
+    p_advance(parser);
+    return mk_update(temp, left, op, parse_assign_expr(parser));
+  }
   return left;
 }
 
+Node* parse_update_expr(Parser* parser) {
+  Node* expr = parse_assign_expr(parser);
+  Token* temp = p_peek(parser);
+  // only allowed where the value is thrown away, so it can mean the same as ++x
+  if (p_match(temp, T_PLUS_PLUS) || p_match(temp, T_MINUS_MINUS)) {
+    p_advance(parser);
+    binary_expr_t op = p_match(temp, T_PLUS_PLUS) ? B_ADD : B_SUB;
+    return mk_update(temp, expr, op, mk_literal_expr("1", NULL));
+  }
+  return expr;
+}
+
 Node* parse_expr(Parser* parser) {
   Token* temp = p_peek(parser);
   if (!temp) { std_compile_error("expected an expression"); }
@@ -635,7 +1060,7 @@ Node* parse_expr(Parser* parser) {
   if (p_match(temp, T_LEFT_BRACE)) {
     return parse_block_stmt(parser);
   }
-  return parse_assign_expr(parser);
+  return parse_update_expr(parser);
 }
 
 Node* parse_comment_stmt(Parser* parser) {
@@ -650,6 +1075,12 @@ Node* parse_statment(Parser* parser) {
   if (p_match(temp, T_IF)) {
     return parse_if_stmt(parser);
   }
+  if (p_match(temp, T_WHILE)) {
+    return parse_while_stmt(parser);
+  }
+  if (p_match(temp, T_FOR)) {
+    return parse_for_stmt(parser);
+  }
   if (p_match(temp, T_COMMENT)) {
     return parse_comment_stmt(parser);
   }
@@ -816,26 +1247,234 @@ Node* parse_func_decl(Parser* parser) {
   return NULL;
 }
 
+static Node* parse_top_decl(Parser* parser) {
+  if (p_match(p_peek(parser), T_FUNC)) {
+    return parse_func_decl(parser);
+  } else if (p_match(p_peek(parser), T_LET)) {
+    return parse_var_decl(parser);
+  } else if (p_match(p_peek(parser), T_COMMENT)) {
+    return parse_comment_stmt(parser);
+  }
+  compile_error(p_peek(parser), "only varibles and function can be declared in global scope");
+  return NULL;
+}
+
 Node* parse_program(ArrayList* nodes) {
   Parser* parser = init_parser(nodes);
   ArrayList* p_nodes = init_list(128);
-  Node* temp = NULL;
   while(!p_is_end(parser) && !p_match(p_peek(parser), T_EOF)) {
-    if (p_match(p_peek(parser), T_FUNC)) {
-      temp = parse_func_decl(parser);
-    } else if (p_match(p_peek(parser), T_LET)) {
-      temp = parse_var_decl(parser);
+    add_list(p_nodes, parse_top_decl(parser));
+  }
+  Node* program = mk_program_decl(p_nodes);
+  assert(program != NULL);
+  free(parser);
+  return program;
+}
+
+static Token_type token_at(ArrayList* tokens, unsigned long long idx) {
+  return ((Token*)get_list(tokens, idx))->type;
+}
+
+/// index one past the token that closes the declaration starting at idx
+/// @return 0 if the declaration is never closed
+static unsigned long long decl_end(ArrayList* tokens, unsigned long long idx) {
+  unsigned long long len = tokens->length;
+  Token_type kind = token_at(tokens, idx);
+  if (kind == T_COMMENT) { return idx + 1; }
+  if (kind != T_FUNC && kind != T_LET) {
+    // not a declaration, parse_decl_range reports the error
+    return idx + 1;
+  }
+  int depth = 0;
+  for (unsigned long long i = idx + 1; i < len; i++) {
+    Token_type t = token_at(tokens, i);
+    if (t == T_EOF) { return 0; }
+    if (t == T_LEFT_BRACE) { depth++; }
+    if (t == T_RIGHT_BRACE && --depth == 0 && kind == T_FUNC) { return i + 1; }
+    if (t == T_SEMICOLON && depth == 0 && kind == T_LET) { return i + 1; }
+    // a declaration keyword at depth 0 means this one was never closed
+    if (depth == 0 && (t == T_FUNC || (t == T_LET && kind == T_FUNC))) { return 0; }
+  }
+  return 0;
+}
+
+ArrayList* find_decl_ranges(ArrayList* tokens) {
+  ArrayList* ranges = init_list(128);
+  unsigned long long idx = 0;
+  while (idx < tokens->length && token_at(tokens, idx) != T_EOF) {
+    unsigned long long end = decl_end(tokens, idx);
+    if (end == 0) {
+      destroy_list(ranges);
+      return NULL;
+    }
+    decl_range* r = malloc(sizeof(decl_range));
+    r->kind = token_at(tokens, idx);
+    r->start = idx;
+    r->end = end;
+    add_list(ranges, r);
+    idx = end;
+  }
+  return ranges;
+}
+
+/// a parser that stops at the end of a token range instead of the token list
+static Parser* init_range_parser(ArrayList* tokens, unsigned long long start, unsigned long long end) {
+  Parser* parser = init_parser(tokens);
+  parser->idx = start;
+  parser->cur_tok = (Token*)get_list(tokens, start);
+  parser->size = end;
+  return parser;
+}
 
-    } else if (p_match(p_peek(parser), T_COMMENT)) {
-      temp = parse_comment_stmt(parser);
+Node* parse_decl_range(ArrayList* tokens, decl_range* range) {
+  Parser* parser = init_range_parser(tokens, range->start, range->end);
+  Node* node = parse_top_decl(parser);
+  if (!p_is_end(parser)) {
+    compile_error(p_peek(parser), "only varibles and function can be declared in global scope");
+  }
+  free(parser);
+  return node;
+}
+
+typedef struct {
+  ArrayList* tokens;
+  decl_range* range;
+  Node* sig;                ///< signature parsed up front, NULL to parse the whole range
+  unsigned long long body;  ///< index of the body's opening brace when sig is set
+  Node* result;
+} parse_job;
+
+static void parse_job_run(void* arg) {
+  parse_job* job = (parse_job*)arg;
+  if (!job->sig) {
+    job->result = parse_decl_range(job->tokens, job->range);
+    return;
+  }
+  Parser* parser = init_range_parser(job->tokens, job->body, job->range->end);
+  Node* block = parse_block_stmt(parser);
+  if (!block_has_ret(block)) {
+    std_compile_error("functions require a return stmt");
+  }
+  free(parser);
+  job->result = mk_func_decl(job->sig, block);
+}
+
+/// runs the parse jobs, concurrently when there is more than one worker, and
+/// assembles the results into a program node in job order
+static Node* run_parse_jobs(parse_job* work, unsigned int n, unsigned int jobs) {
+  if (jobs == 0) { jobs = online_cpus(); }
+  if (jobs > n) { jobs = n; }
+  // nodes are allocated with plain malloc, which already gives every
+  // worker thread its own arena, so parsers do not contend on the heap
+  threadpool_t* pool = jobs > 1 ? pool_create(jobs) : NULL;
+  for (unsigned int i = 0; i < n; i++) {
+    if (pool) {
+      pool_submit(pool, parse_job_run, &work[i]);
     } else {
-      compile_error(p_peek(parser), "only varibles and function can be declared in global scope");
+      parse_job_run(&work[i]);
     }
-    add_list(p_nodes, temp);
   }
-  Node* program = mk_program_decl(p_nodes);
-  assert(program != NULL);
+  if (pool) { pool_destroy(pool); }
+  ArrayList* p_nodes = init_list(n > 128 ? n : 128);
+  for (unsigned int i = 0; i < n; i++) {
+    add_list(p_nodes, work[i].result);
+  }
+  return mk_program_decl(p_nodes);
+}
+
+Node* parse_program_parallel(ArrayList* tokens, unsigned int jobs) {
+  ArrayList* ranges = find_decl_ranges(tokens);
+  if (!ranges) {
+    // let the sequential parser report the unbalanced declaration
+    return parse_program(tokens);
+  }
+  unsigned int n = ranges->length;
+  parse_job* work = calloc(n ? n : 1, sizeof(parse_job));
+  for (unsigned int i = 0; i < n; i++) {
+    work[i].tokens = tokens;
+    work[i].range = (decl_range*)get_list(ranges, i);
+  }
+  Node* program = run_parse_jobs(work, n, jobs);
+  free(work);
+  destroy_list(ranges);
+  return program;
+}
+
+/// the name of a function is the first identifier of its signature
+static Token* func_name_token(ArrayList* tokens, decl_range* range) {
+  for (unsigned long long t = range->start + 1; t < range->end; t++) {
+    Token* tok = (Token*)get_list(tokens, t);
+    if (tok->type == T_IDENTIFIER) { return tok; }
+  }
+  return NULL;
+}
+
+/// marks a function as needed and queues it so its callees are visited
+static void need_func(hashtable_t* by_name, parse_job* work, ArrayList* queue, const char* name) {
+  unsigned int* idx = (unsigned int*)get_ht(by_name, name);
+  if (!idx || work[*idx].sig) { return; }
+  parse_job* job = &work[*idx];
+  Parser* parser = init_range_parser(job->tokens, job->range->start + 1, job->range->end);
+  job->sig = parse_func_type(parser);
+  job->body = parser->idx;
   free(parser);
+  add_list(queue, job);
+}
+
+Node* parse_program_lazy(ArrayList* tokens, ArrayList* roots, unsigned int jobs) {
+  ArrayList* ranges = find_decl_ranges(tokens);
+  if (!ranges) {
+    return parse_program(tokens);
+  }
+  unsigned int n = ranges->length;
+  parse_job* work = calloc(n ? n : 1, sizeof(parse_job));
+  hashtable_t* by_name = create_ht(n > 64 ? 2 * n : 128);
+  for (unsigned int i = 0; i < n; i++) {
+    work[i].tokens = tokens;
+    work[i].range = (decl_range*)get_list(ranges, i);
+    if (work[i].range->kind != T_FUNC) { continue; }
+    Token* name = func_name_token(tokens, work[i].range);
+    if (name && !get_ht(by_name, name->lexeme)) {
+      unsigned int* idx = malloc(sizeof(unsigned int));
+      *idx = i;
+      add_ht(by_name, name->lexeme, idx);
+    }
+  }
+
+  // only signatures are parsed while walking the call graph, callees are
+  // found by scanning the body's tokens for "call <name>"
+  ArrayList* queue = init_list(64);
+  for (unsigned int i = 0; i < n; i++) {
+    Token* name = work[i].range->kind == T_FUNC ? func_name_token(tokens, work[i].range) : NULL;
+    if (!name) { continue; }
+    bool root = !roots;
+    for (unsigned int r = 0; roots && r < roots->length && !root; r++) {
+      root = strcmp((const char*)get_list(roots, r), name->lexeme) == 0;
+    }
+    if (root) { need_func(by_name, work, queue, name->lexeme); }
+  }
+  while (queue->length > 0) {
+    parse_job* job = (parse_job*)queue->items[--queue->length];
+    for (unsigned long long t = job->body; t + 1 < job->range->end; t++) {
+      Token* tok = (Token*)get_list(tokens, t);
+      Token* next = (Token*)get_list(tokens, t + 1);
+      if (tok->type == T_CALL && next->type == T_IDENTIFIER) {
+        need_func(by_name, work, queue, next->lexeme);
+      }
+    }
+  }
+  free(queue->items);
+  free(queue);
+  destroy_ht(by_name);
+
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < n; i++) {
+    if (work[i].range->kind == T_FUNC && !work[i].sig) { continue; }
+    work[kept++] = work[i];
+  }
+  Node* program = run_parse_jobs(work, kept, jobs);
+  free(work);
+  destroy_list(ranges);
   return program;
 }
 
@@ -884,7 +1523,8 @@ bool p_match(Token* token, Token_type type) {
 bool is_var_type(Token* token) {
   if (!token) { return false; }
   Token_type tt = token->type;
-  return tt == T_AND || tt == T_BYTE || tt == T_WORD || tt == T_DWORD || tt == T_QWORD;
+  return tt == T_AND || tt == T_BYTE || tt == T_WORD || tt == T_DWORD || tt == T_QWORD ||
+         tt == T_V128 || tt == T_V256;
 }
 
 static void print_block_stmt(Node* node, const int depth);
@@ -944,6 +1584,10 @@ static const char* get_var_t(Node* node) {
         base = "DWORD"; break;
       case LIT_QWORD:
         base = "QWORD"; break;
+      case LIT_V128:
+        base = "V128"; break;
+      case LIT_V256:
+        base = "V256"; break;
       default:
         base = "QWORD"; break;
     }
@@ -1050,6 +1694,10 @@ static const char* get_unary_op(Node* node) {
       return "!";
     case U_ADDR:
       return "&";
+    case U_DEREF:
+      return "[]";
+    case U_BIT_NOT:
+      return "~";
     default:
       std_compile_error("obtained an unusable unary expression");
   }
@@ -1091,6 +1739,18 @@ static const char* get_binary_op(Node* node) {
       return ">=";
     case B_LEQ:
       return "<=";
+    case B_AND:
+      return "&";
+    case B_OR:
+      return "|";
+    case B_XOR:
+      return "^";
+    case B_SHL:
+      return "<<";
+    case B_SAR:
+      return ">>";
+    case B_SHR:
+      return ">>>";
     default:
       std_compile_error("obtained an unusable bin expression");
   } 
@@ -1160,11 +1820,26 @@ static void print_if_stmt(Node* node, const int depth) {
   }
 }
 
+static void print_while_stmt(Node* node, const int depth) {
+  assert(node->type == AST_WHILE);
+  while_stmt whileStmt = node->whileStmt;
+  print_with_indent_s("WHILESTMT:", depth);
+  print_binary_expr(whileStmt.cond, depth + 1);
+  print_block_stmt(whileStmt.body, depth + 1);
+  if (whileStmt.step) {
+    print_with_indent_s("STEP:", depth);
+    print_expr(whileStmt.step, depth + 1);
+  }
+}
+
 static void print_stmt(Node* node, const int depth) {
   switch(node->type) {
     case AST_IF:
       print_if_stmt(node, 1 + depth);
       break;
+    case AST_WHILE:
+      print_while_stmt(node, 1 + depth);
+      break;
     case AST_RETURN:
       print_return_stmt(node, 1 + depth);
       break;
@@ -1234,3 +1909,159 @@ void print_ast(Node* head) {
     }
   }
 }
+
+static const char* const unary_op_names[] = { "+", "++", "--", "-", "!", "&", "[]", "~" };
+static const char* const binary_op_names[] = { "+", "-", "*", "/", "<", ">", "==", "!=", ">=", "<=",
+                                                 "&", "|", "^", "<<", ">>", ">>>" };
+static const char* const lit_names[] = { "STRING", "BYTE", "WORD", "DWORD", "QWORD", "V128", "V256" };
+
+static void write_node_json(FILE* out, Node* node);
+
+static void write_node_list_json(FILE* out, ArrayList* list) {
+  fputc('[', out);
+  for (int i = 0; list && i < list->length; i++) {
+    if (i > 0) { fputc(',', out); }
+    write_node_json(out, (Node*)get_list(list, i));
+  }
+  fputc(']', out);
+}
+
+/// writes ,"key": followed by a node
+static void write_field_json(FILE* out, const char* key, Node* node) {
+  fprintf(out, ",\"%s\":", key);
+  write_node_json(out, node);
+}
+
+/// writes ,"key":"name" for an identifier, which reads better than a
+/// nested ident object
+static void write_name_json(FILE* out, const char* key, Node* ident) {
+  if (!ident || ident->type != AST_IDENTIFIER) {
+    write_field_json(out, key, ident);
+    return;
+  }
+  fprintf(out, ",\"%s\":", key);
+  json_write_str(out, ident->identifierExpr.name);
+}
+
+static void write_node_json(FILE* out, Node* node) {
+  if (!node) {
+    fputs("null", out);
+    return;
+  }
+  switch (node->type) {
+    case AST_PROGRAM:
+      fputs("{\"kind\":\"program\",\"decls\":", out);
+      write_node_list_json(out, node->programDecl.nodes);
+      break;
+    case AST_VAR_DECL:
+      fputs("{\"kind\":\"var_decl\"", out);
+      write_name_json(out, "name", node->varDecl.ident);
+      write_field_json(out, "type", node->varDecl.type);
+      write_field_json(out, "init", node->varDecl.assign);
+      break;
+    case AST_FUNC_DECL:
+      fputs("{\"kind\":\"func_decl\"", out);
+      write_field_json(out, "signature", node->funcDecl.type);
+      write_field_json(out, "body", node->funcDecl.block);
+      break;
+    case AST_BLOCK:
+      fputs("{\"kind\":\"block\",\"stmts\":", out);
+      write_node_list_json(out, node->blockStmt.nodes);
+      break;
+    case AST_IF:
+      fputs("{\"kind\":\"if\"", out);
+      write_field_json(out, "cond", node->ifStmt.cond);
+      write_field_json(out, "then", node->ifStmt.then_branch);
+      write_field_json(out, "else", node->ifStmt.else_branch);
+      break;
+    case AST_WHILE:
+      fputs("{\"kind\":\"while\"", out);
+      write_field_json(out, "cond", node->whileStmt.cond);
+      write_field_json(out, "body", node->whileStmt.body);
+      write_field_json(out, "step", node->whileStmt.step);
+      break;
+    case AST_RETURN:
+      fputs("{\"kind\":\"return\"", out);
+      write_field_json(out, "value", node->returnStmt.return_val);
+      break;
+    case AST_COMMENT:
+      fputs("{\"kind\":\"comment\",\"text\":", out);
+      json_write_str(out, node->commentStmt.comment);
+      break;
+    case AST_IDENTIFIER:
+      fputs("{\"kind\":\"ident\",\"name\":", out);
+      json_write_str(out, node->identifierExpr.name);
+      break;
+    case AST_LITERAL:
+      if (node->literalExpr.str_value) {
+        fputs("{\"kind\":\"literal\",\"string\":", out);
+        json_write_str(out, node->literalExpr.str_value);
+      } else {
+        fprintf(out, "{\"kind\":\"literal\",\"value\":%lld", node->literalExpr.num_value);
+      }
+      break;
+    case AST_UNARY:
+      fprintf(out, "{\"kind\":\"unary\",\"op\":\"%s\"", unary_op_names[node->unaryExpr.op]);
+      write_field_json(out, "expr", node->unaryExpr.expr);
+      break;
+    case AST_BINARY:
+      fprintf(out, "{\"kind\":\"binary\",\"op\":\"%s\"", binary_op_names[node->binaryExpr.op]);
+      write_field_json(out, "left", node->binaryExpr.expr_left);
+      write_field_json(out, "right", node->binaryExpr.expr_right);
+      break;
+    case AST_ASSIGN:
+      fputs("{\"kind\":\"assign\"", out);
+      write_field_json(out, "target", node->assignExpr.target);
+      write_field_json(out, "value", node->assignExpr.val);
+      break;
+    case AST_CALL:
+      fputs("{\"kind\":\"call\"", out);
+      write_name_json(out, "callee", node->callExpr.callee);
+      fputs(",\"args\":", out);
+      write_node_list_json(out, node->callExpr.args);
+      break;
+    case AST_CAST:
+      fputs("{\"kind\":\"cast\"", out);
+      write_field_json(out, "type", node->castExpr.var_t);
+      write_field_json(out, "expr", node->castExpr.inner);
+      break;
+    case AST_FUNC_PARAM:
+      fputs("{\"kind\":\"param\"", out);
+      write_name_json(out, "name", node->funcParam.ident);
+      write_field_json(out, "type", node->funcParam.type);
+      break;
+    case AST_ARRAY_LIT:
+      fputs("{\"kind\":\"array\",\"elements\":", out);
+      write_node_list_json(out, node->arrayLit.elements);
+      break;
+    case AST_INDEX:
+      fputs("{\"kind\":\"index\"", out);
+      write_field_json(out, "target", node->arrayIndex.target);
+      write_field_json(out, "index", node->arrayIndex.index);
+      break;
+    case AST_TYPE_VAR: {
+      var_t t = node->variable_t;
+      const char* name = t.is_adr ? lit_names[t.type_adr + 1] : lit_names[t.type];
+      fprintf(out, "{\"kind\":\"type\",\"name\":\"%s\",\"address\":%s", name, t.is_adr ? "true" : "false");
+      if (t.is_array) { fprintf(out, ",\"array_len\":%u", t.array_len); }
+      break;
+    }
+    case AST_TYPE_FUNC:
+      fputs("{\"kind\":\"func_type\"", out);
+      write_name_json(out, "name", node->function_t.ident);
+      write_field_json(out, "ret", node->function_t.ret_t);
+      fputs(",\"params\":", out);
+      write_node_list_json(out, node->function_t.params);
+      break;
+  }
+  fputc('}', out);
+}
+
+void dump_ast_json(FILE* out, Node* head) {
+  assert(head->type == AST_PROGRAM);
+  ArrayList* nodes = head->programDecl.nodes;
+  for (int i = 0; i < nodes->length; i++) {
+    write_node_json(out, (Node*)get_list(nodes, i));
+    fputc('\n', out);
+  }
+}
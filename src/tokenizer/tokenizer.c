@@ -6,6 +6,7 @@
 #include "tokenizer/tokenizer.h"
 #include "utils/arraylist.h"
 #include "tokenizer/tokens.h"
+#include "utils/json.h"
 
 static hashtable_t* token_hash = NULL;
 
@@ -23,9 +24,13 @@ void initTokenMap(void) {
   add_ht(token_hash, "WORD", createTokenType(T_WORD));
   add_ht(token_hash, "DWORD", createTokenType(T_DWORD));
   add_ht(token_hash, "QWORD", createTokenType(T_QWORD));
+  add_ht(token_hash, "V128", createTokenType(T_V128));
+  add_ht(token_hash, "V256", createTokenType(T_V256));
   add_ht(token_hash, "return", createTokenType(T_RETURN));
   add_ht(token_hash, "if", createTokenType(T_IF));
   add_ht(token_hash, "else", createTokenType(T_ELSE));
+  add_ht(token_hash, "while", createTokenType(T_WHILE));
+  add_ht(token_hash, "for", createTokenType(T_FOR));
   add_ht(token_hash, "fn", createTokenType(T_FUNC));
 }
 
@@ -184,33 +189,50 @@ Token* scanToken(Tokenizer* tokenizer) {
       return createToken(T_DOT, tokenizer);
       break;
     case '-':
+      if (match(tokenizer, '=')) { return createToken(T_MINUS_EQUAL, tokenizer); }
       return createToken(match(tokenizer, '-') ? T_MINUS_MINUS : T_MINUS, tokenizer);
       break;
     case '+':
+      if (match(tokenizer, '=')) { return createToken(T_PLUS_EQUAL, tokenizer); }
       return createToken(match(tokenizer, '+') ? T_PLUS_PLUS : T_PLUS, tokenizer);
       break;
     case '*':
-      return createToken(T_STAR, tokenizer);
+      return createToken(match(tokenizer, '=') ? T_STAR_EQUAL : T_STAR, tokenizer);
       break;
     case '/':
       if (match(tokenizer, '/')) {
         return createCommentToken(tokenizer);
       } else {
-        return createToken(T_DIVIDE, tokenizer);
+        return createToken(match(tokenizer, '=') ? T_DIVIDE_EQUAL : T_DIVIDE, tokenizer);
       } 
       break;
     case ':':
       return createToken(T_COLON, tokenizer);
       break;
     case '&':
-      return createToken(T_AND, tokenizer);
+      return createToken(match(tokenizer, '=') ? T_AND_EQUAL : T_AND, tokenizer);
+    case '|':
+      return createToken(match(tokenizer, '=') ? T_PIPE_EQUAL : T_PIPE, tokenizer);
+    case '^':
+      return createToken(match(tokenizer, '=') ? T_CARET_EQUAL : T_CARET, tokenizer);
+    case '~':
+      return createToken(T_TILDE, tokenizer);
     case '!':
       return createToken(match(tokenizer, '=') ? T_NOT_EQUAL : T_NOT, tokenizer);
       break;
     case '>':
+      if (match(tokenizer, '>')) {
+        if (match(tokenizer, '>')) {
+          return createToken(match(tokenizer, '=') ? T_GREATER_GREATER_GREATER_EQUAL : T_GREATER_GREATER_GREATER, tokenizer);
+        }
+        return createToken(match(tokenizer, '=') ? T_GREATER_GREATER_EQUAL : T_GREATER_GREATER, tokenizer);
+      }
       return createToken(match(tokenizer, '=') ? T_GREATER_EQUAL : T_GREATER, tokenizer);
       break;
     case '<':
+      if (match(tokenizer, '<')) {
+        return createToken(match(tokenizer, '=') ? T_LESS_LESS_EQUAL : T_LESS_LESS, tokenizer);
+      }
       return createToken(match(tokenizer, '=') ? T_LESS_EQUAL : T_LESS, tokenizer);
       break;
     case '=':
@@ -281,3 +303,84 @@ ArrayList* tokenize(FILE* sourcefile, unsigned long char_count) {
 	return tokens;
 }
 
+
+static const char* const token_type_names[] = {
+  [T_UNKNOWN] = "T_UNKNOWN",
+  [T_EOF] = "T_EOF",
+  [T_IDENTIFIER] = "T_IDENTIFIER",
+  [T_COMMENT] = "T_COMMENT",
+  [T_IF] = "T_IF",
+  [T_ELSE] = "T_ELSE",
+  [T_LET] = "T_LET",
+  [T_CALL] = "T_CALL",
+  [T_FUNC] = "T_FUNC",
+  [T_BYTE] = "T_BYTE",
+  [T_WORD] = "T_WORD",
+  [T_DWORD] = "T_DWORD",
+  [T_QWORD] = "T_QWORD",
+  [T_V128] = "T_V128",
+  [T_V256] = "T_V256",
+  [T_STRING_LIT] = "T_STRING_LIT",
+  [T_NUMBER_LIT] = "T_NUMBER_LIT",
+  [T_RETURN] = "T_RETURN",
+  [T_WHILE] = "T_WHILE",
+  [T_FOR] = "T_FOR",
+  [T_SEMICOLON] = "T_SEMICOLON",
+  [T_COLON] = "T_COLON",
+  [T_EQUAL] = "T_EQUAL",
+  [T_LEFT_PAREN] = "T_LEFT_PAREN",
+  [T_RIGHT_PAREN] = "T_RIGHT_PAREN",
+  [T_LEFT_BRACE] = "T_LEFT_BRACE",
+  [T_RIGHT_BRACE] = "T_RIGHT_BRACE",
+  [T_LEFT_BRACKET] = "T_LEFT_BRACKET",
+  [T_RIGHT_BRACKET] = "T_RIGHT_BRACKET",
+  [T_COMMA] = "T_COMMA",
+  [T_AND] = "T_AND",
+  [T_DOT] = "T_DOT",
+  [T_MINUS] = "T_MINUS",
+  [T_MINUS_MINUS] = "T_MINUS_MINUS",
+  [T_PLUS] = "T_PLUS",
+  [T_PLUS_PLUS] = "T_PLUS_PLUS",
+  [T_STAR] = "T_STAR",
+  [T_DIVIDE] = "T_DIVIDE",
+  [T_GREATER] = "T_GREATER",
+  [T_LESS] = "T_LESS",
+  [T_NOT] = "T_NOT",
+  [T_PIPE] = "T_PIPE",
+  [T_CARET] = "T_CARET",
+  [T_TILDE] = "T_TILDE",
+  [T_EQUAL_EQUAL] = "T_EQUAL_EQUAL",
+  [T_NOT_EQUAL] = "T_NOT_EQUAL",
+  [T_LESS_EQUAL] = "T_LESS_EQUAL",
+  [T_GREATER_EQUAL] = "T_GREATER_EQUAL",
+  [T_LESS_LESS] = "T_LESS_LESS",
+  [T_GREATER_GREATER] = "T_GREATER_GREATER",
+  [T_PLUS_EQUAL] = "T_PLUS_EQUAL",
+  [T_MINUS_EQUAL] = "T_MINUS_EQUAL",
+  [T_STAR_EQUAL] = "T_STAR_EQUAL",
+  [T_DIVIDE_EQUAL] = "T_DIVIDE_EQUAL",
+  [T_AND_EQUAL] = "T_AND_EQUAL",
+  [T_PIPE_EQUAL] = "T_PIPE_EQUAL",
+  [T_CARET_EQUAL] = "T_CARET_EQUAL",
+  [T_GREATER_GREATER_GREATER] = "T_GREATER_GREATER_GREATER",
+  [T_LESS_LESS_EQUAL] = "T_LESS_LESS_EQUAL",
+  [T_GREATER_GREATER_EQUAL] = "T_GREATER_GREATER_EQUAL",
+  [T_GREATER_GREATER_GREATER_EQUAL] = "T_GREATER_GREATER_GREATER_EQUAL",
+};
+
+const char* tokenTypeName(Token_type type) {
+  size_t count = sizeof(token_type_names) / sizeof(token_type_names[0]);
+  if ((size_t)type >= count || !token_type_names[type]) {
+    return "T_UNKNOWN";
+  }
+  return token_type_names[type];
+}
+
+void dumpTokensJson(FILE* out, ArrayList* tokens) {
+  for (int i = 0; i < tokens->length; i++) {
+    Token* t = (Token*)get_list(tokens, i);
+    fprintf(out, "{\"index\":%d,\"type\":\"%s\",\"lexeme\":", i, tokenTypeName(t->type));
+    json_write_str(out, t->lexeme);
+    fprintf(out, ",\"line\":%u,\"col\":%u}\n", t->line, t->col);
+  }
+}
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include "utils/arraylist.h"
+#include "utils/stats.h"
 
 ArrayList* init_list(unsigned int capacity) {
 	
@@ -9,6 +10,8 @@ ArrayList* init_list(unsigned int capacity) {
 	array->length = 0;
 	array->capacity = capacity;
 	array->items = malloc(sizeof(void*) * capacity);
+	stat_add(STAT_LIST_ALLOCS, 1);
+	stat_add(STAT_ALLOC_BYTES, sizeof(ArrayList) + sizeof(void*) * capacity);
 	return array;
 }
 
@@ -40,6 +43,7 @@ bool add_list(ArrayList* array, void* item) {
 	if (array->length == array->capacity) {
 		unsigned int newcap = array->capacity * RESIZE_MUL;
 		array->items = realloc(array->items, sizeof(void*) * newcap);
+		stat_add(STAT_ALLOC_BYTES, sizeof(void*) * (newcap - array->capacity));
 		array->capacity = newcap;
 	}
 
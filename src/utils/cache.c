@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "utils/cache.h"
+
+#define STATS_FILE "stats"
+
+uint64_t cache_hash(uint64_t hash, const void* data, size_t len) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/// creates a directory and any missing parents
+static int make_dirs(const char* path) {
+  char* copy = strdup(path);
+  for (char* p = copy + 1; *p; p++) {
+    if (*p != '/') { continue; }
+    *p = '\0';
+    if (mkdir(copy, 0755) != 0 && errno != EEXIST) {
+      free(copy);
+      return -1;
+    }
+    *p = '/';
+  }
+  int rc = mkdir(copy, 0755) != 0 && errno != EEXIST ? -1 : 0;
+  free(copy);
+  return rc;
+}
+
+compile_cache* cache_open(const char* dir, unsigned long long max_bytes) {
+  if (make_dirs(dir) != 0) {
+    return NULL;
+  }
+  compile_cache* cache = malloc(sizeof(compile_cache));
+  cache->dir = strdup(dir);
+  cache->max_bytes = max_bytes;
+  return cache;
+}
+
+void cache_close(compile_cache* cache) {
+  if (!cache) { return; }
+  free(cache->dir);
+  free(cache);
+}
+
+static char* entry_path(compile_cache* cache, uint64_t key, const char* ext) {
+  size_t len = strlen(cache->dir) + strlen(ext) + 20;
+  char* path = malloc(len);
+  snprintf(path, len, "%s/%016llx.%s", cache->dir, (unsigned long long)key, ext);
+  return path;
+}
+
+static int copy_file(const char* src, const char* dest) {
+  FILE* in = fopen(src, "rb");
+  if (!in) { return -1; }
+  FILE* out = fopen(dest, "wb");
+  if (!out) {
+    fclose(in);
+    return -1;
+  }
+  char buf[8192];
+  size_t n;
+  int rc = 0;
+  while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+    if (fwrite(buf, 1, n, out) != n) {
+      rc = -1;
+      break;
+    }
+  }
+  if (ferror(in)) { rc = -1; }
+  fclose(in);
+  if (fclose(out) != 0) { rc = -1; }
+  return rc;
+}
+
+bool cache_fetch(compile_cache* cache, uint64_t key, const char* ext, const char* dest) {
+  char* path = entry_path(cache, key, ext);
+  bool hit = copy_file(path, dest) == 0;
+  if (hit) {
+    // the mtime is the recency that eviction goes by
+    utimensat(AT_FDCWD, path, NULL, 0);
+  }
+  free(path);
+  return hit;
+}
+
+bool cache_fetch_data(compile_cache* cache, uint64_t key, const char* ext, char** data, size_t* len) {
+  char* path = entry_path(cache, key, ext);
+  FILE* in = fopen(path, "rb");
+  if (!in) {
+    free(path);
+    return false;
+  }
+  size_t cap = 4096;
+  size_t n = 0;
+  char* buf = malloc(cap);
+  size_t got;
+  while ((got = fread(buf + n, 1, cap - n, in)) > 0) {
+    n += got;
+    if (n == cap) {
+      cap *= 2;
+      buf = realloc(buf, cap);
+    }
+  }
+  bool hit = !ferror(in);
+  fclose(in);
+  if (hit) {
+    utimensat(AT_FDCWD, path, NULL, 0);
+    *data = buf;
+    *len = n;
+  } else {
+    free(buf);
+  }
+  free(path);
+  return hit;
+}
+
+/// the name an entry is written under before it is renamed into place, so
+/// other processes never see half an entry
+static char* temp_path(const char* path) {
+  size_t len = strlen(path) + 24;
+  char* tmp = malloc(len);
+  snprintf(tmp, len, "%s.tmp%ld", path, (long)getpid());
+  return tmp;
+}
+
+bool cache_store(compile_cache* cache, uint64_t key, const char* ext, const char* src) {
+  char* path = entry_path(cache, key, ext);
+  char* tmp = temp_path(path);
+  bool stored = copy_file(src, tmp) == 0 && rename(tmp, path) == 0;
+  if (!stored) {
+    unlink(tmp);
+  }
+  free(tmp);
+  free(path);
+  if (stored) {
+    cache_evict(cache);
+  }
+  return stored;
+}
+
+bool cache_store_data(compile_cache* cache, uint64_t key, const char* ext, const void* data, size_t len) {
+  char* path = entry_path(cache, key, ext);
+  char* tmp = temp_path(path);
+  FILE* out = fopen(tmp, "wb");
+  bool stored = out != NULL;
+  if (out) {
+    stored = fwrite(data, 1, len, out) == len;
+    stored = fclose(out) == 0 && stored;
+    stored = stored && rename(tmp, path) == 0;
+  }
+  if (!stored) {
+    unlink(tmp);
+  }
+  free(tmp);
+  free(path);
+  return stored;
+}
+
+/// opens the statistics file and takes an exclusive lock on it, which also
+/// serializes eviction between processes
+static int lock_stats(compile_cache* cache) {
+  size_t len = strlen(cache->dir) + sizeof(STATS_FILE) + 1;
+  char* path = malloc(len);
+  snprintf(path, len, "%s/%s", cache->dir, STATS_FILE);
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  free(path);
+  if (fd >= 0 && flock(fd, LOCK_EX) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static cache_stats read_stats_fd(int fd) {
+  cache_stats stats = { 0, 0, 0 };
+  char buf[128];
+  ssize_t n = pread(fd, buf, sizeof(buf) - 1, 0);
+  if (n > 0) {
+    buf[n] = '\0';
+    sscanf(buf, "%llu %llu %llu", &stats.hits, &stats.misses, &stats.evictions);
+  }
+  return stats;
+}
+
+static void write_stats_fd(int fd, cache_stats stats) {
+  char buf[128];
+  int n = snprintf(buf, sizeof(buf), "%llu %llu %llu\n", stats.hits, stats.misses, stats.evictions);
+  if (ftruncate(fd, 0) == 0) {
+    pwrite(fd, buf, n, 0);
+  }
+}
+
+void cache_record(compile_cache* cache, bool hit) {
+  int fd = lock_stats(cache);
+  if (fd < 0) { return; }
+  cache_stats stats = read_stats_fd(fd);
+  if (hit) {
+    stats.hits++;
+  } else {
+    stats.misses++;
+  }
+  write_stats_fd(fd, stats);
+  close(fd);
+}
+
+cache_stats cache_read_stats(compile_cache* cache) {
+  cache_stats stats = { 0, 0, 0 };
+  int fd = lock_stats(cache);
+  if (fd < 0) { return stats; }
+  stats = read_stats_fd(fd);
+  close(fd);
+  return stats;
+}
+
+typedef struct {
+  char* path;
+  off_t size;
+  struct timespec mtime;
+} cache_entry;
+
+static int by_oldest(const void* a, const void* b) {
+  const cache_entry* x = (const cache_entry*)a;
+  const cache_entry* y = (const cache_entry*)b;
+  if (x->mtime.tv_sec != y->mtime.tv_sec) {
+    return x->mtime.tv_sec < y->mtime.tv_sec ? -1 : 1;
+  }
+  if (x->mtime.tv_nsec != y->mtime.tv_nsec) {
+    return x->mtime.tv_nsec < y->mtime.tv_nsec ? -1 : 1;
+  }
+  return 0;
+}
+
+unsigned int cache_evict(compile_cache* cache) {
+  if (cache->max_bytes == 0) { return 0; }
+  int fd = lock_stats(cache);
+  if (fd < 0) { return 0; }
+  DIR* dir = opendir(cache->dir);
+  if (!dir) {
+    close(fd);
+    return 0;
+  }
+  size_t count = 0;
+  size_t capacity = 16;
+  cache_entry* entries = malloc(sizeof(cache_entry) * capacity);
+  unsigned long long total = 0;
+  struct dirent* ent;
+  while ((ent = readdir(dir)) != NULL) {
+    // only finished entries count; the stats file and in-flight copies don't
+    if (ent->d_name[0] == '.' || strcmp(ent->d_name, STATS_FILE) == 0 || strstr(ent->d_name, ".tmp")) {
+      continue;
+    }
+    size_t len = strlen(cache->dir) + strlen(ent->d_name) + 2;
+    char* path = malloc(len);
+    snprintf(path, len, "%s/%s", cache->dir, ent->d_name);
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+      free(path);
+      continue;
+    }
+    if (count == capacity) {
+      capacity *= 2;
+      entries = realloc(entries, sizeof(cache_entry) * capacity);
+    }
+    entries[count].path = path;
+    entries[count].size = st.st_size;
+    entries[count].mtime = st.st_mtim;
+    count++;
+    total += st.st_size;
+  }
+  closedir(dir);
+
+  unsigned int evicted = 0;
+  if (total > cache->max_bytes) {
+    qsort(entries, count, sizeof(cache_entry), by_oldest);
+    for (size_t i = 0; i < count && total > cache->max_bytes; i++) {
+      if (unlink(entries[i].path) == 0) {
+        total -= entries[i].size;
+        evicted++;
+      }
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    free(entries[i].path);
+  }
+  free(entries);
+  if (evicted > 0) {
+    cache_stats stats = read_stats_fd(fd);
+    stats.evictions += evicted;
+    write_stats_fd(fd, stats);
+  }
+  close(fd);
+  return evicted;
+}
@@ -5,6 +5,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include "utils/hashtable.h"
+#include "utils/stats.h"
 #include "tokenizer/tokens.h"
 
 node_t* create_node(const char* key, void* value) {
@@ -39,6 +40,8 @@ hashtable_t* create_ht(const unsigned int capacity) {
 	hashtable->capacity = capacity;
 	hashtable->size = 0;
 	hashtable->nodes = calloc(capacity, sizeof(node_t*));
+	stat_add(STAT_HT_ALLOCS, 1);
+	stat_add(STAT_ALLOC_BYTES, sizeof(hashtable_t) + sizeof(node_t*) * capacity);
 
 	return hashtable;
 }
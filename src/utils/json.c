@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include "utils/json.h"
+
+void json_write_str(FILE* out, const char* str) {
+  if (!str) {
+    fputs("null", out);
+    return;
+  }
+  fputc('"', out);
+  for (const unsigned char* c = (const unsigned char*)str; *c; c++) {
+    switch (*c) {
+      case '"':  fputs("\\\"", out); break;
+      case '\\': fputs("\\\\", out); break;
+      case '\n': fputs("\\n", out); break;
+      case '\r': fputs("\\r", out); break;
+      case '\t': fputs("\\t", out); break;
+      default:
+        if (*c < 0x20) {
+          fprintf(out, "\\u%04x", *c);
+        } else {
+          fputc(*c, out);
+        }
+    }
+  }
+  fputc('"', out);
+}
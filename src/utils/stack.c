@@ -16,8 +16,10 @@ void* pop_stack(Stack* stack) {
   if (!stack->head) {
     return NULL;
   } else {
-    void* temp_val = stack->head->val;
-    stack->head = stack->head->next;
+    stack_node* top = stack->head;
+    void* temp_val = top->val;
+    stack->head = top->next;
+    free(top);
     return temp_val;
   }
 }
@@ -0,0 +1,15 @@
+#include <stdatomic.h>
+#include "utils/stats.h"
+
+bool stats_enabled = false;
+
+static _Atomic unsigned long long counters[STAT_COUNT];
+
+void stat_add(stat_id id, unsigned long long n) {
+  if (!stats_enabled) { return; }
+  atomic_fetch_add_explicit(&counters[id], n, memory_order_relaxed);
+}
+
+unsigned long long stat_get(stat_id id) {
+  return atomic_load_explicit(&counters[id], memory_order_relaxed);
+}
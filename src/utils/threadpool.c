@@ -0,0 +1,96 @@
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "utils/threadpool.h"
+
+unsigned int online_cpus(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (unsigned int)n : 1;
+}
+
+static void* worker(void* arg) {
+  threadpool_t* pool = (threadpool_t*)arg;
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->head && !pool->shutdown) {
+      pthread_cond_wait(&pool->has_work, &pool->lock);
+    }
+    if (!pool->head) { break; }
+    pool_task* task = pool->head;
+    pool->head = task->next;
+    if (!pool->head) { pool->tail = NULL; }
+    pthread_mutex_unlock(&pool->lock);
+
+    task->fn(task->arg);
+    free(task);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->pending == 0) {
+      pthread_cond_broadcast(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+threadpool_t* pool_create(unsigned int thread_count) {
+  if (thread_count == 0) { thread_count = online_cpus(); }
+  threadpool_t* pool = malloc(sizeof(threadpool_t));
+  assert(pool != NULL);
+  pool->threads = malloc(sizeof(pthread_t) * thread_count);
+  pool->thread_count = thread_count;
+  pool->head = NULL;
+  pool->tail = NULL;
+  pool->pending = 0;
+  pool->shutdown = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_work, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  for (unsigned int i = 0; i < thread_count; i++) {
+    pthread_create(&pool->threads[i], NULL, worker, pool);
+  }
+  return pool;
+}
+
+void pool_submit(threadpool_t* pool, void (*fn)(void* arg), void* arg) {
+  pool_task* task = malloc(sizeof(pool_task));
+  assert(task != NULL);
+  task->fn = fn;
+  task->arg = arg;
+  task->next = NULL;
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail) {
+    pool->tail->next = task;
+  } else {
+    pool->head = task;
+  }
+  pool->tail = task;
+  pool->pending++;
+  pthread_cond_signal(&pool->has_work);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_wait(threadpool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void pool_destroy(threadpool_t* pool) {
+  pool_wait(pool);
+  pthread_mutex_lock(&pool->lock);
+  pool->shutdown = true;
+  pthread_cond_broadcast(&pool->has_work);
+  pthread_mutex_unlock(&pool->lock);
+  for (unsigned int i = 0; i < pool->thread_count; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->has_work);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->threads);
+  free(pool);
+}
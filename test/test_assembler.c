@@ -7,7 +7,10 @@
 #include "assembler/assembler.h"
 #include "utils/arraylist.h"
 
-static char* gen_to_string(const char* src) {
+/// functions the last gen_to_string_opts call took from opts.fragments
+static unsigned int last_reused;
+
+static char* gen_to_string_opts(const char* src, asm_opts opts) {
   FILE* sfp = tmpfile();
   fwrite(src, 1, strlen(src), sfp);
   rewind(sfp);
@@ -17,7 +20,9 @@ static char* gen_to_string(const char* src) {
 
   FILE* out = tmpfile();
   asm_ctx* ctx = asm_init_file(out);
+  ctx->opts = opts;
   gen_program(ctx, head);
+  last_reused = ctx->funcs_reused;
   fflush(out);
 
   fseek(out, 0, SEEK_END);
@@ -34,6 +39,10 @@ static char* gen_to_string(const char* src) {
   return buf;
 }
 
+static char* gen_to_string(const char* src) {
+  return gen_to_string_opts(src, asm_default_opts(0));
+}
+
 Test(assembler, minimal_program) {
   char* out = gen_to_string("fn DWORD main () { return 0; }\n");
   cr_assert(strstr(out, ".text") != NULL);
@@ -50,8 +59,8 @@ Test(assembler, minimal_program) {
 Test(assembler, var_decl_and_load) {
   char* out = gen_to_string("fn DWORD main () { let DWORD x = 42; return x; }\n");
   cr_assert(strstr(out, "movq $42, %rax") != NULL);
-  cr_assert(strstr(out, "movq %rax, -8(%rbp)") != NULL);
-  cr_assert(strstr(out, "movq -8(%rbp), %rax") != NULL);
+  cr_assert(strstr(out, "movl %eax, -4(%rbp)") != NULL);
+  cr_assert(strstr(out, "movslq -4(%rbp), %rax") != NULL);
   free(out);
 }
 
@@ -99,8 +108,7 @@ Test(assembler, function_call) {
   char* out = gen_to_string(src);
   cr_assert(strstr(out, ".globl foo") != NULL);
   cr_assert(strstr(out, "foo:") != NULL);
-  cr_assert(strstr(out, "call foo") != NULL);
-  cr_assert(strstr(out, "popq %rdi") != NULL);
+  cr_assert(strstr(out, "movq $5, %rdi\n    call foo") != NULL);
   free(out);
 }
 
@@ -109,10 +117,9 @@ Test(assembler, function_two_args) {
     "fn DWORD foo (DWORD a, DWORD b) { return a + b; }\n"
     "fn DWORD main () { let DWORD x = call foo(1, 2); return 0; }\n";
   char* out = gen_to_string(src);
-  cr_assert(strstr(out, "popq %rsi") != NULL);
-  cr_assert(strstr(out, "popq %rdi") != NULL);
-  cr_assert(strstr(out, "movq %rdi, -8(%rbp)") != NULL);
-  cr_assert(strstr(out, "movq %rsi, -16(%rbp)") != NULL);
+  cr_assert(strstr(out, "movq $1, %rdi\n    movq $2, %rsi\n    call foo") != NULL);
+  cr_assert(strstr(out, "movl %edi, -4(%rbp)") != NULL);
+  cr_assert(strstr(out, "movl %esi, -8(%rbp)") != NULL);
   free(out);
 }
 
@@ -141,7 +148,7 @@ Test(assembler, address_of) {
   const char* src =
     "fn DWORD main () { let DWORD n = 5; let &DWORD p = &n; return 0; }\n";
   char* out = gen_to_string(src);
-  cr_assert(strstr(out, "leaq -8(%rbp), %rax") != NULL);
+  cr_assert(strstr(out, "leaq -4(%rbp), %rax") != NULL);
   free(out);
 }
 
@@ -150,7 +157,7 @@ Test(assembler, assignment) {
     "fn DWORD main () { let DWORD x = 0; x = 42; return x; }\n";
   char* out = gen_to_string(src);
   cr_assert(strstr(out, "movq $42, %rax") != NULL);
-  cr_assert(strstr(out, "movq %rax, -8(%rbp)") != NULL);
+  cr_assert(strstr(out, "movl %eax, -4(%rbp)") != NULL);
   free(out);
 }
 
@@ -187,3 +194,596 @@ Test(assembler, fib_full_program) {
   free_node(head);
   destroy_list(tokens);
 }
+
+Test(assembler, cfi_directives) {
+  char* out = gen_to_string("fn DWORD main () { return 0; }\n");
+  cr_assert(strstr(out, ".cfi_startproc") != NULL);
+  cr_assert(strstr(out, ".cfi_def_cfa_register %rbp") != NULL);
+  cr_assert(strstr(out, ".cfi_endproc") != NULL);
+  free(out);
+}
+
+Test(assembler, omit_frame_pointer_leaf) {
+  asm_opts opts = asm_default_opts(0);
+  opts.omit_frame_pointer = true;
+  char* out = gen_to_string_opts("fn QWORD id (QWORD a) { return a; }\n", opts);
+  cr_assert(strstr(out, "pushq %rbp") == NULL);
+  cr_assert(strstr(out, "subq $8, %rsp") != NULL);
+  cr_assert(strstr(out, "movq %rdi, 0(%rsp)") != NULL);
+  cr_assert(strstr(out, "addq $8, %rsp") != NULL);
+  free(out);
+}
+
+Test(assembler, omit_frame_pointer_empty_leaf) {
+  asm_opts opts = asm_default_opts(0);
+  opts.omit_frame_pointer = true;
+  char* out = gen_to_string_opts("fn DWORD main () { return 0; }\n", opts);
+  cr_assert(strstr(out, "%rbp") == NULL);
+  cr_assert(strstr(out, "subq") == NULL);
+  cr_assert(strstr(out, "ret") != NULL);
+  free(out);
+}
+
+Test(assembler, omit_frame_pointer_call_alignment) {
+  asm_opts opts = asm_default_opts(1);
+  const char* src =
+    "fn DWORD foo (DWORD a) { return a; }\n"
+    "fn DWORD main () { let DWORD x = 1; let DWORD y = call foo(2 + x); return y; }\n";
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "pushq %rbp") == NULL);
+  // two DWORD slots round to 16, plus 8 to realign the return address
+  cr_assert(strstr(out, "subq $24, %rsp") != NULL);
+  // x is read while one temporary is pushed
+  cr_assert(strstr(out, "movslq 28(%rsp), %rax") != NULL);
+  cr_assert(strstr(out, ".cfi_adjust_cfa_offset 8") != NULL);
+  free(out);
+}
+
+Test(assembler, self_tail_call_becomes_loop) {
+  asm_opts opts = asm_default_opts(0);
+  opts.optimize_sibling_calls = true;
+  const char* src =
+    "fn QWORD sum (QWORD n, QWORD acc) {\n"
+    "  if (n == 0) { return acc; }\n"
+    "  return call sum(n - 1, acc + n);\n"
+    "}\n";
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "call sum") == NULL);
+  cr_assert(strstr(out, "jmp .Lsum.1") != NULL);
+  cr_assert(strstr(out, ".Lsum.1:\n    movq %rdi, -8(%rbp)") != NULL);
+  free(out);
+}
+
+Test(assembler, sibling_call_reuses_frame) {
+  asm_opts opts = asm_default_opts(0);
+  opts.optimize_sibling_calls = true;
+  const char* src =
+    "fn QWORD foo (QWORD a) { return a; }\n"
+    "fn QWORD bar (QWORD a) { return call foo(a + 1); }\n";
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "call foo") == NULL);
+  cr_assert(strstr(out, "popq %rbp\n    .cfi_def_cfa %rsp, 8\n    jmp foo") != NULL);
+  cr_assert(strstr(out, ".cfi_restore_state") != NULL);
+  free(out);
+}
+
+Test(assembler, tail_calls_off_at_O0) {
+  const char* src =
+    "fn QWORD foo (QWORD a) { return a; }\n"
+    "fn QWORD bar (QWORD a) { return call foo(a); }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "call foo") != NULL);
+  cr_assert(strstr(out, "jmp foo") == NULL);
+  free(out);
+}
+
+Test(assembler, whole_program_only_exports_main) {
+  const char* src =
+    "fn QWORD foo (QWORD a) { return a; }\n"
+    "fn DWORD main () { return call foo(1); }\n";
+  asm_opts opts = asm_default_opts(0);
+  opts.whole_program = true;
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, ".globl foo") == NULL);
+  cr_assert(strstr(out, "foo:") != NULL);
+  cr_assert(strstr(out, ".globl main") != NULL);
+  free(out);
+}
+
+Test(assembler, narrow_locals_are_packed) {
+  const char* src =
+    "fn DWORD main () { let BYTE a = 1; let WORD b = 2; let QWORD c = 3; let BYTE d = 4; return a; }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "movb %al, -1(%rbp)") != NULL);
+  cr_assert(strstr(out, "movw %ax, -4(%rbp)") != NULL);
+  cr_assert(strstr(out, "movq %rax, -16(%rbp)") != NULL);
+  cr_assert(strstr(out, "movb %al, -17(%rbp)") != NULL);
+  cr_assert(strstr(out, "movzbq -1(%rbp), %rax") != NULL);
+  // 17 bytes of slots round up to 32
+  cr_assert(strstr(out, "subq $32, %rsp") != NULL);
+  free(out);
+}
+
+Test(assembler, narrow_global_access) {
+  const char* src =
+    "let WORD g = 7;\n"
+    "fn DWORD main () { g = 9; return g; }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, ".word 7") != NULL);
+  cr_assert(strstr(out, "movw %ax, g(%rip)") != NULL);
+  cr_assert(strstr(out, "movswq g(%rip), %rax") != NULL);
+  free(out);
+}
+
+Test(assembler, byte_is_unsigned_and_wider_types_are_signed) {
+  const char* src =
+    "fn QWORD main () {\n"
+    "  let BYTE b = 200;\n"
+    "  let WORD w = 60000;\n"
+    "  let DWORD d = 3000000000;\n"
+    "  return b + w + d + (BYTE) d + (WORD) d + (DWORD) b;\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  // b reads back as 200, w as -5536 and d as -1294967296
+  cr_assert(strstr(out, "movzbq -1(%rbp), %rax") != NULL);
+  cr_assert(strstr(out, "movswq -4(%rbp), %rax") != NULL);
+  cr_assert(strstr(out, "movslq -8(%rbp), %rax") != NULL);
+  // casts widen the same way loads do
+  cr_assert(strstr(out, "movzbq %al, %rax") != NULL);
+  cr_assert(strstr(out, "movswq %ax, %rax") != NULL);
+  cr_assert(strstr(out, "movslq %eax, %rax") != NULL);
+  cr_assert(strstr(out, "movsbq") == NULL);
+  cr_assert(strstr(out, "movzwq") == NULL);
+  free(out);
+}
+
+Test(assembler, casts_truncate_and_extend) {
+  const char* src =
+    "fn QWORD main () { let QWORD x = 300; return (BYTE) x; }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "movzbq %al, %rax") != NULL);
+  free(out);
+}
+
+Test(assembler, narrow_returns_block_sibling_calls) {
+  asm_opts opts = asm_default_opts(2);
+  const char* src =
+    "fn QWORD foo (QWORD a) { return a; }\n"
+    "fn BYTE bar (QWORD a) { return call foo(a); }\n";
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "call foo") != NULL);
+  cr_assert(strstr(out, "jmp foo") == NULL);
+  free(out);
+}
+
+Test(assembler, escaped_frames_block_sibling_calls) {
+  asm_opts opts = asm_default_opts(2);
+  const char* src =
+    "fn QWORD rd (&QWORD p) { let QWORD[4] junk; junk[0] = 99; return [p] + junk[0]; }\n"
+    "fn QWORD outer (QWORD v) { let QWORD x = v; return call rd(&x); }\n"
+    "fn QWORD arr (QWORD v) { let QWORD[2] x; x[0] = v; return call rd(x); }\n"
+    "fn QWORD global (QWORD v) { let QWORD[2] x; x[0] = v; return call rd(&g); }\n"
+    "let QWORD g = 1;\n";
+  char* out = gen_to_string_opts(src, opts);
+  // rd reads through p after its own locals are written, which would land
+  // on x if outer's frame was already gone
+  const char* outer = strstr(out, "outer:");
+  const char* arr = strstr(out, "arr:");
+  const char* global = strstr(out, "global:");
+  cr_assert(outer && arr && global);
+  cr_assert(strstr(outer, "call rd") != NULL && strstr(outer, "call rd") < arr);
+  cr_assert(strstr(arr, "call rd") != NULL && strstr(arr, "call rd") < global);
+  // indexing an array and taking the address of a global leak nothing
+  cr_assert(strstr(global, "jmp rd") != NULL);
+  free(out);
+}
+
+Test(assembler, labels_are_namespaced_per_function) {
+  const char* src =
+    "fn QWORD foo (QWORD a) { if (a) { return 1; } return 2; }\n"
+    "fn QWORD bar (QWORD a) { if (a) { return 3; } return 4; }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "je .Lfoo.1") != NULL);
+  cr_assert(strstr(out, "je .Lbar.1") != NULL);
+  free(out);
+}
+
+Test(assembler, parallel_output_matches_sequential) {
+  char src[8192] = "";
+  for (int i = 0; i < 40; i++) {
+    char fn[160];
+    snprintf(fn, sizeof(fn),
+      "fn QWORD f%d (QWORD a) { let QWORD b = a * %d; if (b > 10) { return b; } return call f%d(b); }\n",
+      i, i + 2, (i + 1) % 40);
+    strcat(src, fn);
+  }
+  asm_opts opts = asm_default_opts(1);
+  char* seq = gen_to_string_opts(src, opts);
+  opts.jobs = 4;
+  char* par = gen_to_string_opts(src, opts);
+  cr_assert_str_eq(seq, par);
+  free(seq);
+  free(par);
+}
+
+Test(assembler, incremental_reuses_unchanged_functions) {
+  char dir[] = "/tmp/frag_testXXXXXX";
+  cr_assert(mkdtemp(dir) != NULL);
+  asm_opts opts = asm_default_opts(1);
+  opts.fragments = cache_open(dir, 0);
+  const char* src =
+    "let QWORD g = 5;\n"
+    "fn QWORD sq (QWORD a) { return a * a; }\n"
+    "fn QWORD useg (QWORD a) { return a + g; }\n"
+    "fn QWORD main () { return call sq(call useg(1)); }\n";
+  char* first = gen_to_string_opts(src, opts);
+  cr_assert(last_reused == 0);
+  char* second = gen_to_string_opts(src, opts);
+  cr_assert(last_reused == 3);
+  cr_assert_str_eq(first, second);
+
+  // only the function that reads g depends on its type
+  const char* retyped =
+    "let DWORD g = 5;\n"
+    "fn QWORD sq (QWORD a) { return a * a; }\n"
+    "fn QWORD useg (QWORD a) { return a + g; }\n"
+    "fn QWORD main () { return call sq(call useg(1)); }\n";
+  char* third = gen_to_string_opts(retyped, opts);
+  cr_assert(last_reused == 2);
+  char* fresh = gen_to_string_opts(retyped, asm_default_opts(1));
+  cr_assert_str_eq(third, fresh);
+
+  // a changed signature reaches its callers
+  const char* resigned =
+    "let DWORD g = 5;\n"
+    "fn QWORD sq (DWORD a) { return a * a; }\n"
+    "fn QWORD useg (QWORD a) { return a + g; }\n"
+    "fn QWORD main () { return call sq(call useg(1)); }\n";
+  char* fourth = gen_to_string_opts(resigned, opts);
+  cr_assert(last_reused == 1);
+
+  cache_close(opts.fragments);
+  free(first);
+  free(second);
+  free(third);
+  free(fresh);
+  free(fourth);
+}
+
+Test(assembler, dump_asm_tags_lines) {
+  char* text = gen_to_string("let QWORD g = 1;\nfn QWORD main () { if (g) { return 1; } return 2; }\n");
+  FILE* in = fmemopen(text, strlen(text), "r");
+  char* buf = NULL;
+  size_t len = 0;
+  FILE* out = open_memstream(&buf, &len);
+  dump_asm_json(out, in);
+  fclose(out);
+  fclose(in);
+
+  cr_assert(strstr(buf, "{\"symbol\":\"g\",\"kind\":\"directive\",\"text\":\".quad 1\"}\n") != NULL);
+  cr_assert(strstr(buf, "{\"symbol\":null,\"kind\":\"directive\",\"text\":\".text\"}\n") != NULL);
+  cr_assert(strstr(buf, "{\"symbol\":\"main\",\"kind\":\"label\",\"text\":\".Lmain.1:\"}\n") != NULL);
+  cr_assert(strstr(buf, "{\"symbol\":\"main\",\"kind\":\"insn\",\"text\":\"ret\"}\n") != NULL);
+  free(buf);
+  free(text);
+}
+
+Test(assembler, loops_are_bottom_tested) {
+  const char* src =
+    "fn QWORD main () {\n"
+    "  let QWORD t = 0;\n"
+    "  for (let QWORD i = 0; i < 10; i = i + 1) { t = t + i; }\n"
+    "  return t;\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  // one jump into the condition, which branches back to the body on the flags
+  char* enter = strstr(out, "jmp .Lmain.2");
+  cr_assert(enter != NULL);
+  char* body = strstr(out, ".Lmain.1:");
+  char* cond = strstr(out, ".Lmain.2:");
+  cr_assert(body != NULL && cond != NULL);
+  cr_assert(enter < body && body < cond);
+  cr_assert(strstr(cond, "cmpq %rcx, %rax\n    jl .Lmain.1") != NULL);
+  cr_assert(strstr(cond, "setl") == NULL);
+  free(out);
+}
+
+Test(assembler, arrays_use_scaled_index_addressing) {
+  const char* src =
+    "fn QWORD main () {\n"
+    "  let BYTE b = 1;\n"
+    "  let QWORD[10] a;\n"
+    "  let QWORD i = 3;\n"
+    "  a[i] = 7;\n"
+    "  a[2] = a[i];\n"
+    "  return a[2];\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  // the array takes all 80 bytes below b, aligned for its elements
+  cr_assert(strstr(out, "movq %rax, -96(%rbp)") != NULL);
+  cr_assert(strstr(out, "movq -96(%rbp), %rcx\n    movq %rax, -88(%rbp,%rcx,8)") != NULL);
+  cr_assert(strstr(out, "movq -88(%rbp,%rcx,8), %rax") != NULL);
+  // a literal index folds into the displacement
+  cr_assert(strstr(out, "movq %rax, -72(%rbp)") != NULL);
+  cr_assert(strstr(out, "subq $96, %rsp") != NULL);
+  cr_assert(strstr(out, "imul") == NULL);
+  free(out);
+}
+
+Test(assembler, global_and_pointer_indexing) {
+  const char* src =
+    "let WORD[6] g;\n"
+    "fn QWORD get (&DWORD p, QWORD i) { return p[i] + g[i]; }\n"
+    "fn QWORD main () { return call get(g, 1); }\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, ".balign 2\ng:\n    .zero 12") != NULL);
+  cr_assert(strstr(out, "movslq (%rdx,%rcx,4), %rax") != NULL);
+  cr_assert(strstr(out, "leaq g(%rip), %rdx") != NULL);
+  cr_assert(strstr(out, "movswq (%rdx,%rcx,2), %rax") != NULL);
+  // passing an array passes its address
+  cr_assert(strstr(out, "leaq g(%rip), %rdi") != NULL);
+  free(out);
+}
+
+Test(assembler, bounds_checks_trap_out_of_range_indexes) {
+  const char* src = "fn QWORD get (QWORD i) { let QWORD[4] a; return a[i]; }\n";
+  asm_opts opts = asm_default_opts(0);
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "ud2") == NULL);
+  free(out);
+  opts.bounds_check = true;
+  out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "cmpq $4, %rcx\n    jae .Lget.1") != NULL);
+  cr_assert(strstr(out, ".Lget.1:\n    ud2") != NULL);
+  free(out);
+}
+
+Test(assembler, bounds_checks_move_out_of_counted_loops) {
+  const char* src =
+    "fn QWORD main () {\n"
+    "  let QWORD[8] a;\n"
+    "  let QWORD[6] b;\n"
+    "  let QWORD n = 6;\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) { a[i] = i; b[i] = a[i]; }\n"
+    "  for (let QWORD j = 0; j < n; j = j + 1) { a[j] = 1; j = j + 0; }\n"
+    "  return 0;\n"
+    "}\n";
+  asm_opts opts = asm_default_opts(0);
+  opts.bounds_check = true;
+  char* out = gen_to_string_opts(src, opts);
+  // one check of the counter and the shorter array's length before the first loop
+  char* pre = strstr(out, "testq %rax, %rax");
+  cr_assert(pre != NULL);
+  cr_assert(strstr(pre, "cmpq $6, %rcx\n    jg .Lmain.2") != NULL);
+  char* second = strstr(out, "cmpq $8, %rcx\n    jae .Lmain.2");
+  cr_assert(second != NULL);
+  // the first loop has no per access checks left, the second writes its
+  // counter in the body so keeps them
+  char* jae = strstr(out, "jae");
+  cr_assert(jae > second && strstr(jae + 1, "jae") == NULL);
+  free(out);
+}
+
+Test(assembler, element_wise_loops_are_vectorized) {
+  const char* src =
+    "fn QWORD main () {\n"
+    "  let DWORD[100] a;\n"
+    "  let DWORD[100] b;\n"
+    "  let QWORD n = 99;\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) { a[i] = a[i] + b[i] - 5; }\n"
+    "  return a[7];\n"
+    "}\n";
+  char* out = gen_to_string_opts(src, asm_default_opts(2));
+  // the literal is broadcast once before the loop
+  cr_assert(strstr(out, "movd %eax, %xmm8\n    pshufd $0, %xmm8, %xmm8") != NULL);
+  char* body = strstr(out, "movdqu");
+  cr_assert(body != NULL);
+  cr_assert(strstr(body, "paddd %xmm1, %xmm0\n    psubd %xmm8, %xmm0") != NULL);
+  cr_assert(strstr(body, "addq $4, %rcx") != NULL);
+  // the scalar loop still runs whatever is left over
+  char* rest = strstr(body, "jle");
+  cr_assert(rest != NULL && strstr(rest, "jl ") != NULL);
+  free(out);
+
+  out = gen_to_string_opts(src, asm_default_opts(1));
+  cr_assert(strstr(out, "xmm") == NULL);
+  free(out);
+}
+
+Test(assembler, avx2_vectors_are_twice_as_wide) {
+  const char* src =
+    "let WORD[64] g;\n"
+    "fn QWORD main () {\n"
+    "  let WORD[64] a;\n"
+    "  for (let QWORD i = 0; i < 64; i = i + 1) { g[i] = a[i] == g[i]; }\n"
+    "  return g[3];\n"
+    "}\n";
+  asm_opts opts = asm_default_opts(2);
+  opts.isa = ISA_AVX2;
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "vpcmpeqw %ymm1, %ymm0, %ymm0") != NULL);
+  // all ones lanes become the 1 the scalar compare produces
+  cr_assert(strstr(out, "vpxor %ymm1, %ymm1, %ymm1\n    vpsubw %ymm0, %ymm1, %ymm0") != NULL);
+  cr_assert(strstr(out, "addq $16, %rcx") != NULL);
+  cr_assert(strstr(out, "vzeroupper") != NULL);
+  free(out);
+}
+
+Test(assembler, loops_that_do_not_fit_stay_scalar) {
+  const char* srcs[] = {
+    // the counter as a value
+    "fn QWORD f () { let QWORD[8] a; for (let QWORD i = 0; i < 8; i = i + 1) { a[i] = i; } return a[1]; }\n",
+    // pointers could overlap
+    "fn QWORD f (&QWORD p, &QWORD q) { for (let QWORD i = 0; i < 8; i = i + 1) { p[i] = q[i]; } return 0; }\n",
+    // mixed element types
+    "fn QWORD f () { let QWORD[8] a; let DWORD[8] b; for (let QWORD i = 0; i < 8; i = i + 1) { a[i] = b[i]; } return a[1]; }\n",
+    // a neighbouring element
+    "fn QWORD f () { let QWORD[9] a; for (let QWORD i = 0; i < 8; i = i + 1) { a[i] = a[i + 1]; } return a[1]; }\n",
+    // 64 bit compares need SSE4.2
+    "fn QWORD f () { let QWORD[8] a; for (let QWORD i = 0; i < 8; i = i + 1) { a[i] = a[i] == 3; } return a[1]; }\n",
+  };
+  for (size_t k = 0; k < sizeof(srcs) / sizeof(srcs[0]); k++) {
+    char* out = gen_to_string_opts(srcs[k], asm_default_opts(2));
+    cr_assert(strstr(out, "xmm") == NULL, "vectorized: %s", srcs[k]);
+    free(out);
+  }
+}
+
+Test(assembler, vector_intrinsics_read_aligned_slots) {
+  const char* src =
+    "fn QWORD f (&DWORD p, &DWORD q) {\n"
+    "  let V128 a = call vload128(p);\n"
+    "  let V128 b = call vadd32(a, call vload128(q));\n"
+    "  call vstore128(p, call vsub32(b, a));\n"
+    "  return call vmovemask8(call vshuffle32(b, 27));\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "movdqu (%rax), %xmm0") != NULL);
+  cr_assert(strstr(out, "movdqa %xmm0, -32(%rbp)") != NULL);
+  // a vector variable is used as the memory operand, anything else is spilled
+  cr_assert(strstr(out, "psubd -32(%rbp), %xmm0") != NULL);
+  cr_assert(strstr(out, "paddd %xmm1, %xmm0") != NULL);
+  cr_assert(strstr(out, "pshufd $27, %xmm0, %xmm0\n    pmovmskb %xmm0, %eax") != NULL);
+  // %rbp is already aligned enough for V128
+  cr_assert(strstr(out, "andq") == NULL);
+  free(out);
+}
+
+Test(assembler, v256_realigns_the_frame) {
+  const char* src =
+    "fn QWORD g () { return 0; }\n"
+    "fn QWORD f (&DWORD p) {\n"
+    "  let V256 a = call vload256(p);\n"
+    "  call vstore256(p, call vmul32(a, a));\n"
+    "  return call g();\n"
+    "}\n";
+  asm_opts opts = asm_default_opts(0);
+  opts.isa = ISA_AVX2;
+  char* out = gen_to_string_opts(src, opts);
+  cr_assert(strstr(out, "andq $-32, %rsp") != NULL);
+  cr_assert(strstr(out, "vmovdqu (%rax), %ymm0") != NULL);
+  cr_assert(strstr(out, "vpmulld 8(%rsp), %ymm0, %ymm0") != NULL);
+  // the upper halves are cleared before SSE code can run
+  cr_assert(strstr(out, "vzeroupper\n    call g") != NULL);
+  free(out);
+}
+
+Test(assembler, arguments_past_the_sixth_go_on_the_stack) {
+  const char* src =
+    "fn QWORD last (QWORD a, QWORD b, QWORD c, QWORD d, QWORD e, QWORD f, QWORD g, WORD h) { return h; }\n"
+    "fn QWORD main () { return call last(1, 2, 3, 4, 5, 6, 7, 8); }\n";
+  char* out = gen_to_string(src);
+  // the callee copies them out from above its return address
+  cr_assert(strstr(out, "movq 16(%rbp), %rax") != NULL);
+  cr_assert(strstr(out, "movq 24(%rbp), %rax\n    movw %ax,") != NULL);
+  // the caller stores them straight into the area it reserved
+  cr_assert(strstr(out, "subq $16, %rsp") != NULL);
+  cr_assert(strstr(out, "movq $7, %rax\n    movq %rax, 0(%rsp)") != NULL);
+  cr_assert(strstr(out, "movq $8, %rax\n    movq %rax, 8(%rsp)") != NULL);
+  cr_assert(strstr(out, "call last\n    addq $16, %rsp") != NULL);
+  free(out);
+}
+
+Test(assembler, arguments_are_evaluated_into_their_registers) {
+  const char* src =
+    "let QWORD g;\n"
+    "fn QWORD f (QWORD a, QWORD b, QWORD c, QWORD d, QWORD e) { return a; }\n"
+    "fn QWORD h () { return 1; }\n"
+    "fn QWORD main () { let DWORD x = 2; return call f(x + 1, call h(), x * 3, x - 4, g); }\n";
+  char* out = gen_to_string(src);
+  // only arguments computed up to the call to h wait on the stack, %rcx
+  // and %rdx are filled after the rest and the global is loaded last
+  cr_assert(strstr(out, "subq %rcx, %rax\n    movq %rax, %rcx\n    popq %rdx\n"
+                        "    movq g(%rip), %r8\n    popq %rsi\n    popq %rdi\n    call f") != NULL);
+  free(out);
+}
+
+Test(assembler, dereferences_use_the_pointee_size) {
+  const char* src =
+    "fn QWORD f (&BYTE b, &WORD w, &DWORD d, &QWORD q) {\n"
+    "  [q + 16] = [b] + [w + 2] + [d - 4];\n"
+    "  [w + 2] = 7;\n"
+    "  return [q + 8 * [b]];\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "movzbq 0(%rax), %rax") != NULL);
+  // literal offsets are folded into the displacement
+  cr_assert(strstr(out, "movswq 2(%rax), %rax") != NULL);
+  cr_assert(strstr(out, "movslq -4(%rax), %rax") != NULL);
+  // a pointer variable is read straight into the base register of a store
+  cr_assert(strstr(out, "movq -32(%rbp), %rdx\n    movq %rax, 16(%rdx)") != NULL);
+  cr_assert(strstr(out, "movq -16(%rbp), %rdx\n    movw %ax, 2(%rdx)") != NULL);
+  cr_assert(strstr(out, "addq %rcx, %rax\n    movq 0(%rax), %rax") != NULL);
+  free(out);
+}
+
+Test(assembler, string_literals_share_one_pool_entry) {
+  const char* src =
+    "let &BYTE msg = \"hi\";\n"
+    "fn QWORD f () { call puts(\"hi\"); return [\"a\\\" + 1]; }\n";
+  char* out = gen_to_string(src);
+  const char* pool = strstr(out, ".section .rodata.str1.1,\"aMS\",@progbits,1\n");
+  cr_assert(pool != NULL);
+  const char* label = strstr(out, ".LS");
+  cr_assert(label != NULL);
+  char name[32];
+  cr_assert(sscanf(label, "%19[.LS0-9a-f]", name) == 1);
+  char want[96];
+  snprintf(want, sizeof(want), "msg:\n    .quad %s", name);
+  cr_assert(strstr(out, want) != NULL);
+  snprintf(want, sizeof(want), "%s:\n    .string \"hi\"", name);
+  cr_assert(strstr(pool, want) != NULL);
+  snprintf(want, sizeof(want), "leaq %s(%%rip), %%rdi", name);
+  cr_assert(strstr(out, want) != NULL);
+  // the same bytes only get one label, and are written back exactly
+  const char* hi = strstr(pool, ".string \"hi\"");
+  cr_assert(strstr(hi + 1, ".string \"hi\"") == NULL);
+  cr_assert(strstr(pool, ".string \"a\\\\\"") != NULL);
+  cr_assert(strstr(out, "movzbq 1(%rax), %rax") != NULL);
+  free(out);
+}
+
+Test(assembler, bitwise_ops_lower_to_single_instructions) {
+  const char* src =
+    "fn QWORD f (QWORD a, QWORD b) {\n"
+    "  return (a & 255) | (a ^ b) << 3 | ~b >> b | a >>> 60;\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  // literal masks and shift counts are encoded as immediates
+  cr_assert(strstr(out, "andq $255, %rax") != NULL);
+  cr_assert(strstr(out, "xorq %rcx, %rax\n    shlq $3, %rax") != NULL);
+  cr_assert(strstr(out, "notq %rax") != NULL);
+  cr_assert(strstr(out, "sarq %cl, %rax") != NULL);
+  cr_assert(strstr(out, "shrq $60, %rax") != NULL);
+  cr_assert(strstr(out, "orq %rcx, %rax") != NULL);
+  cr_assert(strstr(out, "imulq") == NULL);
+  free(out);
+}
+
+Test(assembler, updates_are_read_modify_write) {
+  const char* src =
+    "let DWORD g;\n"
+    "fn QWORD f (&WORD p, QWORD n) {\n"
+    "  let QWORD[4] a;\n"
+    "  let BYTE b = 0;\n"
+    "  for (let QWORD i = 0; i < n; i++) { a[i & 3] += i; }\n"
+    "  b -= 300;\n"
+    "  g |= 8;\n"
+    "  --[p + 2];\n"
+    "  a[1] <<= 3;\n"
+    "  n *= 3;\n"
+    "  return (n += 1) + a[1];\n"
+    "}\n";
+  char* out = gen_to_string(src);
+  cr_assert(strstr(out, "incq -64(%rbp)") != NULL);
+  cr_assert(strstr(out, "addq %rax, -48(%rbp,%rcx,8)") != NULL);
+  // literals are truncated to the size of the target
+  cr_assert(strstr(out, "subb $44, -49(%rbp)") != NULL);
+  cr_assert(strstr(out, "orl $8, g(%rip)") != NULL);
+  cr_assert(strstr(out, "decw 2(%rax)") != NULL);
+  cr_assert(strstr(out, "shlq $3, -40(%rbp)") != NULL);
+  // no instruction multiplies memory in place, and a used value needs %rax
+  cr_assert(strstr(out, "imulq %rcx, %rax\n    movq %rax, -16(%rbp)") != NULL);
+  cr_assert(strstr(out, "addq %rcx, %rax\n    movq %rax, -16(%rbp)") != NULL);
+  free(out);
+}
@@ -133,7 +133,7 @@ Test(emitter_mov, reg_to_reg_8bit) {
   operand_t* dest = mk_register(REG_RBX, SZ_8);
   emit_mov(emit, src, dest);
   read_output(fd[0], buf, sizeof(buf));
-  cr_assert_str_eq(buf, "movb %ah, %bh\n");
+  cr_assert_str_eq(buf, "movb %al, %bl\n");
 
   free(src); free(dest); free(emit);
 }
@@ -180,6 +180,72 @@ Test(emitter_mov, mem_to_reg) {
   free(src); free(dest); free(emit);
 }
 
+Test(emitter_mov, narrow_store_keeps_64bit_base) {
+  int fd[2]; FILE* file; emitter* emit;
+  setup_pipe_emitter(fd, &file, &emit);
+  char buf[256];
+
+  operand_t* src = mk_register(REG_RAX, SZ_16);
+  operand_t* dest = mk_mem(REG_RBP, SZ_16, -2);
+  emit_mov(emit, src, dest);
+  read_output(fd[0], buf, sizeof(buf));
+  cr_assert_str_eq(buf, "movw %ax, -2(%rbp)\n");
+
+  free(src); free(dest); free(emit);
+}
+
+Test(emitter_mov, movzx_and_movsx) {
+  int fd[2]; FILE* file; emitter* emit;
+  setup_pipe_emitter(fd, &file, &emit);
+  char buf[256];
+
+  operand_t* byte = mk_mem(REG_RSP, SZ_8, 3);
+  operand_t* dword = mk_mem(REG_RSP, SZ_32, 4);
+  operand_t* rax = mk_register(REG_RAX, SZ_64);
+  emit_movzx(emit, byte, rax);
+  emit_movsx(emit, dword, rax);
+  read_output(fd[0], buf, sizeof(buf));
+  cr_assert_str_eq(buf, "movzbq 3(%rsp), %rax\nmovslq 4(%rsp), %rax\n");
+
+  free(byte); free(dword); free(rax); free(emit);
+}
+
+Test(emitter_mov, scaled_index_operands) {
+  int fd[2]; FILE* file; emitter* emit;
+  setup_pipe_emitter(fd, &file, &emit);
+  char buf[256];
+
+  operand_t* elem = mk_mem_index(REG_RBP, REG_RCX, 8, SZ_64, -80);
+  operand_t* word = mk_mem_index(REG_RDX, REG_RCX, 2, SZ_16, 0);
+  operand_t* rax = mk_register(REG_RAX, SZ_64);
+  operand_t* ax = mk_register(REG_RAX, SZ_16);
+  emit_mov(emit, elem, rax);
+  emit_mov(emit, ax, word);
+  read_output(fd[0], buf, sizeof(buf));
+  cr_assert_str_eq(buf, "movq -80(%rbp,%rcx,8), %rax\nmovw %ax, (%rdx,%rcx,2)\n");
+
+  free(elem); free(word); free(rax); free(ax); free(emit);
+}
+
+Test(emitter_mov, vector_moves) {
+  int fd[2]; FILE* file; emitter* emit;
+  setup_pipe_emitter(fd, &file, &emit);
+  char buf[256];
+
+  operand_t* slot = mk_mem(REG_RBP, SZ_128, -32);
+  operand_t* xmm = mk_register(REG_XMM3, SZ_128);
+  operand_t* wide = mk_mem(REG_RSP, SZ_256, 32);
+  operand_t* ymm = mk_register(REG_XMM12, SZ_256);
+  emit_vmov(emit, slot, xmm, true, false);
+  emit_vmov(emit, xmm, slot, false, true);
+  // 256 bit registers only exist in the AVX encoding
+  emit_vmov(emit, ymm, wide, true, false);
+  read_output(fd[0], buf, sizeof(buf));
+  cr_assert_str_eq(buf, "movdqa -32(%rbp), %xmm3\nvmovdqu %xmm3, -32(%rbp)\nvmovdqa %ymm12, 32(%rsp)\n");
+
+  free(slot); free(xmm); free(wide); free(ymm); free(emit);
+}
+
 Test(emitter_mov, imm_to_mem) {
   int fd[2]; FILE* file; emitter* emit;
   setup_pipe_emitter(fd, &file, &emit);
@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <criterion/criterion.h>
+#include "tokenizer/tokenizer.h"
+#include "parser/parser.h"
+#include "optimizer/inliner.h"
+#include "optimizer/dce.h"
+#include "optimizer/licm.h"
+#include "assembler/assembler.h"
+#include "utils/arraylist.h"
+
+static ArrayList* toks = NULL;
+
+static Node* parse_string(const char* src) {
+  FILE* sfp = tmpfile();
+  fwrite(src, 1, strlen(src), sfp);
+  rewind(sfp);
+  toks = tokenize(sfp, strlen(src));
+  fclose(sfp);
+  return parse_program(toks);
+}
+
+static Node* func_at(Node* program, int idx) {
+  return (Node*)get_list(program->programDecl.nodes, idx);
+}
+
+static Node* first_stmt(Node* func) {
+  return (Node*)get_list(func->funcDecl.block->blockStmt.nodes, 0);
+}
+
+static ArrayList* body_of(Node* func) {
+  return func->funcDecl.block->blockStmt.nodes;
+}
+
+static inline_opts test_inline_opts(void) {
+  inline_opts opts = inline_default_opts(2);
+  return opts;
+}
+
+// ============================================================
+// Inliner
+// ============================================================
+
+Test(inliner, inlines_small_function) {
+  Node* prog = parse_string(
+    "fn QWORD add (QWORD a, QWORD b) { return a + b; }\n"
+    "fn DWORD main () { let x = call add(1, 2); return x; }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 1);
+  Node* decl = first_stmt(func_at(prog, 1));
+  Node* val = decl->varDecl.assign;
+  cr_assert(val->type == AST_BINARY);
+  cr_assert(val->binaryExpr.op == B_ADD);
+  cr_assert(val->binaryExpr.expr_left->literalExpr.num_value == 1);
+  cr_assert(val->binaryExpr.expr_right->literalExpr.num_value == 2);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, narrow_params_and_return_are_cast) {
+  Node* prog = parse_string(
+    "fn DWORD id (WORD a) { return a; }\n"
+    "fn DWORD main () { let QWORD y = 3; return call id(y); }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 1);
+  Node* ret = (Node*)get_list(func_at(prog, 1)->funcDecl.block->blockStmt.nodes, 1);
+  Node* val = ret->returnStmt.return_val;
+  cr_assert(val->type == AST_CAST);
+  cr_assert(val->castExpr.var_t->variable_t.type == LIT_DWORD);
+  cr_assert(val->castExpr.inner->type == AST_CAST);
+  cr_assert(val->castExpr.inner->castExpr.var_t->variable_t.type == LIT_WORD);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, skips_recursive_functions) {
+  Node* prog = parse_string(
+    "fn QWORD loop (QWORD a) { return call loop(a); }\n"
+    "fn DWORD main () { return call loop(1); }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 0);
+  Node* ret = first_stmt(func_at(prog, 1));
+  cr_assert(ret->returnStmt.return_val->type == AST_CALL);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, respects_size_limit) {
+  Node* prog = parse_string(
+    "fn QWORD poly (QWORD a) { return a * a * a + a * a + a; }\n"
+    "fn DWORD main () { return call poly(2); }\n");
+  inline_opts opts = test_inline_opts();
+  opts.max_size = 4;
+  cr_assert(inline_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, no_duplicate_evaluation) {
+  Node* prog = parse_string(
+    "fn QWORD sq (QWORD a) { return a * a; }\n"
+    "fn DWORD main () { let x = 3; return call sq(x + 1); }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, arguments_are_not_read_after_the_callee_stores) {
+  // the body writes g, or memory through p, before the argument is read
+  Node* prog = parse_string(
+    "let QWORD g = 1;\n"
+    "fn QWORD set (QWORD a) { return (g = 5) + a; }\n"
+    "fn QWORD put (&QWORD p, QWORD a) { return ([p] = 5) + a; }\n"
+    "fn DWORD main () {\n"
+    "  let QWORD x = 1;\n"
+    "  return call set(g) + call set(3) + call put(&x, [&x]);\n"
+    "}\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 1);
+  Node* sum = ((Node*)get_list(body_of(func_at(prog, 3)), 1))->returnStmt.return_val;
+  cr_assert(sum->binaryExpr.expr_left->binaryExpr.expr_left->type == AST_CALL);
+  cr_assert(sum->binaryExpr.expr_left->binaryExpr.expr_right->type == AST_BINARY);
+  cr_assert(sum->binaryExpr.expr_right->type == AST_CALL);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, skips_callees_that_use_a_parameter_as_a_variable) {
+  // the address of the caller's x, a literal that has no address, and a
+  // store into the caller's x
+  Node* prog = parse_string(
+    "fn QWORD addr (QWORD a) { return [&a]; }\n"
+    "fn QWORD bump (QWORD a) { return a = a + 1; }\n"
+    "fn QWORD pre (QWORD a) { return ++a; }\n"
+    "fn DWORD main () {\n"
+    "  let QWORD x = 8;\n"
+    "  let QWORD y = call addr(x) + call addr(3);\n"
+    "  return call bump(x) + call pre(x) + x;\n"
+    "}\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 0);
+  ArrayList* nodes = body_of(func_at(prog, 3));
+  Node* y = ((Node*)get_list(nodes, 1))->varDecl.assign;
+  cr_assert(y->binaryExpr.expr_left->type == AST_CALL);
+  cr_assert(y->binaryExpr.expr_right->type == AST_CALL);
+  Node* sum = ((Node*)get_list(nodes, 2))->returnStmt.return_val;
+  cr_assert(sum->binaryExpr.expr_left->binaryExpr.expr_left->type == AST_CALL);
+  cr_assert(sum->binaryExpr.expr_left->binaryExpr.expr_right->type == AST_CALL);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, nested_inlining) {
+  Node* prog = parse_string(
+    "fn QWORD inc (QWORD a) { return a + 1; }\n"
+    "fn QWORD inc2 (QWORD a) { return call inc(call inc(a)); }\n"
+    "fn DWORD main () { return call inc2(1); }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) >= 2);
+  Node* ret = first_stmt(func_at(prog, 2));
+  cr_assert(ret->returnStmt.return_val->type == AST_BINARY);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, report_lists_decisions) {
+  Node* prog = parse_string(
+    "fn QWORD add (QWORD a, QWORD b) { return a + b; }\n"
+    "fn QWORD loop (QWORD a) { return call loop(a); }\n"
+    "fn DWORD main () { return call add(1, call loop(2)); }\n");
+  FILE* rep = tmpfile();
+  inline_opts opts = test_inline_opts();
+  opts.report = rep;
+  inline_program(prog, &opts);
+  fflush(rep);
+  long len = ftell(rep);
+  rewind(rep);
+  char* buf = calloc(len + 1, 1);
+  fread(buf, 1, len, rep);
+  cr_assert(strstr(buf, "inline: loop into main: not inlined (recursive)") != NULL);
+  cr_assert(strstr(buf, "inline: add into main: not inlined (argument has side effects)") != NULL);
+  free(buf);
+  fclose(rep);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, inlined_pointer_params_can_be_indexed) {
+  Node* prog = parse_string(
+    "fn QWORD second (&WORD p) { return p[1]; }\n"
+    "fn QWORD main () { let DWORD[4] c; return call second(c); }\n");
+  inline_opts opts = test_inline_opts();
+  cr_assert(inline_program(prog, &opts) == 1);
+  Node* ret = (Node*)get_list(body_of(func_at(prog, 1)), 1);
+  cr_assert(ret->returnStmt.return_val->type == AST_INDEX);
+  cr_assert(ret->returnStmt.return_val->arrayIndex.target->type == AST_CAST);
+  // the cast keeps the parameter's element type over the array's
+  FILE* out = tmpfile();
+  asm_ctx* ctx = asm_init_file(out);
+  gen_program(ctx, prog);
+  fflush(out);
+  long len = ftell(out);
+  rewind(out);
+  char* buf = calloc(len + 1, 1);
+  fread(buf, 1, len, out);
+  cr_assert(strstr(buf, "movswq -14(%rbp), %rax") != NULL);
+  free(buf);
+  asm_free(ctx);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(inliner, disabled_at_O0) {
+  Node* prog = parse_string(
+    "fn QWORD add (QWORD a, QWORD b) { return a + b; }\n"
+    "fn DWORD main () { return call add(1, 2); }\n");
+  inline_opts opts = inline_default_opts(0);
+  cr_assert(inline_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+// ============================================================
+// Dead code elimination
+// ============================================================
+
+Test(dce, drops_statements_after_return) {
+  Node* prog = parse_string(
+    "fn DWORD main () { return 1; let x = call main(); return 2; }\n");
+  dce_opts opts = dce_default_opts(1);
+  cr_assert(dce_program(prog, &opts) == 2);
+  cr_assert(body_of(func_at(prog, 0))->length == 1);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, drops_unused_locals_transitively) {
+  Node* prog = parse_string(
+    "fn DWORD main () { let a = 1; let b = a + 2; let c = 3; return c; }\n");
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  ArrayList* body = body_of(func_at(prog, 0));
+  cr_assert(body->length == 2);
+  Node* decl = (Node*)get_list(body, 0);
+  cr_assert_str_eq(decl->varDecl.ident->identifierExpr.name, "c");
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, keeps_side_effects_of_dead_stores) {
+  Node* prog = parse_string(
+    "fn QWORD f () { return 1; }\n"
+    "fn DWORD main () { let a = call f(); a = call f(); return 0; }\n");
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  ArrayList* body = body_of(func_at(prog, 1));
+  cr_assert(body->length == 3);
+  cr_assert(((Node*)get_list(body, 0))->type == AST_CALL);
+  cr_assert(((Node*)get_list(body, 1))->type == AST_CALL);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, keeps_bounds_checked_reads_of_dead_locals) {
+  const char* src = "fn DWORD main (QWORD i) { let QWORD [4] a; let x = a[i]; return 0; }\n";
+  Node* prog = parse_string(src);
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  cr_assert(body_of(func_at(prog, 0))->length == 1);
+  free_node(prog);
+  destroy_list(toks);
+
+  // the check can trap, so the read stays once the store is gone
+  prog = parse_string(src);
+  opts.bounds_check = true;
+  dce_program(prog, &opts);
+  ArrayList* body = body_of(func_at(prog, 0));
+  cr_assert(body->length == 3);
+  cr_assert(((Node*)get_list(body, 1))->type == AST_INDEX);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, shadowed_local_is_resolved_by_scope) {
+  Node* prog = parse_string(
+    "fn DWORD main () { let x = 1; if (x) { let x = 2; } return x; }\n");
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  ArrayList* body = body_of(func_at(prog, 0));
+  cr_assert(body->length == 3);
+  Node* branch = ((Node*)get_list(body, 1))->ifStmt.then_branch;
+  cr_assert(branch->blockStmt.nodes->length == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, folds_constant_conditions) {
+  Node* prog = parse_string(
+    "fn DWORD main () { if (2 > 1) { return 7; } else { return 8; } }\n");
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  Node* stmt = first_stmt(func_at(prog, 0));
+  cr_assert(stmt->type == AST_BLOCK);
+  Node* ret = (Node*)get_list(stmt->blockStmt.nodes, 0);
+  cr_assert(ret->returnStmt.return_val->literalExpr.num_value == 7);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, folds_bitwise_conditions) {
+  Node* prog = parse_string(
+    "fn DWORD main () { if ((6 & 1 | 0 - 1 >>> 63 << 2) == ~0 + 5) { return 7; } return 8; }\n");
+  dce_opts opts = dce_default_opts(1);
+  dce_program(prog, &opts);
+  Node* stmt = first_stmt(func_at(prog, 0));
+  cr_assert(stmt->type == AST_BLOCK);
+  Node* ret = (Node*)get_list(stmt->blockStmt.nodes, 0);
+  cr_assert(ret->returnStmt.return_val->literalExpr.num_value == 7);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, whole_program_drops_unreferenced_functions) {
+  Node* prog = parse_string(
+    "fn QWORD used () { return 1; }\n"
+    "fn QWORD unused () { return call used(); }\n"
+    "fn DWORD main () { return call used(); }\n");
+  dce_opts opts = dce_default_opts(1);
+  cr_assert(dce_program(prog, &opts) == 0);
+  opts.whole_program = true;
+  cr_assert(dce_program(prog, &opts) == 1);
+  cr_assert(prog->programDecl.nodes->length == 2);
+  cr_assert_str_eq(func_at(prog, 0)->funcDecl.type->function_t.ident->identifierExpr.name, "used");
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(dce, disabled_at_O0) {
+  Node* prog = parse_string("fn DWORD main () { let a = 1; return 0; }\n");
+  dce_opts opts = dce_default_opts(0);
+  cr_assert(dce_program(prog, &opts) == 0);
+  cr_assert(body_of(func_at(prog, 0))->length == 2);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+// ============================================================
+// Loop invariant code motion
+// ============================================================
+
+Test(licm, hoists_invariant_expression) {
+  Node* prog = parse_string(
+    "fn QWORD f (QWORD n, QWORD k) {\n"
+    "  let QWORD t = 0;\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) { t = t + i * (k * 3 + 1); }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  cr_assert(licm_program(prog, &opts) == 1);
+  // for block: init, then the hoisted declarations wrapped around the loop
+  Node* outer = (Node*)get_list(body_of(func_at(prog, 0)), 1);
+  Node* wrapper = (Node*)get_list(outer->blockStmt.nodes, 1);
+  cr_assert(wrapper->type == AST_BLOCK);
+  Node* decl = (Node*)get_list(wrapper->blockStmt.nodes, 0);
+  cr_assert(decl->type == AST_VAR_DECL);
+  cr_assert(decl->varDecl.type->variable_t.type == LIT_QWORD);
+  cr_assert(decl->varDecl.assign->binaryExpr.op == B_ADD);
+  Node* loop = (Node*)get_list(wrapper->blockStmt.nodes, 1);
+  cr_assert(loop->type == AST_WHILE);
+  Node* assign = (Node*)get_list(loop->whileStmt.body->blockStmt.nodes, 0);
+  Node* product = assign->assignExpr.val->binaryExpr.expr_right;
+  cr_assert(product->binaryExpr.expr_right->type == AST_IDENTIFIER);
+  cr_assert_str_eq(product->binaryExpr.expr_right->identifierExpr.name,
+                   decl->varDecl.ident->identifierExpr.name);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, keeps_expressions_the_loop_changes) {
+  Node* prog = parse_string(
+    "fn QWORD f (QWORD n, QWORD k) {\n"
+    "  let QWORD t = 0;\n"
+    "  while (t < n) { t = t + k * 2; k = k + 1; }\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) { let QWORD k = i; t = t + k * 2; }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  cr_assert(licm_program(prog, &opts) == 0);
+  cr_assert(((Node*)get_list(body_of(func_at(prog, 0)), 1))->type == AST_WHILE);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, never_hoists_division_or_globals_across_calls) {
+  Node* prog = parse_string(
+    "let QWORD g = 2;\n"
+    "fn QWORD h () { g = g + 1; return g; }\n"
+    "fn QWORD f (QWORD n, QWORD k) {\n"
+    "  let QWORD t = 0;\n"
+    "  while (t < n) { t = t + n / k; }\n"
+    "  while (t < n) { t = t + g * 2 + call h(); }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  cr_assert(licm_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, never_hoists_loads_or_globals_across_pointer_stores) {
+  Node* prog = parse_string(
+    "let QWORD g = 2;\n"
+    "fn QWORD f (QWORD n, &QWORD p) {\n"
+    "  let QWORD t = 0;\n"
+    "  while (t < n) { t = t + [p] * 2; [p] = t; }\n"
+    "  while (t < n) { t = t + g * 2; [p] = t; }\n"
+    "  while (t < n) { t = t + g * 2; p[0] = t; }\n"
+    "  for (let QWORD i = 0; i < n; i++) { t = t + g * 2; p[i] += 1; }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  cr_assert(licm_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, array_stores_do_not_block_global_reads) {
+  Node* prog = parse_string(
+    "let QWORD g = 2;\n"
+    "let QWORD [4] h;\n"
+    "fn QWORD f (QWORD n) {\n"
+    "  let QWORD [4] a;\n"
+    "  let QWORD t = 0;\n"
+    "  while (t < n) { t = t + g * 2; a[1] = t; h[2] = t; }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  cr_assert(licm_program(prog, &opts) == 1);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, inner_loop_values_move_out_of_both_loops) {
+  Node* prog = parse_string(
+    "fn QWORD f (QWORD n, QWORD k) {\n"
+    "  let QWORD t = 0;\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) {\n"
+    "    for (let QWORD j = 0; j < n; j = j + 1) { t = t + (k - 1) * i; }\n"
+    "  }\n"
+    "  return t;\n"
+    "}\n");
+  licm_opts opts = licm_default_opts(1);
+  // (k - 1) * i leaves the inner loop, then k - 1 leaves the outer one
+  cr_assert(licm_program(prog, &opts) == 2);
+  Node* outer = (Node*)get_list(body_of(func_at(prog, 0)), 1);
+  Node* wrapper = (Node*)get_list(outer->blockStmt.nodes, 1);
+  Node* decl = (Node*)get_list(wrapper->blockStmt.nodes, 0);
+  cr_assert(decl->varDecl.assign->binaryExpr.op == B_SUB);
+  free_node(prog);
+  destroy_list(toks);
+}
+
+Test(licm, disabled_at_O0) {
+  Node* prog = parse_string(
+    "fn QWORD f (QWORD n, QWORD k) { while (n > 0) { n = n - k * 2; } return n; }\n");
+  licm_opts opts = licm_default_opts(0);
+  cr_assert(licm_program(prog, &opts) == 0);
+  free_node(prog);
+  destroy_list(toks);
+}
@@ -5,6 +5,7 @@
 #include "tokenizer/tokens.h"
 #include "parser/parser.h"
 #include "utils/arraylist.h"
+#include "utils/cache.h"
 
 // Forward declarations for functions defined in parser.c but not in the header
 extern Node* mk_var_t(bool is_adr, lit_adr_t type_adr, lit_t type);
@@ -941,3 +942,273 @@ Test(parser_parse, address_type_all_variants) {
               "Expected adr type %d at index %d", expected[i], i);
   }
 }
+
+// ============================================================
+// Parallel parsing
+// ============================================================
+
+Test(parser_parallel, finds_declaration_ranges) {
+  ArrayList* tokens = tokenize_string(
+    "let QWORD g = 1;\n"
+    "// note\n"
+    "fn QWORD f (QWORD a) { if (a) { return 1; } return 2; }\n");
+  ArrayList* ranges = find_decl_ranges(tokens);
+  cr_assert(ranges != NULL);
+  cr_assert(ranges->length == 3);
+  decl_range* let = (decl_range*)get_list(ranges, 0);
+  decl_range* fn = (decl_range*)get_list(ranges, 2);
+  cr_assert(let->kind == T_LET);
+  cr_assert(let->end - let->start == 6);
+  cr_assert(((decl_range*)get_list(ranges, 1))->kind == T_COMMENT);
+  cr_assert(fn->kind == T_FUNC);
+  cr_assert(((Token*)get_list(tokens, fn->end - 1))->type == T_RIGHT_BRACE);
+  destroy_list(ranges);
+  destroy_list(tokens);
+}
+
+Test(parser_parallel, unclosed_function_has_no_ranges) {
+  ArrayList* tokens = tokenize_string("fn QWORD f () { return 1;\n");
+  cr_assert(find_decl_ranges(tokens) == NULL);
+  destroy_list(tokens);
+}
+
+Test(parser_parallel, matches_sequential_parse) {
+  char src[8192] = "let QWORD g = 3;\n";
+  for (int i = 0; i < 32; i++) {
+    char fn[128];
+    snprintf(fn, sizeof(fn), "fn QWORD f%d (QWORD a) { let QWORD b = a + %d; return b; }\n", i, i);
+    strcat(src, fn);
+  }
+  ArrayList* tokens = tokenize_string(src);
+  Node* seq = parse_program(tokens);
+  Node* par = parse_program_parallel(tokens, 4);
+  ArrayList* a = seq->programDecl.nodes;
+  ArrayList* b = par->programDecl.nodes;
+  cr_assert(a->length == b->length);
+  for (int i = 1; i < a->length; i++) {
+    Node* fa = (Node*)get_list(a, i);
+    Node* fb = (Node*)get_list(b, i);
+    cr_assert(fb->type == AST_FUNC_DECL);
+    cr_assert_str_eq(fa->funcDecl.type->function_t.ident->identifierExpr.name,
+                     fb->funcDecl.type->function_t.ident->identifierExpr.name);
+    Node* da = (Node*)get_list(fa->funcDecl.block->blockStmt.nodes, 0);
+    Node* db = (Node*)get_list(fb->funcDecl.block->blockStmt.nodes, 0);
+    cr_assert(da->varDecl.assign->binaryExpr.expr_right->literalExpr.num_value == db->varDecl.assign->binaryExpr.expr_right->literalExpr.num_value);
+  }
+  free_node(seq);
+  free_node(par);
+  destroy_list(tokens);
+}
+
+Test(parser_lazy, only_reachable_functions_are_parsed) {
+  ArrayList* tokens = tokenize_string(
+    "let QWORD g = 1;\n"
+    "fn QWORD leaf (QWORD a) { return a; }\n"
+    "fn QWORD dead (QWORD a) { return call leaf(a) }\n"
+    "fn QWORD mid (QWORD a) { return call leaf(a); }\n"
+    "fn DWORD main () { return call mid(2); }\n");
+  ArrayList* roots = init_list(1);
+  add_list(roots, "main");
+  Node* prog = parse_program_lazy(tokens, roots, 1);
+  ArrayList* nodes = prog->programDecl.nodes;
+  // dead has a syntax error but is never called, so it is never parsed
+  cr_assert(nodes->length == 4);
+  cr_assert(((Node*)get_list(nodes, 0))->type == AST_VAR_DECL);
+  const char* names[] = { "leaf", "mid", "main" };
+  for (int i = 0; i < 3; i++) {
+    Node* fn = (Node*)get_list(nodes, i + 1);
+    cr_assert_str_eq(fn->funcDecl.type->function_t.ident->identifierExpr.name, names[i]);
+  }
+  free(roots->items);
+  free(roots);
+  free_node(prog);
+  destroy_list(tokens);
+}
+
+Test(parser_lazy, no_roots_keeps_every_function) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD a () { return 1; }\n"
+    "fn QWORD b () { return call a(); }\n");
+  Node* prog = parse_program_lazy(tokens, NULL, 2);
+  cr_assert(prog->programDecl.nodes->length == 2);
+  free_node(prog);
+  destroy_list(tokens);
+}
+
+Test(parser_hash, ignores_comments_only) {
+  ArrayList* t1 = tokenize_string("fn QWORD f (QWORD a) { return a + 1; }\n");
+  ArrayList* t2 = tokenize_string("fn QWORD f (QWORD a) { // one more\n return a + 1; }\n");
+  ArrayList* t3 = tokenize_string("fn QWORD f (QWORD a) { return a + 2; }\n");
+  Node* p1 = parse_program(t1);
+  Node* p2 = parse_program(t2);
+  Node* p3 = parse_program(t3);
+  Node* f1 = (Node*)get_list(p1->programDecl.nodes, 0);
+  Node* f2 = (Node*)get_list(p2->programDecl.nodes, 0);
+  Node* f3 = (Node*)get_list(p3->programDecl.nodes, 0);
+  uint64_t h1 = hash_node(CACHE_HASH_INIT, f1);
+  cr_assert(h1 == hash_node(CACHE_HASH_INIT, f1));
+  Node* copy = clone_node(f1);
+  cr_assert(h1 == hash_node(CACHE_HASH_INIT, copy));
+  free_node(copy);
+  cr_assert(h1 == hash_node(CACHE_HASH_INIT, f2));
+  cr_assert(h1 != hash_node(CACHE_HASH_INIT, f3));
+  free_node(p1);
+  free_node(p2);
+  free_node(p3);
+  destroy_list(t1);
+  destroy_list(t2);
+  destroy_list(t3);
+}
+
+Test(parser_dump, one_json_line_per_declaration) {
+  ArrayList* tokens = tokenize_string(
+    "let WORD g = 1;\n"
+    "fn QWORD f (QWORD a) { return call f(a - 1); }\n");
+  Node* program = parse_program(tokens);
+  char* buf = NULL;
+  size_t len = 0;
+  FILE* out = open_memstream(&buf, &len);
+  dump_ast_json(out, program);
+  fclose(out);
+
+  char* second = strchr(buf, '\n') + 1;
+  cr_assert(strstr(buf, "{\"kind\":\"var_decl\",\"name\":\"g\",\"type\":{\"kind\":\"type\",\"name\":\"WORD\"") == buf);
+  cr_assert(strstr(second, "{\"kind\":\"func_decl\"") == second);
+  cr_assert(strstr(second, "{\"kind\":\"call\",\"callee\":\"f\",\"args\":[{\"kind\":\"binary\",\"op\":\"-\"") != NULL);
+  cr_assert(strchr(second, '\n')[1] == '\0');
+  free(buf);
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, vector_types) {
+  ArrayList* tokens = tokenize_string(
+    "let V256 g;\n"
+    "fn QWORD f (&DWORD p) { let V128 v = call vload128(p); return 0; }\n");
+  Node* program = parse_program(tokens);
+  Node* global = (Node*)get_list(program->programDecl.nodes, 0);
+  cr_assert(global->varDecl.type->variable_t.type == LIT_V256);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 1);
+  Node* decl = (Node*)get_list(func->funcDecl.block->blockStmt.nodes, 0);
+  cr_assert(decl->varDecl.type->variable_t.type == LIT_V128);
+  cr_assert(decl->varDecl.assign->type == AST_CALL);
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, dereference_loads_and_stores) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD f (&WORD p) { [p + 2] = [p] + 1; return [p]; }\n");
+  Node* program = parse_program(tokens);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 0);
+  Node* assign = (Node*)get_list(func->funcDecl.block->blockStmt.nodes, 0);
+  cr_assert(assign->type == AST_ASSIGN);
+  Node* target = assign->assignExpr.target;
+  cr_assert(target->type == AST_UNARY);
+  cr_assert(target->unaryExpr.op == U_DEREF);
+  cr_assert(target->unaryExpr.expr->binaryExpr.op == B_ADD);
+  Node* load = assign->assignExpr.val->binaryExpr.expr_left;
+  cr_assert(load->unaryExpr.op == U_DEREF);
+  cr_assert(load->unaryExpr.expr->type == AST_IDENTIFIER);
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, bitwise_precedence) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD f (QWORD a, QWORD b, QWORD c) { return a | b & c << 1 + 1 == ~a ^ c >>> 2; }\n");
+  Node* program = parse_program(tokens);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 0);
+  Node* ret = (Node*)get_list(func->funcDecl.block->blockStmt.nodes, 0);
+  // | binds loosest, then ^, then &, which is looser than ==
+  Node* or = ret->returnStmt.return_val;
+  cr_assert(or->binaryExpr.op == B_OR);
+  Node* xor = or->binaryExpr.expr_right;
+  cr_assert(xor->binaryExpr.op == B_XOR);
+  cr_assert(xor->binaryExpr.expr_right->binaryExpr.op == B_SHR);
+  Node* and = xor->binaryExpr.expr_left;
+  cr_assert(and->binaryExpr.op == B_AND);
+  Node* eq = and->binaryExpr.expr_right;
+  cr_assert(eq->binaryExpr.op == B_EQUAL_EQUAL);
+  cr_assert(eq->binaryExpr.expr_right->unaryExpr.op == U_BIT_NOT);
+  // shifts bind looser than + and tighter than comparisons
+  Node* shl = eq->binaryExpr.expr_left;
+  cr_assert(shl->binaryExpr.op == B_SHL);
+  cr_assert(shl->binaryExpr.expr_right->binaryExpr.op == B_ADD);
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, updates_are_assignments) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD f (&WORD p) { p[1] <<= 2; --[p]; for (let QWORD i = 0; i < 4; i++) { } return 0; }\n");
+  Node* program = parse_program(tokens);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 0);
+  ArrayList* stmts = func->funcDecl.block->blockStmt.nodes;
+  // p[1] <<= 2 is p[1] = p[1] << 2
+  Node* shift = (Node*)get_list(stmts, 0);
+  cr_assert(shift->type == AST_ASSIGN);
+  cr_assert(shift->assignExpr.target->type == AST_INDEX);
+  cr_assert(shift->assignExpr.val->binaryExpr.op == B_SHL);
+  Node* read = shift->assignExpr.val->binaryExpr.expr_left;
+  cr_assert(read->type == AST_INDEX && read != shift->assignExpr.target);
+  Node* dec = (Node*)get_list(stmts, 1);
+  cr_assert(dec->type == AST_ASSIGN);
+  cr_assert(dec->assignExpr.target->unaryExpr.op == U_DEREF);
+  cr_assert(dec->assignExpr.val->binaryExpr.op == B_SUB);
+  cr_assert(dec->assignExpr.val->binaryExpr.expr_right->literalExpr.num_value == 1);
+  Node* loop = (Node*)get_list(((Node*)get_list(stmts, 2))->blockStmt.nodes, 1);
+  Node* step = loop->whileStmt.step;
+  cr_assert(step->type == AST_ASSIGN);
+  cr_assert(step->assignExpr.val->binaryExpr.op == B_ADD);
+  cr_assert_str_eq(step->assignExpr.val->binaryExpr.expr_left->identifierExpr.name, "i");
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, while_loop) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD f (QWORD n) { while (n > 0) { n = n - 1; } return n; }\n");
+  Node* program = parse_program(tokens);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 0);
+  Node* loop = (Node*)get_list(func->funcDecl.block->blockStmt.nodes, 0);
+  cr_assert(loop->type == AST_WHILE);
+  cr_assert(loop->whileStmt.cond->binaryExpr.op == B_GREATER);
+  cr_assert(loop->whileStmt.body->blockStmt.nodes->length == 1);
+  cr_assert(loop->whileStmt.step == NULL);
+  free_node(program);
+  destroy_list(tokens);
+}
+
+Test(parser_parse, for_loop_is_a_scoped_while) {
+  ArrayList* tokens = tokenize_string(
+    "fn QWORD f (QWORD n) {\n"
+    "  let QWORD t = 0;\n"
+    "  for (let QWORD i = 0; i < n; i = i + 1) { t = t + i; }\n"
+    "  for (; t > 10;) { t = t - 10; }\n"
+    "  return t;\n"
+    "}\n");
+  Node* program = parse_program(tokens);
+  Node* func = (Node*)get_list(program->programDecl.nodes, 0);
+  ArrayList* body = func->funcDecl.block->blockStmt.nodes;
+  cr_assert(body->length == 4);
+
+  Node* first = (Node*)get_list(body, 1);
+  cr_assert(first->type == AST_BLOCK);
+  cr_assert(first->blockStmt.nodes->length == 2);
+  Node* init = (Node*)get_list(first->blockStmt.nodes, 0);
+  cr_assert(init->type == AST_VAR_DECL);
+  cr_assert_str_eq(init->varDecl.ident->identifierExpr.name, "i");
+  Node* loop = (Node*)get_list(first->blockStmt.nodes, 1);
+  cr_assert(loop->type == AST_WHILE);
+  cr_assert(loop->whileStmt.cond->binaryExpr.op == B_LESS);
+  cr_assert(loop->whileStmt.step->type == AST_ASSIGN);
+
+  Node* second = (Node*)get_list(body, 2);
+  cr_assert(second->blockStmt.nodes->length == 1);
+  loop = (Node*)get_list(second->blockStmt.nodes, 0);
+  cr_assert(loop->type == AST_WHILE);
+  cr_assert(loop->whileStmt.step == NULL);
+  free_node(program);
+  destroy_list(tokens);
+}
@@ -297,3 +297,54 @@ Test(tokenizer_program, cast_expression) {
   cr_assert(get_token(tokens, 2)->type == T_RIGHT_PAREN);
   cr_assert(get_token(tokens, 3)->type == T_IDENTIFIER);
 }
+
+Test(tokenizer_program, bitwise_operators) {
+  const char* src = "a | b ^ ~c & d << 1 >> 2 >>> 3 >= 4";
+  ArrayList* tokens = tokenize_string(src);
+  cr_assert(get_token(tokens, 1)->type == T_PIPE);
+  cr_assert(get_token(tokens, 3)->type == T_CARET);
+  cr_assert(get_token(tokens, 4)->type == T_TILDE);
+  cr_assert(get_token(tokens, 6)->type == T_AND);
+  cr_assert(get_token(tokens, 8)->type == T_LESS_LESS);
+  cr_assert(get_token(tokens, 10)->type == T_GREATER_GREATER);
+  cr_assert(get_token(tokens, 12)->type == T_GREATER_GREATER_GREATER);
+  cr_assert(get_token(tokens, 12)->length == 3);
+  cr_assert(get_token(tokens, 14)->type == T_GREATER_EQUAL);
+}
+
+Test(tokenizer_program, compound_assignments) {
+  const char* src = "a += b -= c *= d /= e &= f |= g ^= h <<= i >>= j >>>= k++";
+  ArrayList* tokens = tokenize_string(src);
+  Token_type want[] = { T_PLUS_EQUAL, T_MINUS_EQUAL, T_STAR_EQUAL, T_DIVIDE_EQUAL, T_AND_EQUAL,
+                        T_PIPE_EQUAL, T_CARET_EQUAL, T_LESS_LESS_EQUAL, T_GREATER_GREATER_EQUAL,
+                        T_GREATER_GREATER_GREATER_EQUAL };
+  for (unsigned int i = 0; i < sizeof(want) / sizeof(want[0]); i++) {
+    cr_assert(get_token(tokens, 2 * i + 1)->type == want[i]);
+  }
+  cr_assert(get_token(tokens, 19)->length == 4);
+  cr_assert(get_token(tokens, 21)->type == T_PLUS_PLUS);
+}
+
+// ============================================================
+// Tokenizer: JSON dump
+// ============================================================
+
+Test(tokenizer_dump, one_json_object_per_token) {
+  ArrayList* tokens = tokenize_string("let QWORD x = 5;");
+  char* buf = NULL;
+  size_t len = 0;
+  FILE* out = open_memstream(&buf, &len);
+  dumpTokensJson(out, tokens);
+  fclose(out);
+
+  int lines = 0;
+  for (size_t i = 0; i < len; i++) {
+    if (buf[i] == '\n') lines++;
+  }
+  cr_assert(lines == tokens->length);
+  cr_assert(strstr(buf, "{\"index\":0,\"type\":\"T_LET\",\"lexeme\":\"let\"") == buf);
+  cr_assert(strstr(buf, "\"type\":\"T_NUMBER_LIT\",\"lexeme\":\"5\"") != NULL);
+  cr_assert_str_eq(tokenTypeName(T_GREATER_EQUAL), "T_GREATER_EQUAL");
+  free(buf);
+  destroy_list(tokens);
+}
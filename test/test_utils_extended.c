@@ -1,10 +1,16 @@
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include <criterion/criterion.h>
 #include <stdbool.h>
 #include "utils/arraylist.h"
 #include "utils/hashtable.h"
 #include "utils/stack.h"
+#include "utils/threadpool.h"
+#include "utils/cache.h"
+#include "utils/stats.h"
+#include "utils/json.h"
 
 // ============================================================
 // Stack: Extended Tests (peek, isEmpty, edge cases)
@@ -280,3 +286,162 @@ Test(hashtable_ext, hash_within_capacity) {
   cr_assert(h < 50);
   destroy_ht(table);
 }
+
+// ============================================================
+// Thread pool
+// ============================================================
+
+static void square_task(void* arg) {
+  long* v = (long*)arg;
+  *v = *v * *v;
+}
+
+Test(threadpool, runs_every_task) {
+  long values[256];
+  for (int i = 0; i < 256; i++) { values[i] = i; }
+  threadpool_t* pool = pool_create(4);
+  cr_assert(pool->thread_count == 4);
+  for (int i = 0; i < 256; i++) {
+    pool_submit(pool, square_task, &values[i]);
+  }
+  pool_wait(pool);
+  for (int i = 0; i < 256; i++) {
+    cr_assert(values[i] == (long)i * i);
+  }
+  pool_destroy(pool);
+}
+
+Test(threadpool, defaults_to_online_cpus) {
+  threadpool_t* pool = pool_create(0);
+  cr_assert(pool->thread_count == online_cpus());
+  cr_assert(online_cpus() >= 1);
+  pool_destroy(pool);
+}
+
+// ============================================================
+// Compilation cache
+// ============================================================
+
+static void write_text(const char* path, const char* text) {
+  FILE* f = fopen(path, "w");
+  fputs(text, f);
+  fclose(f);
+}
+
+static bool file_has(const char* path, const char* text) {
+  char buf[256] = { 0 };
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  return strcmp(buf, text) == 0;
+}
+
+Test(cache, hash_depends_on_every_byte) {
+  uint64_t a = cache_hash(CACHE_HASH_INIT, "fn main", 7);
+  uint64_t b = cache_hash(CACHE_HASH_INIT, "fn main", 7);
+  uint64_t c = cache_hash(CACHE_HASH_INIT, "fn maim", 7);
+  cr_assert(a == b);
+  cr_assert(a != c);
+  // hashing in pieces matches hashing at once
+  uint64_t d = cache_hash(cache_hash(CACHE_HASH_INIT, "fn ", 3), "main", 4);
+  cr_assert(a == d);
+}
+
+Test(cache, store_then_fetch) {
+  char dir[] = "/tmp/cache_testXXXXXX";
+  cr_assert(mkdtemp(dir) != NULL);
+  char nested[64], src[64], dest[64];
+  snprintf(nested, sizeof(nested), "%s/a/b", dir);
+  snprintf(src, sizeof(src), "%s/in.s", dir);
+  snprintf(dest, sizeof(dest), "%s/out.s", dir);
+  compile_cache* cache = cache_open(nested, 0);
+  cr_assert(cache != NULL);
+
+  cr_assert(!cache_fetch(cache, 42, "s", dest));
+  write_text(src, "movq $1, %rax\n");
+  cr_assert(cache_store(cache, 42, "s", src));
+  cr_assert(cache_fetch(cache, 42, "s", dest));
+  cr_assert(file_has(dest, "movq $1, %rax\n"));
+  // same key, other kind of output
+  cr_assert(!cache_fetch(cache, 42, "o", dest));
+
+  cache_record(cache, false);
+  cache_record(cache, true);
+  cache_record(cache, true);
+  cache_stats stats = cache_read_stats(cache);
+  cr_assert(stats.hits == 2);
+  cr_assert(stats.misses == 1);
+  cr_assert(stats.evictions == 0);
+  cache_close(cache);
+}
+
+Test(cache, evicts_least_recently_used) {
+  char dir[] = "/tmp/cache_testXXXXXX";
+  cr_assert(mkdtemp(dir) != NULL);
+  char src[64], dest[64];
+  snprintf(src, sizeof(src), "%s/in.s", dir);
+  snprintf(dest, sizeof(dest), "%s/out.s", dir);
+  char entries[64];
+  snprintf(entries, sizeof(entries), "%s/c", dir);
+  compile_cache* cache = cache_open(entries, 0);
+  write_text(src, "012345678\n");
+  cr_assert(cache_store(cache, 1, "s", src));
+  cr_assert(cache_store(cache, 2, "s", src));
+  // room for two 10 byte entries
+  cache->max_bytes = 25;
+  // touch entry 1 so entry 2 is the oldest
+  struct timespec pause = { 0, 20 * 1000 * 1000 };
+  nanosleep(&pause, NULL);
+  cr_assert(cache_fetch(cache, 1, "s", dest));
+  nanosleep(&pause, NULL);
+  cr_assert(cache_store(cache, 3, "s", src));
+
+  cr_assert(cache_fetch(cache, 1, "s", dest));
+  cr_assert(!cache_fetch(cache, 2, "s", dest));
+  cr_assert(cache_fetch(cache, 3, "s", dest));
+  cr_assert(cache_read_stats(cache).evictions == 1);
+  cache_close(cache);
+}
+
+// ============================================================
+// Report counters and JSON strings
+// ============================================================
+
+Test(stats, counts_constructors_only_when_enabled) {
+  unsigned long long lists = stat_get(STAT_LIST_ALLOCS);
+  ArrayList* quiet = init_list(4);
+  cr_assert(stat_get(STAT_LIST_ALLOCS) == lists);
+
+  stats_enabled = true;
+  unsigned long long bytes = stat_get(STAT_ALLOC_BYTES);
+  unsigned long long tables = stat_get(STAT_HT_ALLOCS);
+  ArrayList* list = init_list(1);
+  add_list(list, NULL);
+  add_list(list, NULL);
+  hashtable_t* table = create_ht(8);
+  stats_enabled = false;
+
+  cr_assert(stat_get(STAT_LIST_ALLOCS) == lists + 1);
+  cr_assert(stat_get(STAT_HT_ALLOCS) == tables + 1);
+  // growth is counted on top of the initial allocation
+  cr_assert(stat_get(STAT_ALLOC_BYTES) - bytes ==
+            sizeof(ArrayList) + sizeof(void*) * list->capacity + sizeof(hashtable_t) + sizeof(node_t*) * 8);
+  free(quiet->items);
+  free(quiet);
+  free(list->items);
+  free(list);
+  destroy_ht(table);
+}
+
+Test(json, escapes_strings) {
+  char* buf = NULL;
+  size_t len = 0;
+  FILE* out = open_memstream(&buf, &len);
+  json_write_str(out, "a\"b\\c\nd\x01");
+  fputc(' ', out);
+  json_write_str(out, NULL);
+  fclose(out);
+  cr_assert_str_eq(buf, "\"a\\\"b\\\\c\\nd\\u0001\" null");
+  free(buf);
+}